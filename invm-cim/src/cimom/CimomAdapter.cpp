@@ -28,5 +28,64 @@
 /*
  * File Description
  */
+#include <mutex>
+#include <unordered_map>
+
 #include "CimomAdapter.h"
+#include "StringUtil.h"
+
+/*
+ * The class hierarchy doesn't change while the provider is loaded, so each answer from the
+ * CIMOM is kept for (child, parent) pairs it has already been asked about
+ */
+namespace
+{
+	std::mutex g_classIsALock;
+	std::unordered_map<std::string, bool> g_classIsA;
+}
+
+bool classIsA(std::string child, std::string parent)
+{
+	bool isA = false;
+	classIsA(child, parent, isA);
+	return isA;
+}
+
+bool classIsA(const std::string &child, const std::string &parent, bool &isA)
+{
+	isA = false;
+	if (child.empty() || parent.empty())
+	{
+		return true;
+	}
+	if (wbem::framework::StringUtil::stringCompareIgnoreCase(child, parent))
+	{
+		isA = true;
+		return true;
+	}
+
+	std::string key = child + '\n' + parent;
+	{
+		std::lock_guard<std::mutex> lock(g_classIsALock);
+		std::unordered_map<std::string, bool>::const_iterator iter = g_classIsA.find(key);
+		if (iter != g_classIsA.end())
+		{
+			isA = iter->second;
+			return true;
+		}
+	}
+
+	// ask the CIMOM outside of the lock
+	bool answered = cimomClassIsA(child, parent, isA);
+	if (answered)
+	{
+		std::lock_guard<std::mutex> lock(g_classIsALock);
+		g_classIsA[key] = isA;
+	}
+	else
+	{
+		isA = false;
+	}
+	return answered;
+}
 
@@ -31,8 +31,31 @@
 #include "Instance.h"
 #include <string>
 
+/*!
+ * Check if a class is, or is derived from, another class.
+ * @remarks Answers are cached per (child, parent) pair, so the CIMOM is only asked the
+ * first time a pair is seen.
+ */
 bool classIsA(std::string child, std::string parent);
 
+/*!
+ * Check if a class is, or is derived from, another class, telling apart a "no" from no
+ * answer. Class names are compared ignoring case, as CIM does.
+ * @param[out] isA
+ * 		The answer, false if there isn't one.
+ * @return false if the CIMOM couldn't answer.
+ */
+bool classIsA(const std::string &child, const std::string &parent, bool &isA);
+
+/*!
+ * Ask the CIMOM if a class is, or is derived from, another class. Each CIMOM adapter
+ * implements this.
+ * @param[out] isA
+ * 		The answer from the CIMOM.
+ * @return false if the CIMOM couldn't answer. Those answers are not cached.
+ */
+bool cimomClassIsA(const std::string &child, const std::string &parent, bool &isA);
+
 namespace wbem
 {
 namespace framework
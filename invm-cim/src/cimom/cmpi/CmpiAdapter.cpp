@@ -30,23 +30,30 @@
 #include "logging.h"
 #include "ProviderFactory.h"
 #include "CmpiAdapter.h"
+#include "IndicationFilterRegistry.h"
 #include "IntelToCmpi.h"
+#include "ThreadPool.h"
 
 extern const CMPIBroker *g_pBroker;
 
-bool classIsA(std::string child, std::string parent)
+bool cimomClassIsA(const std::string &child, const std::string &parent, bool &isA)
 {
-	bool result = false;
+	bool answered = false;
 	wbem::framework::ProviderFactory *pFactory = wbem::framework::ProviderFactory::getSingleton();
 	if (g_pBroker && pFactory)
 	{
 		std::string defaultNamespace = pFactory->getDefaultCimNamespace();
+		CMPIStatus status = {CMPI_RC_OK, NULL};
 		CMPIObjectPath *objectPath = CMNewObjectPath (g_pBroker,
 				defaultNamespace.c_str(),
-				child.c_str(), NULL);
-		result = CMClassPathIsA(g_pBroker, objectPath, parent.c_str(), NULL);
+				child.c_str(), &status);
+		if (objectPath && status.rc == CMPI_RC_OK)
+		{
+			isA = CMClassPathIsA(g_pBroker, objectPath, parent.c_str(), &status);
+			answered = status.rc == CMPI_RC_OK;
+		}
 	}
-	return result;
+	return answered;
 }
 
 wbem::framework::CmpiAdapter::CmpiAdapter(CMPIContext *pContext, const CMPIBroker *pBroker)
@@ -64,6 +71,12 @@ void wbem::framework::CmpiAdapter::sendIndication(wbem::framework::Instance &ind
 	{
 		COMMON_LOG_ERROR_F("Error attaching thread. Status: %d.", (int)status.rc);
 	}
+	else if (!IndicationFilterRegistry::getSingleton().isWanted(indication))
+	{
+		// no active filter wants it, save the conversion and the trip to the broker
+		COMMON_LOG_DEBUG_F("Dropping unwanted indication of class %s",
+				indication.getClass().c_str());
+	}
 	else
 	{
 		CMPIInstance *inst = intelToCmpi(m_pBroker, &indication,  &status);
@@ -96,3 +109,179 @@ void wbem::framework::CmpiAdapter::sendIndication(wbem::framework::Instance &ind
 		}
 	}
 }
+
+/*
+ * Passes the instances a factory finds to the queue of the pipeline
+ */
+class InstanceQueueSink : public wbem::framework::InstanceSink
+{
+	public:
+		InstanceQueueSink(wbem::framework::BoundedQueue<wbem::framework::Instance> &queue) :
+			m_queue(queue) {}
+
+		bool addInstance(wbem::framework::Instance &instance)
+		{
+			// the queue is closed once the later stages stop
+			return m_queue.push(instance);
+		}
+
+	private:
+		wbem::framework::BoundedQueue<wbem::framework::Instance> &m_queue;
+};
+
+/*
+ * Converts and returns each instance as the factory finds it
+ */
+class InstanceResultSink : public wbem::framework::InstanceSink
+{
+	public:
+		InstanceResultSink(const CMPIBroker *pBroker, const CMPIResult *pResult,
+				CMPIStatus &status) :
+			m_pBroker(pBroker), m_pResult(pResult), m_status(status), m_count(0) {}
+
+		bool addInstance(wbem::framework::Instance &instance)
+		{
+			CMPIStatus tempStatus = {CMPI_RC_OK, NULL};
+			CMPIInstance *pCmpiInstance = wbem::framework::intelToCmpi(m_pBroker, &instance, &tempStatus);
+			if (tempStatus.rc == CMPI_RC_OK && pCmpiInstance != NULL)
+			{
+				tempStatus = CMReturnInstance(m_pResult, pCmpiInstance);
+			}
+			else
+			{
+				COMMON_LOG_ERROR("Instance not added.  Issue converting to CMPI");
+			}
+			KEEP_ERR(m_status, tempStatus);
+
+			bool added = tempStatus.rc == CMPI_RC_OK && pCmpiInstance != NULL;
+			if (added)
+			{
+				m_count++;
+			}
+			return added;
+		}
+
+		size_t getCount() const
+		{
+			return m_count;
+		}
+
+	private:
+		const CMPIBroker *m_pBroker;
+		const CMPIResult *m_pResult;
+		CMPIStatus &m_status;
+		size_t m_count;
+};
+
+wbem::framework::CmpiInstancePipeline::CmpiInstancePipeline(const CMPIBroker *pBroker,
+		const CMPIContext *pContext, const CMPIResult *pResult, const size_t depth) :
+		m_pBroker(pBroker), m_pContext(pContext), m_pResult(pResult),
+		m_instances(depth), m_isProduced(false)
+{
+	m_produceStatus.rc = CMPI_RC_OK;
+	m_produceStatus.msg = NULL;
+}
+
+size_t wbem::framework::CmpiInstancePipeline::run(InstanceFactory &factory,
+		const std::string &className, attribute_names_t &attributes, CMPIStatus *pStatus)
+{
+	LogEnterExit logging(__FILE__, __FUNCTION__, __LINE__);
+
+	RequestContext *pRequestContext = RequestContext::getCurrent();
+	CMPIContext *pProducerContext = NULL;
+	if (!factory.streamsInstances())
+	{
+		COMMON_LOG_DEBUG("Factory doesn't stream its instances, enumerating on the calling thread");
+		return runSerial(factory, className, attributes, pStatus);
+	}
+	if (pRequestContext != NULL)
+	{
+		pProducerContext = CBPrepareAttachThread(m_pBroker, m_pContext);
+	}
+	if (pProducerContext == NULL)
+	{
+		COMMON_LOG_DEBUG("Can't attach a producer thread, enumerating on the calling thread");
+		return runSerial(factory, className, attributes, pStatus);
+	}
+
+	// the producer only waits on this thread, so it can't hold up the other pool tasks
+	InstanceFactory *pFactory = &factory;
+	const std::string *pClassName = &className;
+	attribute_names_t *pAttributes = &attributes;
+	ThreadPool::getShared().submit(
+			[this, pProducerContext, pRequestContext, pFactory, pClassName, pAttributes]()
+	{
+		produce(pProducerContext, pRequestContext, pFactory, pClassName, pAttributes);
+	});
+
+	// convert and return the instances as they are found
+	InstanceResultSink sink(m_pBroker, m_pResult, *pStatus);
+	Instance instance;
+	while (m_instances.pop(instance))
+	{
+		if (!sink.addInstance(instance))
+		{
+			// stop the factory
+			m_instances.close();
+			break;
+		}
+	}
+
+	// the producer uses this pipeline until it is done
+	{
+		std::unique_lock<std::mutex> lock(m_lock);
+		m_producedCondition.wait(lock, [this]() { return m_isProduced; });
+	}
+
+	KEEP_ERR(*pStatus, m_produceStatus);
+	if (m_error)
+	{
+		std::rethrow_exception(m_error);
+	}
+	return sink.getCount();
+}
+
+void wbem::framework::CmpiInstancePipeline::produce(CMPIContext *pThreadContext,
+		RequestContext *pRequestContext, InstanceFactory *pFactory,
+		const std::string *pClassName, attribute_names_t *pAttributes)
+{
+	LogEnterExit logging(__FILE__, __FUNCTION__, __LINE__);
+
+	// factories may call back into the broker, e.g. for classIsA
+	CMPIStatus status = CBAttachThread(m_pBroker, pThreadContext);
+	if (status.rc != CMPI_RC_OK)
+	{
+		COMMON_LOG_ERROR_F("Error attaching producer thread. Status: %d.", (int)status.rc);
+		m_produceStatus = status;
+	}
+	else
+	{
+		try
+		{
+			RequestScope requestScope(*pRequestContext);
+			InstanceQueueSink sink(m_instances);
+			pFactory->streamInstances(*pClassName, *pAttributes, sink);
+		}
+		// rethrown on the calling thread
+		catch (...)
+		{
+			m_error = std::current_exception();
+		}
+		CBDetachThread(m_pBroker, pThreadContext);
+	}
+	m_instances.close();
+
+	std::lock_guard<std::mutex> lock(m_lock);
+	m_isProduced = true;
+	m_producedCondition.notify_all();
+}
+
+size_t wbem::framework::CmpiInstancePipeline::runSerial(InstanceFactory &factory,
+		const std::string &className, attribute_names_t &attributes, CMPIStatus *pStatus)
+{
+	LogEnterExit logging(__FILE__, __FUNCTION__, __LINE__);
+
+	InstanceResultSink sink(m_pBroker, m_pResult, *pStatus);
+	factory.streamInstances(className, attributes, sink);
+	return sink.getCount();
+}
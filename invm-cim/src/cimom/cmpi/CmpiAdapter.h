@@ -32,8 +32,20 @@
 #define INTEL_CIM_FRAMEWORK_CMPICONTEXT_H
 
 #include <cmpi/cmpidt.h>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <string>
 #include "Instance.h"
+#include "InstanceFactory.h"
+#include "BoundedQueue.h"
 #include "CimomAdapter.h"
+#include "RequestContext.h"
+
+/*!
+ * The number of instances the factory of a CmpiInstancePipeline may get ahead of the broker
+ */
+#define	CMPI_PIPELINE_DEPTH	64
 
 namespace wbem
 {
@@ -50,6 +62,70 @@ protected:
 	CMPIContext *m_pContext;
 	const CMPIBroker *m_pBroker;
 };
+
+/*!
+ * Enumerates the instances of a class to a CMPI result in two stages that run at the same
+ * time: a task on the shared ThreadPool finding the instances with
+ * InstanceFactory::streamInstances, and the calling thread converting them to CMPI and
+ * returning them to the broker. The stages are joined by a bounded queue, so the provider
+ * holds no more than a few framework instances at once.
+ * @remarks The task is only submitted for a factory that streams its instances (see
+ * InstanceFactory::streamsInstances), otherwise there is nothing to overlap and each
+ * instance is found, converted and returned on the calling thread. The same happens if the
+ * broker can't attach another thread. As the CMPI instances are created by the calling
+ * thread, the broker keeps them until the enumeration ends.
+ */
+class CmpiInstancePipeline
+{
+public:
+	CmpiInstancePipeline(const CMPIBroker *pBroker, const CMPIContext *pContext,
+			const CMPIResult *pResult, const size_t depth = CMPI_PIPELINE_DEPTH);
+
+	/*!
+	 * Return the instances of a class to the result.
+	 * @param[in] factory
+	 * 		The factory for the class.
+	 * @param[in] className
+	 * 		The class being enumerated.
+	 * @param[in] attributes
+	 * 		The attributes to retrieve for each instance.
+	 * @param[in,out] pStatus
+	 * 		Keeps the first error converting or returning an instance.
+	 * @return
+	 * 		The number of instances returned.
+	 * @throw Exception
+	 * 		What the factory threw, after any instances found before it were returned.
+	 */
+	size_t run(InstanceFactory &factory, const std::string &className,
+			attribute_names_t &attributes, CMPIStatus *pStatus);
+
+private:
+	CmpiInstancePipeline(const CmpiInstancePipeline &);
+	CmpiInstancePipeline &operator=(const CmpiInstancePipeline &);
+
+	/*
+	 * Find the instances, on a pool thread
+	 */
+	void produce(CMPIContext *pThreadContext, RequestContext *pRequestContext,
+			InstanceFactory *pFactory, const std::string *pClassName,
+			attribute_names_t *pAttributes);
+
+	/*
+	 * Convert and return each instance as it is found, on the calling thread
+	 */
+	size_t runSerial(InstanceFactory &factory, const std::string &className,
+			attribute_names_t &attributes, CMPIStatus *pStatus);
+
+	const CMPIBroker *m_pBroker;
+	const CMPIContext *m_pContext;
+	const CMPIResult *m_pResult;
+	BoundedQueue<Instance> m_instances;
+	CMPIStatus m_produceStatus;
+	std::exception_ptr m_error; // thrown by the factory
+	std::mutex m_lock;
+	std::condition_variable m_producedCondition;
+	bool m_isProduced;
+};
 }
 }
 
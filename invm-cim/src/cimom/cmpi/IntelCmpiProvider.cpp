@@ -41,6 +41,8 @@
 #include <string.h>
 #include <stdbool.h>
 #include <time.h>
+#include <mutex>
+#include <thread>
 
 #include <cmpi/cmpift.h>
 #include "IntelToCmpi.h"
@@ -52,13 +54,20 @@
 #include "ObjectPathBuilder.h"
 #include "Strings.h"
 #include "Attribute.h"
+#include "ExceptionBadAttribute.h"
 #include "ExceptionBadParameter.h"
+#include "ExceptionInvalidWqlQuery.h"
 #include "Exception.h"
 #include "ExceptionNotSupported.h"
 #include "ExceptionNoMemory.h"
 #include "ExceptionSystemError.h"
 #include "ProviderFactory.h"
+#include "RequestContext.h"
+#include "ReferenceSink.h"
+#include "WqlPlanCache.h"
+#include "IndicationFilterRegistry.h"
 #include <logger/logging.h>
+#include <string/s_str.h>
 #include <common_types.h>
 
 #include "AssociationFactory.h"
@@ -74,11 +83,187 @@ namespace framework
 // Pointer to the context the indication provider should use in it's callbacks
 CmpiAdapter *g_pCimomContext;
 static int g_enabled = 0;
+// Guards g_pCimomContext and g_enabled, filters can be activated from several CIMOM threads
+static std::mutex g_indicationLock;
 
-void InstanceProviderInit()
+// Background warm-up of the provider, started once per load
+static std::mutex g_warmUpLock;
+static std::thread g_warmUpThread;
+static RequestContext *g_pWarmUpContext = NULL;
+
+// The only query language ExecQuery understands
+static const char WQL_LANGUAGE[] = "WQL";
+
+static void warmUpProvider(CMPIContext *pContext, RequestContext *pRequestContext)
+{
+	LogEnterExit logging(__FILE__, __FUNCTION__, __LINE__);
+
+	// the warm-up thread may call back into the broker, e.g. for classIsA
+	CMPIStatus status = CBAttachThread(g_pBroker, pContext);
+	if (status.rc != CMPI_RC_OK)
+	{
+		COMMON_LOG_ERROR_F("Error attaching warm-up thread. Status: %d.", (int)status.rc);
+	}
+	else
+	{
+		ProviderFactory *pProviderFactory = ProviderFactory::getSingleton();
+		if (pProviderFactory != NULL)
+		{
+			RequestScope requestScope(*pRequestContext);
+			pProviderFactory->warmUp();
+		}
+		CBDetachThread(g_pBroker, pContext);
+	}
+}
+
+void InstanceProviderInit(const CMPIContext *pContext)
+{
+	LogEnterExit logging(__FILE__, __FUNCTION__, __LINE__);
+
+	ProviderFactory *pProviderFactory = ProviderFactory::getSingleton();
+	if (pProviderFactory != NULL && pContext != NULL &&
+			!pProviderFactory->getWarmUpClasses().empty())
+	{
+		std::lock_guard<std::mutex> lock(g_warmUpLock);
+		// the CIMOM creates the instance MI once per registered class, only warm up once
+		if (g_pWarmUpContext == NULL)
+		{
+			CMPIContext *pThreadContext = CBPrepareAttachThread(g_pBroker, pContext);
+			if (pThreadContext == NULL)
+			{
+				COMMON_LOG_WARN("Can't prepare a thread context, skipping the warm-up");
+			}
+			else
+			{
+				g_pWarmUpContext = new RequestContext();
+				g_warmUpThread = std::thread(warmUpProvider, pThreadContext, g_pWarmUpContext);
+			}
+		}
+	}
+}
+
+/*
+ * Stop the warm-up if it is still going and wait for it
+ */
+static void stopWarmUp()
+{
+	std::lock_guard<std::mutex> lock(g_warmUpLock);
+	if (g_pWarmUpContext != NULL)
+	{
+		g_pWarmUpContext->cancel();
+		if (g_warmUpThread.joinable())
+		{
+			g_warmUpThread.join();
+		}
+		delete g_pWarmUpContext;
+		g_pWarmUpContext = NULL;
+	}
+}
+
+/*
+ * Tell the client a request stopped early and returned partial results. CIMOMs drop the
+ * results of a request that doesn't return OK, so the status stays OK and only gets a
+ * message. The request context has already logged it.
+ */
+static void setPartialResultStatus(RequestContext &requestContext, CMPIStatus *pStatus)
+{
+	if (requestContext.isTruncated() && pStatus->rc == CMPI_RC_OK)
+	{
+		CMSetStatusWithChars(g_pBroker, pStatus, CMPI_RC_OK,
+				requestContext.isCancelled() ?
+						"Request cancelled, results are incomplete" :
+						"Request deadline exceeded, results are incomplete");
+	}
+}
+
+/*
+ * Convert an association key to a CMPI reference. Keys built by the framework already hold
+ * the object path, older string keys still need to be parsed.
+ */
+static CMPIObjectPath *referenceKeyToCmpi(const wbem::framework::Attribute &key,
+		CMPIStatus *pStatus)
+{
+	wbem::framework::ObjectPath objectPath;
+	if (key.getType() == wbem::framework::REFERENCE_T)
+	{
+		objectPath = key.referenceValue();
+	}
+	else
+	{
+		wbem::framework::ObjectPathBuilder(key.asStr()).Build(&objectPath);
+	}
+	return intelToCmpi(g_pBroker, &objectPath, pStatus);
+}
+
+/*
+ * Build the CMPI object path of an association object, with each of its keys as a reference.
+ */
+static CMPIObjectPath *referencePathToCmpi(const wbem::framework::ObjectPath &path,
+		const char *nameSpace, const std::string &className, CMPIStatus *pStatus)
 {
+	CMPIObjectPath *cmpiObjectPath = CMNewObjectPath(g_pBroker, nameSpace, className.c_str(), pStatus);
+
+	wbem::framework::attributes_t keys = path.getKeys();
+	wbem::framework::attributes_t::iterator key = keys.begin();
+	for (; key != keys.end(); key++)
+	{
+		COMMON_LOG_DEBUG_F("converting key %s", key->first.c_str());
+		CMPIValue value;
+		value.ref = referenceKeyToCmpi(key->second, pStatus);
+		CMAddKey(cmpiObjectPath, key->first.c_str(), &value, CMPI_ref);
+	}
+	return cmpiObjectPath;
 }
 
+/*
+ * Returns each reference to the CIMOM as soon as the framework finds it
+ */
+class CmpiReferenceSink : public wbem::framework::ReferenceSink
+{
+	public:
+		CmpiReferenceSink(const CMPIResult *pResult, const char *nameSpace,
+				const std::string &className, CMPIStatus *pStatus) :
+			m_pResult(pResult), m_nameSpace(nameSpace), m_className(className),
+			m_pStatus(pStatus), m_count(0)
+		{
+		}
+
+		void addReference(const wbem::framework::ObjectPath &path,
+				const wbem::framework::Instance *pInstance)
+		{
+			COMMON_LOG_DEBUG_F("Converting reference %s to CMPI", path.asString().c_str());
+			CMPIObjectPath *cmpiObjectPath = referencePathToCmpi(path, m_nameSpace, m_className,
+					m_pStatus);
+			if (pInstance)
+			{
+				CMPIInstance *pCmpiInstance = CMNewInstance(g_pBroker, cmpiObjectPath, m_pStatus);
+
+				wbem::framework::attributes_t keys = path.getKeys();
+				wbem::framework::attributes_t::iterator key = keys.begin();
+				for (; key != keys.end(); key++)
+				{
+					COMMON_LOG_DEBUG_F("Setting key property %s", key->first.c_str());
+					CMPIData keyData = CMGetKey(cmpiObjectPath, key->first.c_str(), m_pStatus);
+					CMSetProperty(pCmpiInstance, key->first.c_str(), &(keyData.value), keyData.type);
+				}
+				CMReturnInstance(m_pResult, pCmpiInstance);
+			}
+			else
+			{
+				CMReturnObjectPath(m_pResult, cmpiObjectPath);
+			}
+			m_count++;
+		}
+
+		size_t getCount() const { return m_count; }
+
+	private:
+		const CMPIResult *m_pResult;
+		const char *m_nameSpace;
+		std::string m_className;
+		CMPIStatus *m_pStatus;
+		size_t m_count;
+};
 
 
 /*
@@ -95,6 +280,12 @@ void InstanceProviderInit()
 CMPIStatus Generic_Cleanup(CMPIInstanceMI *pThis, const CMPIContext *pContext, CMPIBoolean term)
 {
 	LogEnterExit logging(__FILE__, __FUNCTION__, __LINE__);
+	if (term)
+	{
+		// don't let in-flight enumerations hold up the unload
+		RequestContext::cancelAll();
+	}
+	stopWarmUp();
 
 	CMReturn (CMPI_RC_OK);
 }
@@ -116,7 +307,9 @@ CMPIStatus Generic_EnumInstanceNames(CMPIInstanceMI *cThis, const CMPIContext *c
 	}
 	else
 	{
-		pProviderFactory->InitializeProvider();
+		pProviderFactory->beginAction();
+		RequestContext requestContext(pProviderFactory->getRequestTimeout());
+		RequestScope requestScope(requestContext);
 
 		const char *const className = CMGetCharsPtr(CMGetClassName(ref, NULL), NULL);
 		wbem::framework::InstanceFactory *pFactory =
@@ -129,7 +322,7 @@ CMPIStatus Generic_EnumInstanceNames(CMPIInstanceMI *cThis, const CMPIContext *c
 				wbem::framework::instance_names_t *pObjectPaths = NULL;
 				try
 				{
-					pObjectPaths = pFactory->getInstanceNames();
+					pObjectPaths = pFactory->getInstanceNamesShared(className);
 				}
 				catch(wbem::framework::ExceptionBadParameter &e)
 				{
@@ -168,7 +361,8 @@ CMPIStatus Generic_EnumInstanceNames(CMPIInstanceMI *cThis, const CMPIContext *c
 			}
 			delete pFactory;
 		}
-		pProviderFactory->CleanUpProvider();
+		setPartialResultStatus(requestContext, &status);
+		pProviderFactory->endAction();
 	}
 
 	CMReturnDone (rslt);
@@ -194,7 +388,9 @@ CMPIStatus Generic_EnumInstances(CMPIInstanceMI *pThis, const CMPIContext *pCont
 	}
 	else
 	{
-		pProviderFactory->InitializeProvider();
+		pProviderFactory->beginAction();
+		RequestContext requestContext(pProviderFactory->getRequestTimeout());
+		RequestScope requestScope(requestContext);
 
 		const char *const className = CMGetCharsPtr(CMGetClassName(pRefCmpiObjectPath, NULL), NULL);
 		wbem::framework::InstanceFactory *pFactory =
@@ -204,12 +400,13 @@ CMPIStatus Generic_EnumInstances(CMPIInstanceMI *pThis, const CMPIContext *pCont
 		{
 			if (status.rc == CMPI_RC_OK)
 			{
-				// get all instances with all attributes
+				// get all instances with all attributes, returning each as it is found
 				wbem::framework::attribute_names_t attrNames;
-				wbem::framework::instances_t *pInstances = NULL;
 				try
 				{
-					pInstances = pFactory->getInstances(attrNames);
+					wbem::framework::CmpiInstancePipeline pipeline(g_pBroker, pContext, pResult);
+					size_t count = pipeline.run(*pFactory, className, attrNames, &status);
+					COMMON_LOG_DEBUG_F("Added %d Instances", (int)count);
 				}
 				catch(wbem::framework::ExceptionBadParameter &e)
 				{
@@ -227,37 +424,11 @@ CMPIStatus Generic_EnumInstances(CMPIInstanceMI *pThis, const CMPIContext *pCont
 				{
 					CMSetStatusWithChars(g_pBroker, &status, CMPI_RC_ERROR, e.what());
 				}
-
-				if (pInstances != NULL)
-				{
-					if (status.rc == CMPI_RC_OK)
-					{
-						// iterate through each instance
-						wbem::framework::instances_t::iterator iInstance;
-						COMMON_LOG_DEBUG_F("Adding %d Instances", (int)pInstances->size());
-						for (iInstance = pInstances->begin(); iInstance != pInstances->end(); iInstance++)
-						{
-							CMPIStatus tempStatus;
-							CMPIInstance *pCmpiInstance = intelToCmpi(g_pBroker, &(*iInstance), &tempStatus);
-							KEEP_ERR(status, tempStatus);
-
-							if (status.rc == CMPI_RC_OK)
-							{
-								COMMON_LOG_DEBUG_F("Adding Instance: %s", iInstance->getClass().c_str());
-								CMReturnInstance (pResult, pCmpiInstance);
-							}
-							else
-							{
-								COMMON_LOG_ERROR("Instance not added.  Issue converting to CMPI");
-							}
-						}
-					}
-					delete pInstances;
-				}
 			}
 			delete pFactory;
 		}
-		pProviderFactory->CleanUpProvider();
+		setPartialResultStatus(requestContext, &status);
+		pProviderFactory->endAction();
 	}
 
 	CMReturnDone (pResult);
@@ -283,7 +454,9 @@ CMPIStatus Generic_GetInstance(CMPIInstanceMI *pThis, const CMPIContext *pContex
 	}
 	else
 	{
-		pProviderFactory->InitializeProvider();
+		pProviderFactory->beginAction();
+		RequestContext requestContext(pProviderFactory->getRequestTimeout());
+		RequestScope requestScope(requestContext);
 
 		wbem::framework::ObjectPath objectPath;
 		cmpiToIntel(pCmpiObjectPath, &objectPath, &status);
@@ -334,7 +507,8 @@ CMPIStatus Generic_GetInstance(CMPIInstanceMI *pThis, const CMPIContext *pContex
 				delete pFactory;
 			}
 		}
-		pProviderFactory->CleanUpProvider();
+		setPartialResultStatus(requestContext, &status);
+		pProviderFactory->endAction();
 	}
 	CMReturnDone (pResult);
 	COMMON_LOG_INFO_F("Returning status %d", status.rc);
@@ -399,7 +573,9 @@ CMPIStatus Generic_ModifyInstance(
 	}
 	else
 	{
-		pProviderFactory->InitializeProvider();
+		pProviderFactory->beginAction();
+		RequestContext requestContext(pProviderFactory->getRequestTimeout());
+		RequestScope requestScope(requestContext);
 
 		wbem::framework::ObjectPath objectPath;
 		cmpiToIntel(pCmpiObjectPath, &objectPath, &status);
@@ -465,7 +641,7 @@ CMPIStatus Generic_ModifyInstance(
 				delete (pProvider);
 			}
 		}
-		pProviderFactory->CleanUpProvider();
+		pProviderFactory->endAction();
 	}
 
 	CMReturnDone (pResult);
@@ -494,8 +670,98 @@ CMPIStatus Generic_ExecQuery
 				const CMPIObjectPath *cop, const char *lang, const char *query)
 {
 	LogEnterExit logging(__FILE__, __FUNCTION__, __LINE__);
-	// TODO: Implement when needed
-	CMReturn (CMPI_RC_ERR_NOT_SUPPORTED);
+	CMPIStatus status = {CMPI_RC_OK, 0};
+
+	wbem::framework::ProviderFactory *pProviderFactory =
+			wbem::framework::ProviderFactory::getSingleton();
+	if (pProviderFactory == NULL)
+	{
+		status.rc = CMPI_RC_ERROR;
+	}
+	else if (lang == NULL || s_strncmpi(lang, WQL_LANGUAGE, sizeof (WQL_LANGUAGE)) != 0)
+	{
+		COMMON_LOG_ERROR_F("Query language %s is not supported", lang ? lang : "(null)");
+		CMSetStatus(&status, CMPI_RC_ERR_QUERY_LANGUAGE_NOT_SUPPORTED);
+	}
+	else
+	{
+		pProviderFactory->beginAction();
+		RequestContext requestContext(pProviderFactory->getRequestTimeout());
+		RequestScope requestScope(requestContext);
+
+		wbem::framework::InstanceFactory *pFactory = NULL;
+		wbem::framework::instances_t *pInstances = NULL;
+		try
+		{
+			std::shared_ptr<const wbem::framework::WqlPlan> pPlan =
+					wbem::framework::WqlPlanCache::getSingleton().getPlan(query != NULL ? query : "");
+			pFactory = pProviderFactory->getInstanceFactory(pPlan->getQuery().getClassName());
+			if (pFactory != NULL)
+			{
+				pInstances = pFactory->execQuery(*pPlan);
+			}
+			else
+			{
+				CMSetStatus(&status, CMPI_RC_ERR_INVALID_CLASS);
+			}
+		}
+		catch(wbem::framework::ExceptionInvalidWqlQuery &e)
+		{
+			CMSetStatusWithChars(g_pBroker, &status, CMPI_RC_ERR_INVALID_QUERY, e.what());
+		}
+		catch(wbem::framework::ExceptionBadAttribute &e)
+		{
+			CMSetStatusWithChars(g_pBroker, &status, CMPI_RC_ERR_INVALID_QUERY, e.what());
+		}
+		catch(wbem::framework::ExceptionBadParameter &e)
+		{
+			CMSetStatusWithChars(g_pBroker, &status, CMPI_RC_ERR_INVALID_PARAMETER, e.what());
+		}
+		catch(wbem::framework::ExceptionSystemError &e)
+		{
+			CMSetStatusWithChars(g_pBroker, &status, CMPI_RC_ERROR_SYSTEM, e.what());
+		}
+		catch(wbem::framework::ExceptionNotSupported &e)
+		{
+			CMSetStatusWithChars(g_pBroker, &status, CMPI_RC_ERR_NOT_SUPPORTED, e.what());
+		}
+		catch(wbem::framework::Exception &e)
+		{
+			CMSetStatusWithChars(g_pBroker, &status, CMPI_RC_ERROR, e.what());
+		}
+
+		if (pInstances != NULL)
+		{
+			if (status.rc == CMPI_RC_OK)
+			{
+				COMMON_LOG_DEBUG_F("Returning %d instances", (int)pInstances->size());
+				wbem::framework::instances_t::iterator iInstance = pInstances->begin();
+				for (; iInstance != pInstances->end(); iInstance++)
+				{
+					CMPIStatus tempStatus;
+					CMPIInstance *pCmpiInstance = intelToCmpi(g_pBroker, &(*iInstance), &tempStatus);
+					KEEP_ERR(status, tempStatus);
+
+					if (status.rc == CMPI_RC_OK)
+					{
+						CMReturnInstance(rslt, pCmpiInstance);
+					}
+					else
+					{
+						COMMON_LOG_ERROR("Instance not added.  Issue converting to CMPI");
+					}
+				}
+			}
+			delete pInstances;
+		}
+		delete pFactory;
+		setPartialResultStatus(requestContext, &status);
+		pProviderFactory->endAction();
+	}
+
+	CMReturnDone(rslt);
+	COMMON_LOG_INFO_F("Returning status %d", status.rc);
+	return status;
 }
 
 
@@ -505,6 +771,10 @@ CMPIStatus Generic_ExecQuery
 CMPIStatus Generic_AssociationCleanup(CMPIAssociationMI *mi, const CMPIContext *ctx, CMPIBoolean terminating)
 {
 	LogEnterExit logging(__FILE__, __FUNCTION__, __LINE__);
+	if (terminating)
+	{
+		RequestContext::cancelAll();
+	}
 	CMReturn (CMPI_RC_OK);
 }
 
@@ -527,7 +797,9 @@ CMPIStatus Generic_Associators(CMPIAssociationMI *mi, const CMPIContext *ctx,
 	}
 	else
 	{
-		pProviderFactory->InitializeProvider();
+		pProviderFactory->beginAction();
+		RequestContext requestContext(pProviderFactory->getRequestTimeout());
+		RequestScope requestScope(requestContext);
 
 		wbem::framework::ObjectPath objectPath;
 		cmpiToIntel(op, &objectPath, &status);
@@ -588,7 +860,8 @@ CMPIStatus Generic_Associators(CMPIAssociationMI *mi, const CMPIContext *ctx,
 		{
 			CMSetStatus(&status, CMPI_RC_ERR_INVALID_CLASS);
 		}
-		pProviderFactory->CleanUpProvider();
+		setPartialResultStatus(requestContext, &status);
+		pProviderFactory->endAction();
 	}
 
 	COMMON_LOG_INFO_F("Returning status %d", status.rc);
@@ -613,7 +886,9 @@ CMPIStatus Generic_AssociatorNames(CMPIAssociationMI *mi, const CMPIContext *ctx
 	}
 	else
 	{
-		pProviderFactory->InitializeProvider();
+		pProviderFactory->beginAction();
+		RequestContext requestContext(pProviderFactory->getRequestTimeout());
+		RequestScope requestScope(requestContext);
 
 		try
 		{
@@ -654,7 +929,8 @@ CMPIStatus Generic_AssociatorNames(CMPIAssociationMI *mi, const CMPIContext *ctx
 			CMSetStatusWithChars(g_pBroker, &status, CMPI_RC_ERR_FAILED, e.what());
 			COMMON_LOG_ERROR_F("An unknown error occurred getting AssociatorNames:", e.what());
 		}
-		pProviderFactory->CleanUpProvider();
+		setPartialResultStatus(requestContext, &status);
+		pProviderFactory->endAction();
 	}
 
 	CMReturnDone(rslt);
@@ -680,7 +956,9 @@ CMPIStatus Generic_References(CMPIAssociationMI *mi, const CMPIContext *ctx,
 	}
 	else
 	{
-		pProviderFactory->InitializeProvider();
+		pProviderFactory->beginAction();
+		RequestContext requestContext(pProviderFactory->getRequestTimeout());
+		RequestScope requestScope(requestContext);
 
 		wbem::framework::ObjectPath objectPath;
 		cmpiToIntel(op, &objectPath, &status);
@@ -689,64 +967,19 @@ CMPIStatus Generic_References(CMPIAssociationMI *mi, const CMPIContext *ctx,
 				pProviderFactory->getInstanceFactory(objectPath.getClass());
 		if (pFactory != NULL)
 		{
-			wbem::framework::instances_t *pInstances = NULL;
 			try
 			{
 				std::string resultClassStr = resultClass != NULL ? resultClass
 																 : objectPath.getClass();
 				std::string roleStr = role != NULL ? role : "";
 
-				// references are the association class so assocClass = resultClass
-				pInstances = pFactory->referenceInstances(objectPath, resultClassStr, "", roleStr);
-				if (pInstances != NULL)
+				if (status.rc == CMPI_RC_OK)
 				{
-					COMMON_LOG_DEBUG_F("got %llu instances", pInstances->size());
-					if (status.rc == CMPI_RC_OK)
-					{
-						wbem::framework::instances_t::iterator iInstance = pInstances->begin();
-						for (; iInstance != pInstances->end(); iInstance++)
-						{
-							COMMON_LOG_DEBUG_F("Converting instance %s to CMPI",
-									iInstance->getObjectPath().asString().c_str());
-
-							CMPIObjectPath *cmpiObjectPath = CMNewObjectPath (g_pBroker,
-									CMGetCharsPtr(CMGetNameSpace(op, &status), NULL),
-									resultClassStr.c_str(), &status);
-
-							wbem::framework::attributes_t keys = iInstance->getObjectPath().getKeys();
-							wbem::framework::attributes_t::iterator key = keys.begin();
-							std::map<std::string, CMPIData> cmpiKeys;
-							for (; key != keys.end(); key++)
-							{
-								COMMON_LOG_DEBUG_F("converting key %s", key->second.asStr().c_str());
-								CMPIData cmpiAttribute;
-								wbem::framework::ObjectPath objectPath;
-								wbem::framework::ObjectPathBuilder(key->second.asStr()).Build(&objectPath);
-
-								CMPIObjectPath *refPath = intelToCmpi(g_pBroker, &objectPath, &status);
-
-								COMMON_LOG_DEBUG_F("creating CMPI attribute with key %s", key->first.c_str());
-								cmpiAttribute.state = CMPI_keyValue;
-								cmpiAttribute.type = CMPI_ref;
-								cmpiAttribute.value.ref = refPath;
-								cmpiKeys[key->first] = cmpiAttribute;
-								CMAddKey(cmpiObjectPath, key->first.c_str(), &(cmpiAttribute.value), cmpiAttribute.type);
-							}
-
-							CMPIInstance *pCmpiInstance = CMNewInstance(g_pBroker, cmpiObjectPath, &status);
-
-							std::map<std::string, CMPIData>::iterator iCmpiKey = cmpiKeys.begin();
-							for (; iCmpiKey != cmpiKeys.end(); iCmpiKey++)
-							{
-								COMMON_LOG_DEBUG_F("Setting key property %s", iCmpiKey->first.c_str());
-								CMSetProperty(pCmpiInstance, iCmpiKey->first.c_str(),
-										&(iCmpiKey->second.value), iCmpiKey->second.type);
-							}
-
-							CMReturnInstance(rslt, pCmpiInstance);
-						}
-					}
-					delete pInstances;
+					CmpiReferenceSink sink(rslt, CMGetCharsPtr(CMGetNameSpace(op, &status), NULL),
+							resultClassStr, &status);
+					// references are the association class so assocClass = resultClass
+					pFactory->streamReferences(objectPath, sink, true, resultClassStr, "", roleStr);
+					COMMON_LOG_DEBUG_F("returned %llu instances", (unsigned long long)sink.getCount());
 				}
 			}
 			catch(wbem::framework::ExceptionBadParameter &e)
@@ -767,7 +1000,8 @@ CMPIStatus Generic_References(CMPIAssociationMI *mi, const CMPIContext *ctx,
 			}
 			delete pFactory;
 		}
-		pProviderFactory->CleanUpProvider();
+		setPartialResultStatus(requestContext, &status);
+		pProviderFactory->endAction();
 	}
 
 	CMReturnDone(rslt);
@@ -794,7 +1028,9 @@ CMPIStatus Generic_ReferenceNames(CMPIAssociationMI *mi, const CMPIContext *ctx,
 	}
 	else
 	{
-		pProviderFactory->InitializeProvider();
+		pProviderFactory->beginAction();
+		RequestContext requestContext(pProviderFactory->getRequestTimeout());
+		RequestScope requestScope(requestContext);
 
 		wbem::framework::ObjectPath objectPath;
 		cmpiToIntel(op, &objectPath, &status);
@@ -809,36 +1045,10 @@ CMPIStatus Generic_ReferenceNames(CMPIAssociationMI *mi, const CMPIContext *ctx,
 						: objectPath.getClass();
 				std::string roleStr = role != NULL ? role : "";
 
+				CmpiReferenceSink sink(rslt, CMGetCharsPtr(CMGetNameSpace(op, &status), NULL),
+						resultClassStr, &status);
 				// references are the association class so assocClass = resultClass
-				wbem::framework::instance_names_t *pNames = pFactory->referenceNames(objectPath,
-						resultClassStr, "", roleStr);
-
-				wbem::framework::instance_names_t::iterator name = pNames->begin();
-				for (; name != pNames->end(); name++)
-				{
-					CMPIObjectPath *cmpiObjectPath =
-							CMNewObjectPath (g_pBroker,
-									CMGetCharsPtr(CMGetNameSpace(op, &status), NULL), resultClassStr.c_str(), &status);
-
-					wbem::framework::attributes_t keys = name->getKeys();
-					wbem::framework::attributes_t::iterator key = keys.begin();
-					for (; key != keys.end(); key++)
-					{
-						CMPIData cmpiAttribute;
-						wbem::framework::ObjectPath objectPath;
-						wbem::framework::ObjectPathBuilder(key->second.asStr()).Build(&objectPath);
-
-						CMPIObjectPath *refPath = intelToCmpi(g_pBroker, &objectPath, &status);
-
-						cmpiAttribute.state = CMPI_keyValue;
-						cmpiAttribute.type = CMPI_ref;
-						cmpiAttribute.value.ref = refPath;
-						CMAddKey(cmpiObjectPath, key->first.c_str(), &(cmpiAttribute.value), cmpiAttribute.type);
-					}
-
-					CMReturnObjectPath(rslt, cmpiObjectPath);
-				}
-				delete pNames;
+				pFactory->streamReferences(objectPath, sink, false, resultClassStr, "", roleStr);
 			}
 			catch(wbem::framework::ExceptionBadParameter &e)
 			{
@@ -862,7 +1072,8 @@ CMPIStatus Generic_ReferenceNames(CMPIAssociationMI *mi, const CMPIContext *ctx,
 		{
 			CMSetStatus(&status, CMPI_RC_ERR_INVALID_CLASS);
 		}
-		pProviderFactory->CleanUpProvider();
+		setPartialResultStatus(requestContext, &status);
+		pProviderFactory->endAction();
 	}
 
 	CMReturnDone(rslt);
@@ -899,7 +1110,9 @@ CMPIStatus Generic_InvokeMethod(CMPIMethodMI *mi, const CMPIContext *ctx, const
 	}
 	else
 	{
-		pProviderFactory->InitializeProvider();
+		pProviderFactory->beginAction();
+		RequestContext requestContext(pProviderFactory->getRequestTimeout());
+		RequestScope requestScope(requestContext);
 
 		wbem::framework::ObjectPath path;
 		cmpiToIntel(op, &path, &status);
@@ -966,7 +1179,7 @@ CMPIStatus Generic_InvokeMethod(CMPIMethodMI *mi, const CMPIContext *ctx, const
 			status.rc = CMPI_RC_ERR_INVALID_CLASS;
 			COMMON_LOG_ERROR_F("Could not get instance factory for %s", path.getClass().c_str());
 		}
-		pProviderFactory->CleanUpProvider();
+		pProviderFactory->endAction();
 	}
 
 	// this should be the wbemRc code returned here
@@ -986,6 +1199,16 @@ CMPIStatus Generic_InvokeMethod(CMPIMethodMI *mi, const CMPIContext *ctx, const
  * -------------------------------------------------------------------------------------------------
  */
 
+/*
+ * Get the query of an indication filter, or an empty string if it can't be read
+ */
+static std::string getFilterQuery(const CMPISelectExp *filter)
+{
+	CMPIString *pQuery = filter ? CMGetSelExpString(filter, NULL) : NULL;
+	const char *query = pQuery ? CMGetCharsPtr(pQuery, NULL) : NULL;
+	return query ? query : "";
+}
+
 /*
  * Activate the subscription.
  */
@@ -999,23 +1222,51 @@ CMPIStatus Generic_ActivateFilter(CMPIIndicationMI *mi,
 	CMPIStatus status = {CMPI_RC_OK, 0};
 	LogEnterExit logging(__FILE__, __FUNCTION__, __LINE__);
 
+	// compile the filter, so indications it doesn't want are dropped before delivery.
+	// It is active before indicating starts, so none it wants are dropped.
+	std::string query = getFilterQuery(filter);
+	IndicationFilterRegistry::getSingleton().activate(query);
+
+	std::lock_guard<std::mutex> lock(g_indicationLock);
 	if (g_enabled == 0)
 	{
-		CMPIContext *context = CBPrepareAttachThread (g_pBroker, ctx);
-
-		try
+		// the adapter is kept for the next subscription, the service may still hold it
+		if (g_pCimomContext == NULL)
 		{
-			g_pCimomContext = new CmpiAdapter (context, g_pBroker);
+			CMPIContext *context = CBPrepareAttachThread (g_pBroker, ctx);
+			if (context != NULL)
+			{
+				g_pCimomContext = new CmpiAdapter (context, g_pBroker);
+			}
+		}
 
-			IndicationService *pService =
-					ProviderFactory::getSingleton()->getIndicationService();
-			pService->startIndicating(g_pCimomContext);
-			g_enabled++;
+		if (g_pCimomContext == NULL)
+		{
+			COMMON_LOG_ERROR("Failed to create indication subscription: "
+					"can't prepare a thread context");
+			CMSetStatusWithChars(g_pBroker, &status, CMPI_RC_ERR_FAILED,
+					"Can't prepare a thread context");
 		}
-		catch (Exception &e)
+		else
 		{
-			COMMON_LOG_ERROR_F("Failed to create indication subscription: %s", e.what());
-			CMSetStatusWithChars(g_pBroker, &status, CMPI_RC_ERR_FAILED, e.what());
+			try
+			{
+				IndicationService *pService =
+						ProviderFactory::getSingleton()->getIndicationService();
+				pService->startIndicating(g_pCimomContext);
+				g_enabled++;
+			}
+			catch (Exception &e)
+			{
+				COMMON_LOG_ERROR_F("Failed to create indication subscription: %s", e.what());
+				CMSetStatusWithChars(g_pBroker, &status, CMPI_RC_ERR_FAILED, e.what());
+			}
+		}
+
+		// the CIMOM won't deactivate a filter that failed to activate
+		if (status.rc != CMPI_RC_OK)
+		{
+			IndicationFilterRegistry::getSingleton().deactivate(query);
 		}
 	}
 	else
@@ -1038,8 +1289,15 @@ CMPIStatus Generic_DeActivateFilter(CMPIIndicationMI *mi,
 {
 	CMPIStatus status = {CMPI_RC_OK, 0};
 	LogEnterExit logging(__FILE__, __FUNCTION__, __LINE__);
-	g_enabled--;
-	if(g_enabled == 0)
+
+	IndicationFilterRegistry::getSingleton().deactivate(getFilterQuery(filter));
+
+	std::lock_guard<std::mutex> lock(g_indicationLock);
+	if (g_enabled == 0)
+	{
+		COMMON_LOG_WARN("Filter deactivated with no active subscriptions");
+	}
+	else if (--g_enabled == 0)
 	{
 		IndicationService *pService =
 				ProviderFactory::getSingleton()->getIndicationService();
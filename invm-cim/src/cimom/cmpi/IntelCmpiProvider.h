@@ -54,7 +54,7 @@ CMPIInstanceMI* name##_Provider_Create_InstanceMI(const CMPIBroker* brkr,const C
 			&name##_instance, \
 }; \
 g_pBroker=brkr; \
-wbem::framework::InstanceProviderInit(); \
+wbem::framework::InstanceProviderInit(ctx); \
 return &mi;  \
 }
 
@@ -140,7 +140,11 @@ namespace framework
  * Default implementation of CMPI methods - call these from your provider if you have no need for special behavior
  */
 
-void InstanceProviderInit();
+/*
+ * Called when the CIMOM creates the instance provider. Starts warming up the classes
+ * configured by the ProviderFactory in the background.
+ */
+void InstanceProviderInit(const CMPIContext *pContext);
 
 CMPIStatus Generic_Cleanup(CMPIInstanceMI *pThis, const CMPIContext *pContext, CMPIBoolean term);
 
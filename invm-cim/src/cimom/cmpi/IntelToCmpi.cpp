@@ -37,6 +37,8 @@
 #include <string.h>
 #include <stdbool.h>
 #include <time.h>
+#include <map>
+#include <mutex>
 #include <cmpi/cmpift.h>
 
 // Intel CIM Framework
@@ -78,39 +80,16 @@ CMPIInstance * intelToCmpi(const CMPIBroker * pBroker, wbem::framework::Instance
 	}
 	else
 	{
-		wbem::framework::ObjectPath objPath = pInstance->getObjectPath();
-		CMPIObjectPath *pObjPath = intelToCmpi(pBroker, &(objPath), pStatus);
+		std::string className = pInstance->getClass();
+		std::shared_ptr<const CmpiConversionPlan> pPlan = CmpiConversionPlan::getPlan(className,
+				pInstance->attributesBegin(), pInstance->attributesEnd());
 
-		if (pObjPath != NULL && pStatus->rc == CMPI_RC_OK)
+		bool planned = true;
+		pCmpiInstance = pPlan->convert(pBroker, *pInstance, pStatus, planned);
+		if (!planned)
 		{
-			pCmpiInstance = CMNewInstance (pBroker, pObjPath, pStatus);
-			if (pCmpiInstance != NULL && pStatus->rc == CMPI_RC_OK)
-			{
-				wbem::framework::attributes_t::const_iterator iAttribute = pInstance->attributesBegin();
-				for (; iAttribute != pInstance->attributesEnd(); iAttribute++)
-				{
-					std::string attrName = (*iAttribute).first;
-					wbem::framework::Attribute attr = (*iAttribute).second;
-					COMMON_LOG_DEBUG_F("Converting Attribute to CmpiAttribute: %s - %d",
-							attrName.c_str(), attr.getType());
-					CMPIData cmpiAttribute;
-
-					intelToCmpi(pBroker, &attr, &cmpiAttribute, pStatus);
-
-					if (pStatus->rc == CMPI_RC_OK)
-					{
-						CMSetProperty (pCmpiInstance, attrName.c_str(), &cmpiAttribute.value, cmpiAttribute.type);
-					}
-					else
-					{
-						COMMON_LOG_ERROR_F("Error (%d) converting instance property '%s' to CMPI", pStatus->rc, attrName.c_str());
-					}
-				}
-			}
-			else
-			{
-				COMMON_LOG_ERROR_F("CMPIInstance conversion failed for Object Path: %s", objPath.asString().c_str());
-			}
+			CmpiConversionPlan::extendPlan(className,
+					pInstance->attributesBegin(), pInstance->attributesEnd(), pPlan);
 		}
 	}
 	return pCmpiInstance;
@@ -118,7 +97,7 @@ CMPIInstance * intelToCmpi(const CMPIBroker * pBroker, wbem::framework::Instance
 }
 
 // Convert Attribute to CMPI Attribute
-void intelToCmpi(const CMPIBroker *pBroker, wbem::framework::Attribute *pAttribute, CMPIData *pCmpiAttribute, CMPIStatus *pStatus)
+void intelToCmpi(const CMPIBroker *pBroker, const wbem::framework::Attribute *pAttribute, CMPIData *pCmpiAttribute, CMPIStatus *pStatus)
 {
 	LogEnterExit logging(__FILE__, __FUNCTION__, __LINE__);
 
@@ -216,6 +195,13 @@ void intelToCmpi(const CMPIBroker *pBroker, wbem::framework::Attribute *pAttribu
 
 			break;
 		}
+		case wbem::framework::REFERENCE_T:
+		{
+			wbem::framework::ObjectPath path = pAttribute->referenceValue();
+			pCmpiAttribute->value.ref = intelToCmpi(pBroker, &path, pStatus);
+			pCmpiAttribute->type = CMPI_ref;
+			break;
+		}
 		case wbem::framework::DATETIME_INTERVAL_T:
 		case wbem::framework::DATETIME_T:
 		{
@@ -734,29 +720,16 @@ CMPIObjectPath *intelToCmpi(const CMPIBroker *pBroker, wbem::framework::ObjectPa
 	}
 	else
 	{
-		cmpiObjectPath = CMNewObjectPath (pBroker,
-				pObjectPath->getNamespace().c_str(), pObjectPath->getClass().c_str(), pStatus);
+		const std::string &className = pObjectPath->getClass();
+		const wbem::framework::attributes_t &keys = pObjectPath->getKeys();
+		std::shared_ptr<const CmpiConversionPlan> pPlan =
+				CmpiConversionPlan::getPlan(className, keys.begin(), keys.end());
 
-		if (pStatus->rc == CMPI_RC_OK)
+		bool planned = true;
+		cmpiObjectPath = pPlan->convert(pBroker, *pObjectPath, pStatus, planned);
+		if (!planned)
 		{
-			wbem::framework::attributes_t keys = pObjectPath->getKeys();
-			wbem::framework::attributes_t::iterator iKey = keys.begin();
-			for(; iKey != keys.end() && pStatus->rc == CMPI_RC_OK; iKey++)
-			{
-				wbem::framework::Attribute keyAttribute = iKey->second;
-				CMPIData cmpiAttribute;
-				CMPIStatus tempStatus;
-				intelToCmpi(pBroker, &keyAttribute, &cmpiAttribute, &tempStatus);
-				KEEP_ERR(*pStatus, tempStatus);
-				if (tempStatus.rc == CMPI_RC_OK)
-				{
-					CMAddKey(cmpiObjectPath, iKey->first.c_str(), &(cmpiAttribute.value), cmpiAttribute.type);
-				}
-			}
-		}
-		else
-		{
-			COMMON_LOG_ERROR("CMPI failed to create an Object Path");
+			CmpiConversionPlan::extendPlan(className, keys.begin(), keys.end(), pPlan);
 		}
 	}
 
@@ -867,5 +840,341 @@ void cmpiToIntel(const CMPIObjectPath *pCmpiObjectPath, wbem::framework::ObjectP
 		}
 	}
 }
+
+/*
+ * Converters for the slots of a plan, one per type
+ */
+static void convertBoolean(const CMPIBroker *pBroker, const Attribute &attribute,
+		CMPIValue *pValue, CMPIStatus *pStatus)
+{
+	pValue->boolean = attribute.boolValue();
+}
+
+static void convertUint8(const CMPIBroker *pBroker, const Attribute &attribute,
+		CMPIValue *pValue, CMPIStatus *pStatus)
+{
+	pValue->uint8 = attribute.uintValue();
+}
+
+static void convertUint16(const CMPIBroker *pBroker, const Attribute &attribute,
+		CMPIValue *pValue, CMPIStatus *pStatus)
+{
+	pValue->uint16 = attribute.uintValue();
+}
+
+static void convertUint32(const CMPIBroker *pBroker, const Attribute &attribute,
+		CMPIValue *pValue, CMPIStatus *pStatus)
+{
+	pValue->uint32 = attribute.uintValue();
+}
+
+static void convertUint64(const CMPIBroker *pBroker, const Attribute &attribute,
+		CMPIValue *pValue, CMPIStatus *pStatus)
+{
+	pValue->uint64 = attribute.uint64Value();
+}
+
+static void convertSint8(const CMPIBroker *pBroker, const Attribute &attribute,
+		CMPIValue *pValue, CMPIStatus *pStatus)
+{
+	pValue->sint8 = attribute.intValue();
+}
+
+static void convertSint16(const CMPIBroker *pBroker, const Attribute &attribute,
+		CMPIValue *pValue, CMPIStatus *pStatus)
+{
+	pValue->sint16 = attribute.intValue();
+}
+
+static void convertSint32(const CMPIBroker *pBroker, const Attribute &attribute,
+		CMPIValue *pValue, CMPIStatus *pStatus)
+{
+	pValue->sint32 = attribute.intValue();
+}
+
+static void convertSint64(const CMPIBroker *pBroker, const Attribute &attribute,
+		CMPIValue *pValue, CMPIStatus *pStatus)
+{
+	pValue->sint64 = attribute.sint64Value();
+}
+
+static void convertString(const CMPIBroker *pBroker, const Attribute &attribute,
+		CMPIValue *pValue, CMPIStatus *pStatus)
+{
+	pValue->string = CMNewString(pBroker, attribute.stringRef().c_str(), pStatus);
+}
+
+/*
+ * Get the CMPI type and the converter for a slot of the type. Types without one, such as
+ * lists and datetimes, are converted by intelToCmpi.
+ */
+static CmpiConversionPlan::converter_t getConverter(const enum DataType type,
+		CMPIType &cmpiType)
+{
+	CmpiConversionPlan::converter_t convert = NULL;
+	cmpiType = CMPI_null;
+	switch (type)
+	{
+	case BOOLEAN_T:
+		cmpiType = CMPI_boolean;
+		convert = convertBoolean;
+		break;
+	case UINT8_T:
+		cmpiType = CMPI_uint8;
+		convert = convertUint8;
+		break;
+	case ENUM16_T:
+	case UINT16_T:
+		cmpiType = CMPI_uint16;
+		convert = convertUint16;
+		break;
+	case ENUM_T:
+	case UINT32_T:
+		cmpiType = CMPI_uint32;
+		convert = convertUint32;
+		break;
+	case UINT64_T:
+		cmpiType = CMPI_uint64;
+		convert = convertUint64;
+		break;
+	case SINT8_T:
+		cmpiType = CMPI_sint8;
+		convert = convertSint8;
+		break;
+	case SINT16_T:
+		cmpiType = CMPI_sint16;
+		convert = convertSint16;
+		break;
+	case SINT32_T:
+		cmpiType = CMPI_sint32;
+		convert = convertSint32;
+		break;
+	case SINT64_T:
+		cmpiType = CMPI_sint64;
+		convert = convertSint64;
+		break;
+	case STR_T:
+		cmpiType = CMPI_string;
+		convert = convertString;
+		break;
+	default:
+		break;
+	}
+	return convert;
+}
+
+/*
+ * Plans by class name. A provider serves a fixed set of classes, so plans are never evicted.
+ */
+static std::mutex g_conversionPlansLock;
+static std::map<std::string, std::shared_ptr<const CmpiConversionPlan> > g_conversionPlans;
+
+CmpiConversionPlan::CmpiConversionPlan(attributes_t::const_iterator begin,
+		attributes_t::const_iterator end, const CmpiConversionPlan *pPrevious)
+{
+	// a map keeps the slots in the order of attributes_t
+	std::map<std::string, struct Slot> slots;
+	for (size_t i = 0; pPrevious && i < pPrevious->m_slots.size(); i++)
+	{
+		slots[pPrevious->m_slots[i].name] = pPrevious->m_slots[i];
+	}
+	for (attributes_t::const_iterator iAttribute = begin; iAttribute != end; iAttribute++)
+	{
+		struct Slot &slot = slots[iAttribute->first];
+		slot.name = iAttribute->first;
+		slot.type = iAttribute->second.getType();
+		slot.convert = getConverter(slot.type, slot.cmpiType);
+	}
+
+	m_slots.reserve(slots.size());
+	for (std::map<std::string, struct Slot>::const_iterator iSlot = slots.begin();
+			iSlot != slots.end(); iSlot++)
+	{
+		m_slots.push_back(iSlot->second);
+	}
+}
+
+CMPIInstance *CmpiConversionPlan::convert(const CMPIBroker *pBroker, const Instance &instance,
+		CMPIStatus *pStatus, bool &planned) const
+{
+	CMPIInstance *pCmpiInstance = NULL;
+
+	std::string cimNamespace = instance.getNamespace();
+	std::string className = instance.getClass();
+	CMPIObjectPath *pObjPath = CMNewObjectPath(pBroker,
+			cimNamespace.c_str(), className.c_str(), pStatus);
+	if (pObjPath != NULL && pStatus->rc == CMPI_RC_OK)
+	{
+		// convert each attribute once, adding the keys to the path on the way
+		std::vector<CMPIData> values(instance.attributesCount());
+		std::vector<CMPIrc> results(values.size());
+		size_t next = 0;
+		size_t i = 0;
+		for (attributes_t::const_iterator iAttribute = instance.attributesBegin();
+				iAttribute != instance.attributesEnd(); iAttribute++, i++)
+		{
+			CMPIStatus tempStatus;
+			convertValue(pBroker, findSlot(next, iAttribute->first, planned),
+					iAttribute->second, &values[i], &tempStatus);
+			results[i] = tempStatus.rc;
+			if (iAttribute->second.isKey())
+			{
+				KEEP_ERR(*pStatus, tempStatus);
+				if (tempStatus.rc == CMPI_RC_OK)
+				{
+					CMAddKey(pObjPath, iAttribute->first.c_str(),
+							&(values[i].value), values[i].type);
+				}
+			}
+		}
+
+		if (pStatus->rc == CMPI_RC_OK)
+		{
+			pCmpiInstance = CMNewInstance(pBroker, pObjPath, pStatus);
+		}
+		if (pCmpiInstance != NULL && pStatus->rc == CMPI_RC_OK)
+		{
+			i = 0;
+			for (attributes_t::const_iterator iAttribute = instance.attributesBegin();
+					iAttribute != instance.attributesEnd(); iAttribute++, i++)
+			{
+				// the status is that of the last property, as it was when converting one by one
+				pStatus->rc = results[i];
+				if (results[i] == CMPI_RC_OK)
+				{
+					CMSetProperty(pCmpiInstance, iAttribute->first.c_str(),
+							&(values[i].value), values[i].type);
+				}
+				else
+				{
+					COMMON_LOG_ERROR_F("Error (%d) converting instance property '%s' to CMPI",
+							results[i], iAttribute->first.c_str());
+				}
+			}
+		}
+		else
+		{
+			COMMON_LOG_ERROR_F("CMPIInstance conversion failed for Object Path: %s",
+					instance.getObjectPath().asString().c_str());
+		}
+	}
+	else
+	{
+		COMMON_LOG_ERROR("CMPI failed to create an Object Path");
+	}
+	return pCmpiInstance;
+}
+
+CMPIObjectPath *CmpiConversionPlan::convert(const CMPIBroker *pBroker, const ObjectPath &path,
+		CMPIStatus *pStatus, bool &planned) const
+{
+	CMPIObjectPath *cmpiObjectPath = CMNewObjectPath(pBroker,
+			path.getNamespace().c_str(), path.getClass().c_str(), pStatus);
+	if (pStatus->rc == CMPI_RC_OK)
+	{
+		const attributes_t &keys = path.getKeys();
+		size_t next = 0;
+		for (attributes_t::const_iterator iKey = keys.begin();
+				iKey != keys.end() && pStatus->rc == CMPI_RC_OK; iKey++)
+		{
+			CMPIData cmpiAttribute;
+			CMPIStatus tempStatus;
+			convertValue(pBroker, findSlot(next, iKey->first, planned),
+					iKey->second, &cmpiAttribute, &tempStatus);
+			KEEP_ERR(*pStatus, tempStatus);
+			if (tempStatus.rc == CMPI_RC_OK)
+			{
+				CMAddKey(cmpiObjectPath, iKey->first.c_str(),
+						&(cmpiAttribute.value), cmpiAttribute.type);
+			}
+		}
+	}
+	else
+	{
+		COMMON_LOG_ERROR("CMPI failed to create an Object Path");
+	}
+	return cmpiObjectPath;
+}
+
+std::shared_ptr<const CmpiConversionPlan> CmpiConversionPlan::getPlan(
+		const std::string &className,
+		attributes_t::const_iterator begin, attributes_t::const_iterator end)
+{
+	std::shared_ptr<const CmpiConversionPlan> pPlan;
+	{
+		std::lock_guard<std::mutex> lock(g_conversionPlansLock);
+		std::map<std::string, std::shared_ptr<const CmpiConversionPlan> >::const_iterator iPlan =
+				g_conversionPlans.find(className);
+		if (iPlan != g_conversionPlans.end())
+		{
+			pPlan = iPlan->second;
+		}
+	}
+
+	if (!pPlan)
+	{
+		// plan outside the lock; if two threads race, the first plan stored is kept
+		pPlan = std::shared_ptr<const CmpiConversionPlan>(
+				new CmpiConversionPlan(begin, end, NULL));
+		COMMON_LOG_DEBUG_F("Planned CMPI conversion of %s", className.c_str());
+
+		std::lock_guard<std::mutex> lock(g_conversionPlansLock);
+		g_conversionPlans.insert(std::make_pair(className, pPlan));
+	}
+	return pPlan;
+}
+
+void CmpiConversionPlan::extendPlan(const std::string &className,
+		attributes_t::const_iterator begin, attributes_t::const_iterator end,
+		const std::shared_ptr<const CmpiConversionPlan> &pPlan)
+{
+	std::shared_ptr<const CmpiConversionPlan> pExtended(
+			new CmpiConversionPlan(begin, end, pPlan.get()));
+
+	// unless another thread has already replaced it
+	std::lock_guard<std::mutex> lock(g_conversionPlansLock);
+	std::shared_ptr<const CmpiConversionPlan> &pCurrent = g_conversionPlans[className];
+	if (!pCurrent || pCurrent == pPlan)
+	{
+		pCurrent = pExtended;
+	}
+}
+
+const struct CmpiConversionPlan::Slot *CmpiConversionPlan::findSlot(size_t &next,
+		const std::string &name, bool &planned) const
+{
+	while (next < m_slots.size() && m_slots[next].name < name)
+	{
+		next++;
+	}
+
+	const struct Slot *pSlot = NULL;
+	if (next < m_slots.size() && m_slots[next].name == name)
+	{
+		pSlot = &m_slots[next++];
+	}
+	else
+	{
+		planned = false;
+	}
+	return pSlot;
+}
+
+void CmpiConversionPlan::convertValue(const CMPIBroker *pBroker, const struct Slot *pSlot,
+		const Attribute &attribute, CMPIData *pData, CMPIStatus *pStatus)
+{
+	if (pSlot && pSlot->convert && attribute.getType() == pSlot->type &&
+			!attribute.isEmbedded() && !attribute.isAssociationClassInstance())
+	{
+		pStatus->rc = CMPI_RC_OK;
+		pData->type = pSlot->cmpiType;
+		pSlot->convert(pBroker, attribute, &(pData->value), pStatus);
+	}
+	else
+	{
+		intelToCmpi(pBroker, &attribute, pData, pStatus);
+	}
+}
+
 }
 }
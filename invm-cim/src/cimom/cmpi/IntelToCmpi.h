@@ -30,6 +30,10 @@
  * WBEM implementation to CMPI.
  */
 
+#include <memory>
+#include <string>
+#include <vector>
+
 #include "Attribute.h"
 #include "Instance.h"
 #include "InstanceFactory.h"
@@ -79,7 +83,7 @@ CMPIInstance *intelToCmpi(const CMPIBroker * pBroker, wbem::framework::Instance
  * @param[in] pCmpiAttribute
  * @param[out] pRc
  */
-void intelToCmpi(const CMPIBroker * pBroker, wbem::framework::Attribute *pAttribute, CMPIData *pCmpiAttribute, CMPIStatus *pRc);
+void intelToCmpi(const CMPIBroker * pBroker, const wbem::framework::Attribute *pAttribute, CMPIData *pCmpiAttribute, CMPIStatus *pRc);
 
 /*!
  * Convert a CMPI Attribute to an Attribute.
@@ -117,5 +121,87 @@ wbem::framework::Instance *cmpiToIntel(const CMPIObjectPath *pCmpiObjectPath, co
  *		Returns true if attribute exists and is key
  */
 bool isAttributeKey(wbem::framework::Instance *pNewInstance, std::string attributeName);
+
+/*!
+ * How the attributes of one CIM class are converted to CMPI, worked out from the first
+ * instance or path of the class converted and reused for the rest. Each attribute has a slot
+ * holding its CMPI type and a converter for its value, so converting an instance is a walk
+ * over the slots instead of a type switch per attribute.
+ * @remarks A plan holds plain data only. The objects a CMPI broker creates are released
+ * when the provider call that created them returns, so they can't be reused.
+ */
+class CmpiConversionPlan
+{
+	public:
+		/*!
+		 * Converts an attribute of the type its slot was planned for
+		 */
+		typedef void (*converter_t)(const CMPIBroker *pBroker, const Attribute &attribute,
+				CMPIValue *pValue, CMPIStatus *pStatus);
+
+		/*!
+		 * An attribute of the class
+		 */
+		struct Slot
+		{
+			std::string name;
+			enum DataType type; //!< the attribute type the slot was planned for
+			CMPIType cmpiType; //!< CMPI type of the converted value
+			converter_t convert; //!< NULL if the type is converted by intelToCmpi
+		};
+
+		/*!
+		 * Plan the conversion of the attributes, and of the attributes of a previous plan
+		 * for the class if there is one.
+		 */
+		CmpiConversionPlan(attributes_t::const_iterator begin, attributes_t::const_iterator end,
+				const CmpiConversionPlan *pPrevious);
+
+		/*!
+		 * Convert an instance of the class.
+		 * @param[out] planned
+		 * 		Cleared if an attribute of the instance wasn't in the plan.
+		 */
+		CMPIInstance *convert(const CMPIBroker *pBroker, const Instance &instance,
+				CMPIStatus *pStatus, bool &planned) const;
+
+		/*!
+		 * Convert a path of an instance of the class.
+		 * @param[out] planned
+		 * 		Cleared if a key of the path wasn't in the plan.
+		 */
+		CMPIObjectPath *convert(const CMPIBroker *pBroker, const ObjectPath &path,
+				CMPIStatus *pStatus, bool &planned) const;
+
+		/*!
+		 * Get the plan for a class, planning it from the attributes the first time.
+		 */
+		static std::shared_ptr<const CmpiConversionPlan> getPlan(const std::string &className,
+				attributes_t::const_iterator begin, attributes_t::const_iterator end);
+
+		/*!
+		 * Replace the plan for a class with one that also covers the attributes, after
+		 * they were converted with a plan that didn't.
+		 */
+		static void extendPlan(const std::string &className,
+				attributes_t::const_iterator begin, attributes_t::const_iterator end,
+				const std::shared_ptr<const CmpiConversionPlan> &pPlan);
+
+	private:
+		std::vector<struct Slot> m_slots; //!< in the order of attributes_t
+
+		/*
+		 * Find the slot of an attribute. Attributes are visited in order, so the search
+		 * continues from next.
+		 */
+		const struct Slot *findSlot(size_t &next, const std::string &name, bool &planned) const;
+
+		/*
+		 * Convert an attribute using its slot, or with intelToCmpi if there isn't one or
+		 * the attribute isn't what the slot was planned for.
+		 */
+		static void convertValue(const CMPIBroker *pBroker, const struct Slot *pSlot,
+				const Attribute &attribute, CMPIData *pData, CMPIStatus *pStatus);
+};
 }
 }
@@ -327,6 +327,7 @@ HRESULT STDMETHODCALLTYPE wbem::wmi::IntelToWmi::ToWmiAttribute(wbem::framework:
 			break;
 		case wbem::framework::DATETIME_T:
 		case wbem::framework::DATETIME_INTERVAL_T:
+		case wbem::framework::REFERENCE_T:
 		case wbem::framework::STR_T:
 			v.vt = VT_BSTR;
 			v.bstrVal = SysAllocString(convert::str_to_wstr(attribute.stringValue()).c_str());
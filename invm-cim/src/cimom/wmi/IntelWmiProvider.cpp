@@ -245,7 +245,7 @@ SCODE wbem::wmi::IntelWmiProvider::CreateInstanceEnumAsync(
 				}
 				else
 				{
-					pProviderFactory->InitializeProvider();
+					pProviderFactory->beginAction();
 
 					// get the instance factory ...
 					wbem::framework::InstanceFactory *pFactory =
@@ -303,7 +303,7 @@ SCODE wbem::wmi::IntelWmiProvider::CreateInstanceEnumAsync(
 						}
 						delete pFactory;
 					}
-					pProviderFactory->CleanUpProvider();
+					pProviderFactory->endAction();
 				}
 				CoRevertToSelf();
 			}
@@ -354,7 +354,7 @@ SCODE wbem::wmi::IntelWmiProvider::GetObjectAsync(const BSTR ObjectPath, long lF
 				}
 				else
 				{
-					pProviderFactory->InitializeProvider();
+					pProviderFactory->beginAction();
 					// do the get, pass the object on to the notify
 					rc = GetByPath(ObjectPath, &pObj, pCtx);
 					if (rc == S_OK)
@@ -365,7 +365,7 @@ SCODE wbem::wmi::IntelWmiProvider::GetObjectAsync(const BSTR ObjectPath, long lF
 					}
 
 					rc = (bOK) ? S_OK : WBEM_E_NOT_FOUND;
-					pProviderFactory->CleanUpProvider();
+					pProviderFactory->endAction();
 				}
 				CoRevertToSelf();
 			}
@@ -566,7 +566,7 @@ HRESULT wbem::wmi::IntelWmiProvider::ExecMethodAsync(const BSTR strObjectPath,
 				}
 				else
 				{
-					pProviderFactory->InitializeProvider();
+					pProviderFactory->beginAction();
 					wbem::framework::InstanceFactory *pFactory =
 							pProviderFactory->getInstanceFactory(objectPath.getClass());
 					if (pFactory == NULL)
@@ -628,7 +628,7 @@ HRESULT wbem::wmi::IntelWmiProvider::ExecMethodAsync(const BSTR strObjectPath,
 						addMethodReturnCodeToReturnObject(className, strMethodName, pContext, pResponseHandler, wbemRc);
 						delete pFactory;
 					}
-					pProviderFactory->CleanUpProvider();
+					pProviderFactory->endAction();
 				}
 				CoRevertToSelf();
 			}
@@ -708,7 +708,7 @@ HRESULT STDMETHODCALLTYPE wbem::wmi::IntelWmiProvider::PutInstanceAsync(
 				}
 				else
 				{
-					pProviderFactory->InitializeProvider();
+					pProviderFactory->beginAction();
 
 					result = IntelToWmi::ToIntelInstance(path, newInstance, pInst);
 					wbem::framework::InstanceFactory *pFactory =
@@ -745,7 +745,7 @@ HRESULT STDMETHODCALLTYPE wbem::wmi::IntelWmiProvider::PutInstanceAsync(
 						}
 						delete pFactory;
 					}
-					pProviderFactory->CleanUpProvider();
+					pProviderFactory->endAction();
 				}
 				CoRevertToSelf();
 			}
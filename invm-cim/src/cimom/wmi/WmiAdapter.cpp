@@ -30,11 +30,12 @@
 #include "IntelToWmi.h"
 
 /*
- * WMI doesn't have an equivelant classIsA function, so just return false
+ * WMI doesn't have an equivelant classIsA function, so just answer false
  */
-bool classIsA(std::string child, std::string parent)
+bool cimomClassIsA(const std::string &child, const std::string &parent, bool &isA)
 {
-	return false;
+	isA = false;
+	return true;
 }
 
 void wbem::wmi::WmiAdapter::sendIndication(wbem::framework::Instance &indication)
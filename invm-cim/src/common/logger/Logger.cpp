@@ -35,6 +35,23 @@
 
 INVM_CIM_API wbem::framework::Logger wbem::framework::gLogger;
 
+namespace
+{
+	/*
+	 * A message being streamed to a logger. Each thread builds its own so concurrent
+	 * log statements can't interleave.
+	 */
+	struct PendingLogMessage
+	{
+		PendingLogMessage() : priority(wbem::framework::LogMessage::PRIORITY_INFO) {}
+
+		std::stringstream buffer;
+		wbem::framework::LogMessage::Priority priority;
+	};
+
+	thread_local PendingLogMessage t_pendingMessage;
+}
+
 wbem::framework::LogMessage::LogMessage(Priority priority, std::string message)
 : m_priority(priority), m_message(message), m_fileName(""), m_lineNumber(0)
 {
@@ -121,26 +138,39 @@ void wbem::framework::EsxLogChannel::write(const LogMessage& message)
 
 #endif
 
+std::stringstream &wbem::framework::Logger::buffer()
+{
+	return t_pendingMessage.buffer;
+}
+
+wbem::framework::LogMessage::Priority &wbem::framework::Logger::currentMessagePriority()
+{
+	return t_pendingMessage.priority;
+}
+
 void wbem::framework::Logger::flush()
 {
-	LogMessage message(m_currentMessagePriority, _buffer.str());
+	LogMessage message(currentMessagePriority(), buffer().str());
 	log(message);
-	_buffer.clear();
-	_buffer.str("");
+	buffer().clear();
+	buffer().str("");
 }
 
 void wbem::framework::Logger::setChannel(LogChannelBase* pChannel)
 {
+	std::lock_guard<std::mutex> lock(m_lock);
 	m_pChannel = pChannel;
 }
 
 wbem::framework::LogChannelBase* wbem::framework::Logger::getChannel()
 {
+	std::lock_guard<std::mutex> lock(m_lock);
 	return m_pChannel;
 }
 
 void wbem::framework::Logger::log(const LogMessage& message)
 {
+	std::lock_guard<std::mutex> lock(m_lock);
 	if (m_pChannel && (message.getPriority() <= m_level))
 	{
 		m_pChannel->write(message);
@@ -170,11 +200,13 @@ void wbem::framework::Logger::trace(const std::string& message,
 
 wbem::framework::LogMessage::Priority wbem::framework::Logger::getLevel() const
 {
+	std::lock_guard<std::mutex> lock(m_lock);
 	return m_level;
 }
 
 void wbem::framework::Logger::setLevel(const LogMessage::Priority& level)
 {
+	std::lock_guard<std::mutex> lock(m_lock);
 	m_level = level;
 }
 
@@ -38,6 +38,7 @@
 #include <string>
 #include <sstream>
 #include <iostream>
+#include <mutex>
 #ifdef __ESX__
 #include <syslog.h>
 #endif
@@ -224,6 +225,8 @@ class INVM_CIM_API EsxLogChannel : public LogChannelBase
  * Example Usage:
  * 		logger << LogMessage::PRIORITY_WARN << "This is a warning" << std::endl;
  * This example writes a "Warning" to whatever channel is set.
+ * The message being built and its priority are kept per thread, so threads logging at the same
+ * time don't mix their messages. Writes to the channel are serialized.
  */
 class INVM_CIM_API Logger
 {
@@ -233,7 +236,6 @@ public:
 	 */
 	Logger() :
 		m_pChannel(NULL),
-		m_currentMessagePriority(LogMessage::PRIORITY_INFO),
 		m_level(LogMessage::PRIORITY_INFO)
 	{
 	}
@@ -248,7 +250,7 @@ public:
     template<class T>
     Logger &operator << (const T &x)
     {
-        _buffer << x;
+        buffer() << x;
         return *this;
     }
 	/*!
@@ -261,7 +263,7 @@ public:
 	 */
     Logger &operator << (const enum LogMessage::Priority &prio)
     {
-    	m_currentMessagePriority = prio;
+    	currentMessagePriority() = prio;
     	return *this;
     }
 
@@ -275,7 +277,7 @@ public:
 	 */
     Logger &operator<<(std::ostream& (*endl) (std::ostream&))
     {
-    	_buffer << endl;
+    	buffer() << endl;
     	flush();
     	return *this;
     }
@@ -351,10 +353,19 @@ public:
 	void setLevel(const LogMessage::Priority &level);
 
 private:
-    std::stringstream _buffer;
+    /*!
+     * The message being built by the calling thread
+     */
+    std::stringstream &buffer();
+
+    /*!
+     * The priority of the message being built by the calling thread
+     */
+    LogMessage::Priority &currentMessagePriority();
+
     LogChannelBase *m_pChannel;
-    LogMessage::Priority m_currentMessagePriority;
     LogMessage::Priority m_level;
+    mutable std::mutex m_lock; // guards the channel and level
 };
 
 /*
@@ -36,6 +36,8 @@
 #include "ObjectPath.h"
 #include "ProviderFactory.h"
 #include "StringUtil.h"
+#include <mutex>
+#include <typeinfo>
 
 wbem::framework::AssociationFactory::AssociationFactory(
 	Instance *pInstance,
@@ -158,14 +160,93 @@ throw(framework::Exception)
 {
 	LogEnterExit logging(__FILE__, __FUNCTION__, __LINE__);
 	AssociationMapper mapper(ProviderFactory::getSingleton(),
-		m_classMap,
-		m_associationTable,
+		getAssociationGraph(),
 		m_cimNamespace, m_pInstance,
 		m_associationClassName, m_resultClassName, m_roleName, m_resultRoleName);
 
 	return mapper.getAssociationNames();
 }
 
+bool wbem::framework::AssociationFactory::joinsAssociationTable()
+{
+	return typeid(*this) == typeid(AssociationFactory);
+}
+
+/*
+ * The association join already holds the instances on both sides, so take them from there
+ */
+void wbem::framework::AssociationFactory::getAssociatedInstances(
+	framework::ObjectPath &objectPath, framework::instances_t &associatedInstances)
+{
+	LogEnterExit logging(__FILE__, __FUNCTION__, __LINE__);
+	if (m_pInstance == NULL || !joinsAssociationTable())
+	{
+		InstanceFactory::getAssociatedInstances(objectPath, associatedInstances);
+	}
+	else
+	{
+		AssociationMapper mapper(ProviderFactory::getSingleton(),
+			getAssociationGraph(),
+			m_cimNamespace, m_pInstance,
+			m_associationClassName, m_resultClassName, m_roleName, m_resultRoleName);
+
+		instances_t *pInstances = mapper.getAssociatedInstances();
+		associatedInstances.insert(associatedInstances.end(),
+			pInstances->begin(), pInstances->end());
+		delete pInstances;
+	}
+}
+
+void wbem::framework::AssociationFactory::getAssociatedInstances(
+	const framework::instances_t &sources, ClassEnumerationCache &cache,
+	framework::instances_t &associatedInstances, std::vector<size_t> &sourceIndexes)
+{
+	LogEnterExit logging(__FILE__, __FUNCTION__, __LINE__);
+	AssociationMapper mapper(ProviderFactory::getSingleton(),
+		getAssociationGraph(),
+		m_cimNamespace, m_pInstance,
+		m_associationClassName, m_resultClassName, m_roleName, m_resultRoleName);
+	mapper.setEnumerationCache(&cache);
+	mapper.getAssociatedInstances(sources, associatedInstances, sourceIndexes);
+}
+
+/*
+ * Association graphs, compiled once per concrete factory class
+ */
+namespace
+{
+	std::mutex g_associationGraphLock;
+	std::map<std::string, std::shared_ptr<const wbem::framework::AssociationGraph> >
+		g_associationGraphs;
+}
+
+std::shared_ptr<const wbem::framework::AssociationGraph>
+	wbem::framework::AssociationFactory::getAssociationGraph()
+{
+	LogEnterExit logging(__FILE__, __FUNCTION__, __LINE__);
+	std::string factoryClass = typeid(*this).name();
+
+	std::lock_guard<std::mutex> lock(g_associationGraphLock);
+	std::shared_ptr<const AssociationGraph> &pGraph = g_associationGraphs[factoryClass];
+	if (!pGraph)
+	{
+		pGraph = std::make_shared<AssociationGraph>(m_classMap, m_associationTable);
+		COMMON_LOG_DEBUG_F("Compiled association graph for %s with %d entries",
+			factoryClass.c_str(), (int) pGraph->getEdgeCount());
+	}
+	return pGraph;
+}
+
+void wbem::framework::AssociationFactory::warmUp(const std::string &className)
+{
+	LogEnterExit logging(__FILE__, __FUNCTION__, __LINE__);
+
+	InstanceFactory::warmUp(className);
+	std::shared_ptr<const AssociationGraph> pGraph = getAssociationGraph();
+	COMMON_LOG_DEBUG_F("Warmed up the association graph of %s, %d entries",
+			className.c_str(), (int)pGraph->getEdgeCount());
+}
+
 
 /*
  * Use the Association Class name to find the appropriate attributes to use.
@@ -215,9 +296,7 @@ bool wbem::framework::AssociationFactory::simpleFkMatch(
 	Instance *pAntInstance, const std::string &antFk,
 	Instance *pDepInstance, const std::string &depFk)
 {
-	LogEnterExit logging(__FILE__, __FUNCTION__, __LINE__);
-	return filteredFkMatch(pAntInstance, antFk, std::vector<std::string>(),
-		pDepInstance, depFk, std::vector<std::string>());
+	return AssociationMapper::simpleFkMatch(pAntInstance, antFk, pDepInstance, depFk);
 }
 
 /*
@@ -227,13 +306,8 @@ bool wbem::framework::AssociationFactory::filteredFkMatch(
 	Instance *pAntInstance, const std::string &antFk, const std::string &antFkFilter,
 	Instance *pDepInstance, const std::string &depFk, const std::string &depFkFilter)
 {
-	LogEnterExit logging(__FILE__, __FUNCTION__, __LINE__);
-	std::vector<std::string> antFkFilterList;
-	std::vector<std::string> depFkFilterList;
-	antFkFilterList.push_back(antFkFilter);
-	depFkFilterList.push_back(depFkFilter);
-	return filteredFkMatch(pAntInstance, antFk, antFkFilterList,
-		pDepInstance, depFk, depFkFilterList);
+	return AssociationMapper::filteredFkMatch(pAntInstance, antFk, antFkFilter,
+		pDepInstance, depFk, depFkFilter);
 }
 
 
@@ -244,18 +318,8 @@ bool wbem::framework::AssociationFactory::filteredFkMatch(
 	Instance *pAntInstance, const std::string &antFk, const std::vector<std::string> &antFkFilter,
 	Instance *pDepInstance, const std::string &depFk, const std::vector<std::string> &depFkFilter)
 {
-	LogEnterExit logging(__FILE__, __FUNCTION__, __LINE__);
-	bool result = false;
-	framework::Attribute antAttribute;
-	framework::Attribute depAttribute;
-	if (pAntInstance->getAttribute(antFk, antAttribute) == framework::SUCCESS &&
-		pDepInstance->getAttribute(depFk, depAttribute) == framework::SUCCESS)
-	{
-		std::string antString = StringUtil::removeStrings(antAttribute.asStr(), antFkFilter);
-		std::string depString = StringUtil::removeStrings(depAttribute.asStr(), depFkFilter);
-		result = (antString == depString);
-	}
-	return result;
+	return AssociationMapper::filteredFkMatch(pAntInstance, antFk, antFkFilter,
+		pDepInstance, depFk, depFkFilter);
 }
 
 void wbem::framework::AssociationFactory::addClassToMap(const std::string &className,
@@ -276,6 +340,18 @@ void wbem::framework::AssociationFactory::addAssociationToTable(const std::strin
 	m_associationTable.push_back(assoc);
 }
 
+void wbem::framework::AssociationFactory::addAssociationToTable(const std::string &className,
+	const std::string &antecedentClass, const std::string &dependentClass,
+	const std::string &antecedentFk, const std::vector<std::string> &antecedentFkFilter,
+	const std::string &dependentFk, const std::vector<std::string> &dependentFkFilter)
+{
+	struct associationMap assoc = {className, ASSOCIATIONTYPE_FILTEREDFK,
+								   antecedentClass, dependentClass,
+								   antecedentFk, dependentFk,
+								   antecedentFkFilter, dependentFkFilter};
+	m_associationTable.push_back(assoc);
+}
+
 void wbem::framework::AssociationFactory::markInstanceAttributesAsAssociationRefs(
 		framework::Instance& instance)
 {
@@ -34,6 +34,7 @@
 #ifndef _WBEM_FRAMEWORK_NVMASSOCIATIONFACTORY_H
 #define _WBEM_FRAMEWORK_NVMASSOCIATIONFACTORY_H
 #include <string>
+#include <memory>
 #include "Instance.h"
 #include "InstanceFactory.h"
 #include "AssociationMapper.h"
@@ -106,6 +107,45 @@ public:
 	 */
 	virtual framework::instance_names_t* getInstanceNames() throw (framework::Exception);
 
+	/*!
+	 * Returns true if the associations of this factory are exactly those found by joining
+	 * the association table, so associated instances can be taken straight from the join.
+	 * @remarks True for an AssociationFactory itself. A subclass may have its own
+	 * association logic in getInstanceNames, so it opts in by overriding this.
+	 */
+	virtual bool joinsAssociationTable();
+
+	/*!
+	 * Get the associated instances straight from the association join, instead of
+	 * building association names and fetching each referenced instance again. Only done
+	 * if joinsAssociationTable returns true.
+	 */
+	virtual void getAssociatedInstances(framework::ObjectPath &objectPath,
+		framework::instances_t &associatedInstances);
+
+	/*!
+	 * Get the instances associated with each of a set of source instances with one join per
+	 * association table entry. The sources must be of the same class as the instance this
+	 * factory was created for. Only call it if joinsAssociationTable returns true.
+	 * @param[in] sources
+	 * 		The source instances.
+	 * @param[in] cache
+	 * 		Class enumerations shared with the other joins of the request.
+	 * @param[out] associatedInstances
+	 * 		The associated instances are added to this list.
+	 * @param[out] sourceIndexes
+	 * 		The index in sources of the instance each associated instance was found for.
+	 */
+	virtual void getAssociatedInstances(const framework::instances_t &sources,
+		ClassEnumerationCache &cache,
+		framework::instances_t &associatedInstances, std::vector<size_t> &sourceIndexes);
+
+	/*
+	 * Also compiles the association graph, which every associators and references
+	 * request reads.
+	 */
+	virtual void warmUp(const std::string &className);
+
 	/*!
 	 * Used in the getInstanceFactory. It simply looks at the association table
 	 * and checks if the className is an Association Class
@@ -176,6 +216,17 @@ public:
 protected:
 	virtual void populateAttributeList(framework::attribute_names_t &attributes) throw (framework::Exception);
 
+	// The attribute list depends on the association class being asked for
+	virtual std::string getSupportedAttributesVariant() { return m_associationClassName; }
+
+	/*!
+	 * Get the association graph compiled from m_classMap and m_associationTable. The
+	 * tables are the same for every instance of a factory class, so the graph is built
+	 * once per concrete factory class and shared by every request after that.
+	 * @return the compiled graph
+	 */
+	std::shared_ptr<const AssociationGraph> getAssociationGraph();
+
 	std::string m_associationClassName;
 	std::string m_resultClassName;
 	std::string m_roleName;
@@ -202,6 +253,15 @@ protected:
 			const std::string &antecedentClass, const std::string &dependentClass,
 			const std::string &antecedentFk = "", const std::string &dependentFk = "");
 
+	/*
+	 * Add an association whose instances match when their FK values are equal after
+	 * removing the filter strings from each side.
+	 */
+	void addAssociationToTable(const std::string &className,
+			const std::string &antecedentClass, const std::string &dependentClass,
+			const std::string &antecedentFk, const std::vector<std::string> &antecedentFkFilter,
+			const std::string &dependentFk, const std::vector<std::string> &dependentFkFilter);
+
 	void markInstanceAttributesAsAssociationRefs(framework::Instance &instance);
 
 };
@@ -0,0 +1,192 @@
+/*
+ * Copyright (c) 2015 2016, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of Intel Corporation nor the names of its contributors
+ *     may be used to endorse or promote products derived from this software
+ *     without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * This file contains the implementation of the compiled association table index.
+ */
+
+#include <algorithm>
+
+#include "AssociationGraph.h"
+
+namespace wbem
+{
+namespace framework
+{
+
+FkNormalizer::FkNormalizer(const std::string &fk, const std::vector<std::string> &filter) :
+	m_fk(fk)
+{
+	// removing an empty string is a no-op
+	for (size_t i = 0; i < filter.size(); i++)
+	{
+		if (!filter[i].empty())
+		{
+			m_filter.push_back(filter[i]);
+		}
+	}
+}
+
+FkNormalizer::FkNormalizer(const std::string &fk, const std::string &filter) :
+	m_fk(fk)
+{
+	if (!filter.empty())
+	{
+		m_filter.push_back(filter);
+	}
+}
+
+/*
+ * Same result as StringUtil::removeStrings, but erases in place instead of copying the
+ * filter list and the value. Called for every instance of a join, so no log tracing.
+ */
+bool FkNormalizer::getValue(const Instance &instance, std::string &value) const
+{
+	bool found = false;
+	Attribute attribute;
+	if (instance.getAttribute(m_fk, attribute) == SUCCESS)
+	{
+		value = attribute.asStr();
+		for (size_t i = 0; i < m_filter.size(); i++)
+		{
+			if (m_filter[i].length() <= value.length())
+			{
+				size_t pos = value.find(m_filter[i]);
+				if (pos != std::string::npos)
+				{
+					value.erase(pos, m_filter[i].length());
+				}
+			}
+		}
+		found = true;
+	}
+	return found;
+}
+
+AssociationGraph::AssociationGraph(
+	const std::map<std::string, struct associationClass> &classMap,
+	const std::vector<struct associationMap> &associationTable) :
+	m_classMap(classMap)
+{
+	m_edges.reserve(associationTable.size());
+	for (size_t i = 0; i < associationTable.size(); i++)
+	{
+		AssociationEdge edge;
+		edge.index = i;
+		edge.association = associationTable[i];
+
+		std::map<std::string, struct associationClass>::const_iterator assocClass =
+			classMap.find(edge.association.associationClassName);
+		edge.isConfigured = assocClass != classMap.end();
+		if (edge.isConfigured)
+		{
+			edge.associationClass = assocClass->second;
+		}
+		if (edge.association.type == ASSOCIATIONTYPE_SIMPLEFK)
+		{
+			edge.antecedentFk = FkNormalizer(edge.association.antecedentFk,
+				std::vector<std::string>());
+			edge.dependentFk = FkNormalizer(edge.association.dependentFk,
+				std::vector<std::string>());
+		}
+		else if (edge.association.type == ASSOCIATIONTYPE_FILTEREDFK)
+		{
+			edge.antecedentFk = FkNormalizer(edge.association.antecedentFk,
+				edge.association.antecedentFkFilter);
+			edge.dependentFk = FkNormalizer(edge.association.dependentFk,
+				edge.association.dependentFkFilter);
+		}
+		m_edges.push_back(edge);
+
+		m_byAntecedent[edge.association.antecedentClassName].push_back(i);
+		m_byDependent[edge.association.dependentClassName].push_back(i);
+		m_byAssociationClass[edge.association.associationClassName].push_back(i);
+	}
+}
+
+void AssociationGraph::addEdges(const edge_index_t &index, const std::string &key,
+	std::vector<size_t> &edgeIndexes)
+{
+	edge_index_t::const_iterator iter = index.find(key);
+	if (iter != index.end())
+	{
+		edgeIndexes.insert(edgeIndexes.end(), iter->second.begin(), iter->second.end());
+	}
+}
+
+void AssociationGraph::getEdges(const std::string &className,
+	const std::string &associationClassName,
+	std::vector<const AssociationEdge *> &edges) const
+{
+	std::vector<size_t> edgeIndexes;
+	if (!className.empty())
+	{
+		// a class can be both the antecedent and dependent of the same entry
+		addEdges(m_byAntecedent, className, edgeIndexes);
+		addEdges(m_byDependent, className, edgeIndexes);
+		std::sort(edgeIndexes.begin(), edgeIndexes.end());
+		edgeIndexes.erase(std::unique(edgeIndexes.begin(), edgeIndexes.end()),
+			edgeIndexes.end());
+	}
+	else if (!associationClassName.empty())
+	{
+		addEdges(m_byAssociationClass, associationClassName, edgeIndexes);
+	}
+	else
+	{
+		for (size_t i = 0; i < m_edges.size(); i++)
+		{
+			edgeIndexes.push_back(i);
+		}
+	}
+
+	for (size_t i = 0; i < edgeIndexes.size(); i++)
+	{
+		const AssociationEdge &edge = m_edges[edgeIndexes[i]];
+		if (associationClassName.empty() ||
+			edge.association.associationClassName == associationClassName)
+		{
+			edges.push_back(&edge);
+		}
+	}
+}
+
+const struct associationClass *AssociationGraph::findAssociationClass(
+	const std::string &className) const
+{
+	const struct associationClass *pResult = NULL;
+	std::map<std::string, struct associationClass>::const_iterator iter =
+		m_classMap.find(className);
+	if (iter != m_classMap.end())
+	{
+		pResult = &iter->second;
+	}
+	return pResult;
+}
+
+}
+}
@@ -0,0 +1,196 @@
+/*
+ * Copyright (c) 2015 2016, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of Intel Corporation nor the names of its contributors
+ *     may be used to endorse or promote products derived from this software
+ *     without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * This file defines the association tables used to build association instances and an
+ * index over them that is compiled once per provider load.
+ */
+
+#ifndef INTEL_CIM_FRAMEWORK_ASSOCIATIONGRAPH_H
+#define INTEL_CIM_FRAMEWORK_ASSOCIATIONGRAPH_H
+
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Instance.h"
+#include "Export.h"
+
+namespace wbem
+{
+namespace framework
+{
+
+/*!
+ * Type of association defined in the Association table
+ */
+enum associationType
+{
+	ASSOCIATIONTYPE_BASIC,   //!< ASSOCIATIONTYPE_BASIC
+	ASSOCIATIONTYPE_SIMPLEFK, //!< ASSOCIATIONTYPE_SIMPLEFK
+	ASSOCIATIONTYPE_COMPLEX,  //!< ASSOCIATIONTYPE_COMPLEX
+	ASSOCIATIONTYPE_FILTEREDFK //!< ASSOCIATIONTYPE_FILTEREDFK
+};
+
+/*!
+ * Represents an Association Class
+ */
+struct associationClass
+{
+	std::string className; //!< Name of class
+	std::string antecedentPropertyName; //!< Name of the antecedent property
+	std::string dependentPropertyName; //!< Name of the dependent property
+};
+
+/*!
+ * Data structure to contain the mapping data to dynamically build associations and association
+ * class instances
+ */
+struct associationMap
+{
+	std::string associationClassName; //!< name of the association class
+	enum associationType type; //!< information on how to determine if instances are associated
+	std::string antecedentClassName; //!< defines the reference to the antecedent
+	std::string dependentClassName;  //!< defines the reference to the dependent
+	std::string antecedentFk; //!< Type SimpleFk requires antecedentFK
+	std::string dependentFk; //!< Type SimpleFk requires dependentFK
+	std::vector<std::string> antecedentFkFilter; //!< Type FilteredFk strings removed from antecedentFK
+	std::vector<std::string> dependentFkFilter; //!< Type FilteredFk strings removed from dependentFK
+};
+
+/*!
+ * Extracts the value an FK association joins on: the FK attribute of an instance with the
+ * filter strings removed. Built once per association table entry so the join doesn't
+ * rebuild the filter list for every instance.
+ */
+class INVM_CIM_API FkNormalizer
+{
+	public:
+		FkNormalizer() {}
+
+		/*!
+		 * @param[in] fk
+		 * 		The name of the FK attribute.
+		 * @param[in] filter
+		 * 		Strings removed from the FK value, in order, first occurrence only.
+		 */
+		FkNormalizer(const std::string &fk, const std::vector<std::string> &filter);
+
+		/*!
+		 * @param[in] fk
+		 * 		The name of the FK attribute.
+		 * @param[in] filter
+		 * 		A string removed from the FK value, first occurrence only.
+		 */
+		FkNormalizer(const std::string &fk, const std::string &filter);
+
+		/*!
+		 * Get the normalized FK value of an instance.
+		 * @param[out] value
+		 * 		The normalized value. Its buffer is reused, so pass the same string for
+		 * 		each instance of a join.
+		 * @return false if the instance doesn't have the FK attribute.
+		 */
+		bool getValue(const Instance &instance, std::string &value) const;
+
+	private:
+		std::string m_fk;
+		std::vector<std::string> m_filter;
+};
+
+/*!
+ * An entry of the association table joined with its association class.
+ */
+struct AssociationEdge
+{
+	size_t index; //!< position in the association table
+	struct associationMap association; //!< the association table entry
+	bool isConfigured; //!< false if the association class is missing from the class map
+	struct associationClass associationClass; //!< role (property) names of the association class
+	FkNormalizer antecedentFk; //!< FK value of an antecedent, for the FK association types
+	FkNormalizer dependentFk; //!< FK value of a dependent, for the FK association types
+};
+
+/*!
+ * Immutable index over an association table, keyed by antecedent, dependent and association
+ * class so a request only looks at the entries that can apply to it.
+ */
+class INVM_CIM_API AssociationGraph
+{
+	public:
+		/*!
+		 * Compile the association tables.
+		 * @param[in] classMap
+		 * 		The association classes with the names of their properties.
+		 * @param[in] associationTable
+		 * 		All possible associations between the classes in the provider.
+		 */
+		AssociationGraph(const std::map<std::string, struct associationClass> &classMap,
+				const std::vector<struct associationMap> &associationTable);
+
+		/*!
+		 * Find the association table entries that could apply to a request.
+		 * @param[in] className
+		 * 		The class of the instance the request is about, or empty for all classes.
+		 * @param[in] associationClassName
+		 * 		Only return entries for this association class, or empty for all.
+		 * @param[out] edges
+		 * 		The matching entries, in association table order.
+		 */
+		void getEdges(const std::string &className, const std::string &associationClassName,
+				std::vector<const AssociationEdge *> &edges) const;
+
+		/*!
+		 * Look up an association class.
+		 * @return
+		 * 		The association class or NULL if it isn't in the class map.
+		 */
+		const struct associationClass *findAssociationClass(const std::string &className) const;
+
+		/*!
+		 * The number of entries in the association table.
+		 */
+		size_t getEdgeCount() const { return m_edges.size(); }
+
+	private:
+		typedef std::unordered_map<std::string, std::vector<size_t> > edge_index_t;
+
+		static void addEdges(const edge_index_t &index, const std::string &key,
+				std::vector<size_t> &edgeIndexes);
+
+		std::vector<AssociationEdge> m_edges;
+		std::map<std::string, struct associationClass> m_classMap;
+		edge_index_t m_byAntecedent;
+		edge_index_t m_byDependent;
+		edge_index_t m_byAssociationClass;
+};
+
+} // framework
+} // wbem
+
+#endif //INTEL_CIM_FRAMEWORK_ASSOCIATIONGRAPH_H
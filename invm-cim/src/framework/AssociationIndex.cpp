@@ -0,0 +1,390 @@
+/*
+ * Copyright (c) 2015 2016, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of Intel Corporation nor the names of its contributors
+ *     may be used to endorse or promote products derived from this software
+ *     without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * This file contains the implementation of the association index.
+ */
+
+#include <logger/logging.h>
+#include "AssociationIndex.h"
+#include "ObjectPathBuilder.h"
+#include "ProviderFactory.h"
+
+namespace wbem
+{
+namespace framework
+{
+
+/*
+ * Key of a request within the results of its source instance
+ */
+static std::string getQueryKey(const enum associationIndexKind kind,
+		const std::string &associationClassName, const std::string &resultClassName,
+		const std::string &roleName, const std::string &resultRoleName)
+{
+	std::string key(1, (char)('0' + kind));
+	key += '\n' + associationClassName + '\n' + resultClassName +
+			'\n' + roleName + '\n' + resultRoleName;
+	return key;
+}
+
+/*
+ * An association object refers to the instances in its keys. Older providers keep those
+ * references as strings.
+ */
+static void getReferencedPaths(const ObjectPath &path, std::vector<ObjectPath> &paths)
+{
+	attributes_t keys = path.getKeys();
+	for (attributes_t::const_iterator iKey = keys.begin(); iKey != keys.end(); iKey++)
+	{
+		if (iKey->second.getType() == REFERENCE_T)
+		{
+			paths.push_back(iKey->second.referenceValue());
+		}
+		else if (iKey->second.getType() == STR_T)
+		{
+			ObjectPath referencedPath;
+			if (ObjectPathBuilder(iKey->second.stringValue()).Build(&referencedPath))
+			{
+				paths.push_back(referencedPath);
+			}
+		}
+	}
+}
+
+AssociationIndex::AssociationIndex() : m_generation(0)
+{
+}
+
+AssociationIndex &AssociationIndex::getSingleton()
+{
+	static AssociationIndex index;
+	return index;
+}
+
+UINT64 AssociationIndex::getGeneration()
+{
+	std::lock_guard<std::mutex> lock(m_lock);
+	return m_generation;
+}
+
+bool AssociationIndex::find(const enum associationIndexKind kind, const ObjectPath &objectPath,
+		const std::string &associationClassName, const std::string &resultClassName,
+		const std::string &roleName, const std::string &resultRoleName,
+		AssociationIndexEntry &entry)
+{
+	std::lock_guard<std::mutex> lock(m_lock);
+	bool found = false;
+	sources_t::const_iterator iSource = m_sources.find(objectPath);
+	if (iSource != m_sources.end())
+	{
+		queries_t::const_iterator iQuery = iSource->second.find(getQueryKey(kind,
+				associationClassName, resultClassName, roleName, resultRoleName));
+		if (iQuery != iSource->second.end())
+		{
+			entry = iQuery->second;
+			found = true;
+		}
+	}
+	return found;
+}
+
+void AssociationIndex::add(const enum associationIndexKind kind, const ObjectPath &objectPath,
+		const std::string &associationClassName, const std::string &resultClassName,
+		const std::string &roleName, const std::string &resultRoleName,
+		const AssociationIndexEntry &entry, const UINT64 generation)
+{
+	// the instances the result mentions: the associated instances, or both ends of each reference
+	std::vector<ObjectPath> mentionedPaths;
+	for (instance_names_t::const_iterator iPath = entry.paths.begin();
+			iPath != entry.paths.end(); iPath++)
+	{
+		mentionedPaths.push_back(*iPath);
+		getReferencedPaths(*iPath, mentionedPaths);
+	}
+	if (kind == ASSOCIATIONINDEXKIND_ASSOCIATORS)
+	{
+		for (instances_t::const_iterator iInstance = entry.instances.begin();
+				iInstance != entry.instances.end(); iInstance++)
+		{
+			mentionedPaths.push_back(iInstance->getObjectPath());
+		}
+	}
+
+	std::lock_guard<std::mutex> lock(m_lock);
+	// an instance changed while the result was being computed
+	if (generation != m_generation)
+	{
+		return;
+	}
+
+	if (m_sources.size() >= ASSOCIATION_INDEX_MAX_SOURCES &&
+			m_sources.find(objectPath) == m_sources.end())
+	{
+		COMMON_LOG_DEBUG("Association index is full, starting over");
+		clearLocked();
+	}
+
+	m_sources[objectPath][getQueryKey(kind, associationClassName, resultClassName,
+			roleName, resultRoleName)] = entry;
+	for (size_t i = 0; i < mentionedPaths.size(); i++)
+	{
+		m_referrers[mentionedPaths[i]].insert(objectPath);
+	}
+}
+
+void AssociationIndex::instanceCreated(const ObjectPath &path)
+{
+	LogEnterExit logging(__FILE__, __FUNCTION__, __LINE__);
+	{
+		std::lock_guard<std::mutex> lock(m_lock);
+		m_generation++;
+	}
+
+	// the new instance only changes the results of the instances it is associated with
+	path_set_t neighbours;
+	getNeighbours(path, neighbours);
+
+	std::lock_guard<std::mutex> lock(m_lock);
+	dropSource(path);
+	dropEndpoints(path);
+	for (path_set_t::const_iterator iNeighbour = neighbours.begin();
+			iNeighbour != neighbours.end(); iNeighbour++)
+	{
+		dropSource(*iNeighbour);
+	}
+}
+
+void AssociationIndex::instanceDeleted(const ObjectPath &path)
+{
+	LogEnterExit logging(__FILE__, __FUNCTION__, __LINE__);
+	std::lock_guard<std::mutex> lock(m_lock);
+	m_generation++;
+	dropSource(path);
+	dropEndpoints(path);
+	removeFromResults(path);
+}
+
+void AssociationIndex::instanceModified(const ObjectPath &path)
+{
+	LogEnterExit logging(__FILE__, __FUNCTION__, __LINE__);
+	{
+		std::lock_guard<std::mutex> lock(m_lock);
+		m_generation++;
+	}
+
+	// a modified instance may have moved from its old neighbours to new ones
+	path_set_t neighbours;
+	getNeighbours(path, neighbours);
+
+	std::lock_guard<std::mutex> lock(m_lock);
+	dropSource(path);
+	dropEndpoints(path);
+	dropReferrers(path);
+	for (path_set_t::const_iterator iNeighbour = neighbours.begin();
+			iNeighbour != neighbours.end(); iNeighbour++)
+	{
+		dropSource(*iNeighbour);
+	}
+}
+
+void AssociationIndex::clear()
+{
+	std::lock_guard<std::mutex> lock(m_lock);
+	m_generation++;
+	clearLocked();
+}
+
+/*
+ * Find the instances associated with path by asking the association factories directly.
+ * If they can't be found every result is dropped, since any of them could be stale.
+ */
+void AssociationIndex::getNeighbours(const ObjectPath &path, path_set_t &neighbours)
+{
+	LogEnterExit logging(__FILE__, __FUNCTION__, __LINE__);
+	ProviderFactory *pProviderFactory = ProviderFactory::getSingleton();
+	InstanceFactory *pFactory = pProviderFactory ?
+			pProviderFactory->getInstanceFactory(path.getClass()) : NULL;
+	if (!pFactory)
+	{
+		COMMON_LOG_WARN_F("No factory for %s, dropping the association index",
+				path.getClass().c_str());
+		clear();
+		return;
+	}
+
+	Instance *pInstance = NULL;
+	std::vector<InstanceFactory *> associationFactories;
+	try
+	{
+		ObjectPath instancePath = path;
+		attribute_names_t attributes;
+		pInstance = pFactory->getInstance(instancePath, attributes);
+		associationFactories = ProviderFactory::getAssociationFactoriesStatic(
+				pInstance, "", "", "", "");
+		for (size_t i = 0; i < associationFactories.size(); i++)
+		{
+			if (associationFactories[i])
+			{
+				instance_names_t *pAssociationNames = associationFactories[i]->getInstanceNames();
+				if (pAssociationNames)
+				{
+					std::vector<ObjectPath> referencedPaths;
+					for (instance_names_t::const_iterator iName = pAssociationNames->begin();
+							iName != pAssociationNames->end(); iName++)
+					{
+						getReferencedPaths(*iName, referencedPaths);
+					}
+					delete pAssociationNames;
+					neighbours.insert(referencedPaths.begin(), referencedPaths.end());
+				}
+			}
+		}
+	}
+	catch (Exception &e)
+	{
+		COMMON_LOG_WARN_F("Couldn't find the associations of %s, dropping the association index: %s",
+				path.asString().c_str(), e.what());
+		clear();
+	}
+
+	for (size_t i = 0; i < associationFactories.size(); i++)
+	{
+		delete associationFactories[i];
+	}
+	delete pInstance;
+	delete pFactory;
+	neighbours.erase(path);
+}
+
+/*
+ * Forget the results of the requests about an instance
+ */
+void AssociationIndex::dropSource(const ObjectPath &path)
+{
+	m_sources.erase(path);
+}
+
+/*
+ * If the instance is an association object, forget the results of the instances it
+ * associates, they gain or lose the object and the instance at its other end
+ */
+void AssociationIndex::dropEndpoints(const ObjectPath &path)
+{
+	std::vector<ObjectPath> endpoints;
+	getReferencedPaths(path, endpoints);
+	for (size_t i = 0; i < endpoints.size(); i++)
+	{
+		dropSource(endpoints[i]);
+	}
+}
+
+/*
+ * Forget the results an instance appears in
+ */
+void AssociationIndex::dropReferrers(const ObjectPath &path)
+{
+	referrers_t::iterator iReferrers = m_referrers.find(path);
+	if (iReferrers != m_referrers.end())
+	{
+		for (path_set_t::const_iterator iSource = iReferrers->second.begin();
+				iSource != iReferrers->second.end(); iSource++)
+		{
+			dropSource(*iSource);
+		}
+		m_referrers.erase(iReferrers);
+	}
+}
+
+/*
+ * Take a deleted instance, and the references to it, out of the results it appears in
+ */
+void AssociationIndex::removeFromResults(const ObjectPath &path)
+{
+	ObjectPathEqual equal;
+	referrers_t::iterator iReferrers = m_referrers.find(path);
+	if (iReferrers == m_referrers.end())
+	{
+		return;
+	}
+
+	for (path_set_t::const_iterator iSource = iReferrers->second.begin();
+			iSource != iReferrers->second.end(); iSource++)
+	{
+		sources_t::iterator iQueries = m_sources.find(*iSource);
+		if (iQueries == m_sources.end())
+		{
+			continue;
+		}
+
+		for (queries_t::iterator iQuery = iQueries->second.begin();
+				iQuery != iQueries->second.end(); iQuery++)
+		{
+			AssociationIndexEntry &entry = iQuery->second;
+			bool isAssociators = iQuery->first[0] == (char)('0' + ASSOCIATIONINDEXKIND_ASSOCIATORS);
+			AssociationIndexEntry remaining;
+			for (size_t i = 0; i < entry.instances.size() || i < entry.paths.size(); i++)
+			{
+				ObjectPath resultPath = i < entry.paths.size() ?
+						entry.paths[i] : entry.instances[i].getObjectPath();
+				bool mentioned = equal(resultPath, path);
+				std::vector<ObjectPath> referencedPaths;
+				if (!isAssociators)
+				{
+					getReferencedPaths(resultPath, referencedPaths);
+				}
+				for (size_t r = 0; r < referencedPaths.size() && !mentioned; r++)
+				{
+					mentioned = equal(referencedPaths[r], path);
+				}
+
+				if (!mentioned)
+				{
+					if (i < entry.paths.size())
+					{
+						remaining.paths.push_back(entry.paths[i]);
+					}
+					if (i < entry.instances.size())
+					{
+						remaining.instances.push_back(entry.instances[i]);
+					}
+				}
+			}
+			entry = remaining;
+		}
+	}
+	m_referrers.erase(iReferrers);
+}
+
+void AssociationIndex::clearLocked()
+{
+	m_sources.clear();
+	m_referrers.clear();
+}
+
+} // framework
+} // wbem
@@ -0,0 +1,164 @@
+/*
+ * Copyright (c) 2015 2016, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of Intel Corporation nor the names of its contributors
+ *     may be used to endorse or promote products derived from this software
+ *     without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * This file defines an in-memory index of association results that is kept up to date
+ * from instance change events instead of being recomputed for every request.
+ */
+
+#ifndef	_WBEM_FRAMEWORK_ASSOCIATION_INDEX_H_
+#define	_WBEM_FRAMEWORK_ASSOCIATION_INDEX_H_
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "Instance.h"
+#include "ObjectPath.h"
+#include "Types.h"
+#include "Export.h"
+
+#define	ASSOCIATION_INDEX_MAX_SOURCES 1024 //!< Source instances held before the index starts over
+
+namespace wbem
+{
+namespace framework
+{
+
+/*!
+ * The kinds of association request the index holds results for
+ */
+enum associationIndexKind
+{
+	ASSOCIATIONINDEXKIND_ASSOCIATORS, //!< associated instances
+	ASSOCIATIONINDEXKIND_REFERENCENAMES, //!< paths of the association objects
+	ASSOCIATIONINDEXKIND_REFERENCES //!< association objects with their paths
+};
+
+/*!
+ * The result of one association request
+ */
+struct AssociationIndexEntry
+{
+	instance_names_t paths; //!< reference paths, for the reference kinds
+	instances_t instances; //!< associated instances or association objects
+};
+
+/*!
+ * Association results, keyed by the source instance and the request filters.
+ * @remarks Association results only change when the instances behind them do, so once a
+ * request has been answered it is kept until the provider reports a change with
+ * instanceCreated, instanceDeleted or instanceModified. A deleted instance is removed from
+ * the results it appears in. A created or modified instance drops the results of its own
+ * and its neighbours' requests, which are joined again the next time they're asked for.
+ * The index is only used when ProviderFactory::useAssociationIndex() returns true.
+ */
+class INVM_CIM_API AssociationIndex
+{
+	public:
+		AssociationIndex();
+
+		/*!
+		 * @return The index shared by the provider.
+		 */
+		static AssociationIndex &getSingleton();
+
+		/*!
+		 * Get the change count to pass to add. Read it before computing the result.
+		 */
+		UINT64 getGeneration();
+
+		/*!
+		 * Look up the result of an association request.
+		 * @param[in] kind
+		 * 		The kind of request.
+		 * @param[in] objectPath
+		 * 		The instance the request is about.
+		 * @param[out] entry
+		 * 		The result, if found.
+		 * @return true if the result was found.
+		 */
+		bool find(const enum associationIndexKind kind, const ObjectPath &objectPath,
+				const std::string &associationClassName, const std::string &resultClassName,
+				const std::string &roleName, const std::string &resultRoleName,
+				AssociationIndexEntry &entry);
+
+		/*!
+		 * Keep the result of an association request.
+		 * @param[in] generation
+		 * 		The value of getGeneration() from before the result was computed. If an
+		 * 		instance changed since then the result may be stale and isn't kept.
+		 */
+		void add(const enum associationIndexKind kind, const ObjectPath &objectPath,
+				const std::string &associationClassName, const std::string &resultClassName,
+				const std::string &roleName, const std::string &resultRoleName,
+				const AssociationIndexEntry &entry, const UINT64 generation);
+
+		/*!
+		 * Report that an instance was created.
+		 */
+		void instanceCreated(const ObjectPath &path);
+
+		/*!
+		 * Report that an instance was deleted.
+		 */
+		void instanceDeleted(const ObjectPath &path);
+
+		/*!
+		 * Report that an instance was modified.
+		 */
+		void instanceModified(const ObjectPath &path);
+
+		/*!
+		 * Drop every result.
+		 */
+		void clear();
+
+	private:
+		typedef std::map<std::string, AssociationIndexEntry> queries_t;
+		typedef std::unordered_map<ObjectPath, queries_t, ObjectPathHash, ObjectPathEqual> sources_t;
+		typedef std::unordered_set<ObjectPath, ObjectPathHash, ObjectPathEqual> path_set_t;
+		typedef std::unordered_map<ObjectPath, path_set_t, ObjectPathHash, ObjectPathEqual> referrers_t;
+
+		std::mutex m_lock;
+		UINT64 m_generation;
+		sources_t m_sources; // results by source instance, then by request
+		referrers_t m_referrers; // source instances whose results mention an instance
+
+		void getNeighbours(const ObjectPath &path, path_set_t &neighbours);
+		void dropSource(const ObjectPath &path);
+		void dropEndpoints(const ObjectPath &path);
+		void dropReferrers(const ObjectPath &path);
+		void removeFromResults(const ObjectPath &path);
+		void clearLocked();
+};
+
+} // framework
+} // wbem
+#endif  // _WBEM_FRAMEWORK_ASSOCIATION_INDEX_H_
@@ -25,10 +25,21 @@
  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
 #include <logger/logging.h>
 #include <CimomAdapter.h>
 #include "AssociationMapper.h"
 #include "StringUtil.h"
+#include "RequestContext.h"
+#include "ThreadPool.h"
 
 namespace wbem
 {
@@ -46,14 +57,14 @@ AssociationMapper::AssociationMapper(
 	const std::string &roleName,
 	const std::string &resultRoleName) :
 	m_pProviderFactory(pProviderFactory),
-	m_classMap(classMap),
-	m_associationTable(associationTable),
+	m_pGraph(std::make_shared<AssociationGraph>(classMap, associationTable)),
 	m_cimNamespace(cimNamespace),
 	m_associationClassName(associationClassName),
 	m_resultClassName(resultClassName),
 	m_roleName(roleName),
 	m_resultRoleName(resultRoleName),
-	m_pInstance(NULL)
+	m_pInstance(NULL),
+	m_pAssociatedInstances(NULL)
 
 {
 	LogEnterExit logging(__FILE__, __FUNCTION__, __LINE__);
@@ -66,6 +77,37 @@ AssociationMapper::AssociationMapper(
 		pInstance == NULL ? "Is NULL" : pInstance->getClass().c_str());
 }
 
+AssociationMapper::AssociationMapper(
+	InstanceFactoryCreator *pProviderFactory,
+	std::shared_ptr<const AssociationGraph> pGraph,
+	std::string cimNamespace,
+	Instance *pInstance,
+	const std::string &associationClassName,
+	const std::string &resultClassName,
+	const std::string &roleName,
+	const std::string &resultRoleName) :
+	m_pProviderFactory(pProviderFactory),
+	m_pGraph(pGraph),
+	m_cimNamespace(cimNamespace),
+	m_associationClassName(associationClassName),
+	m_resultClassName(resultClassName),
+	m_roleName(roleName),
+	m_resultRoleName(resultRoleName),
+	m_pInstance(NULL),
+	m_pAssociatedInstances(NULL),
+	m_pAssociatedSources(NULL),
+	m_pSourceInstances(NULL),
+	m_pEnumerationCache(NULL)
+{
+	LogEnterExit logging(__FILE__, __FUNCTION__, __LINE__);
+	if (pInstance != NULL)
+	{
+		m_pInstance = new Instance(*pInstance);
+	}
+	COMMON_LOG_DEBUG_F("associationClassName: %s", associationClassName.c_str());
+	COMMON_LOG_DEBUG_F("pInstance: %s",
+		pInstance == NULL ? "Is NULL" : pInstance->getClass().c_str());
+}
 
 /*!
  * Copy Constructor
@@ -73,12 +115,17 @@ AssociationMapper::AssociationMapper(
 AssociationMapper::AssociationMapper(const AssociationMapper &other)
 	:
 	m_pProviderFactory(other.m_pProviderFactory),
+	m_pGraph(other.m_pGraph),
 	m_cimNamespace(other.m_cimNamespace),
 	m_associationClassName(other.m_associationClassName),
 	m_resultClassName(other.m_resultClassName),
 	m_roleName(other.m_roleName),
 	m_resultRoleName(other.m_resultRoleName),
-	m_pInstance(NULL)
+	m_pInstance(NULL),
+	m_pAssociatedInstances(NULL),
+	m_pAssociatedSources(NULL),
+	m_pSourceInstances(other.m_pSourceInstances),
+	m_pEnumerationCache(other.m_pEnumerationCache)
 {
 	LogEnterExit logging(__FILE__, __FUNCTION__, __LINE__);
 	if (other.m_pInstance != NULL)
@@ -108,6 +155,9 @@ AssociationMapper &AssociationMapper::operator=(
 		m_resultRoleName = other.m_resultRoleName;
 		m_cimNamespace = other.m_cimNamespace;
 		m_pProviderFactory = other.m_pProviderFactory;
+		m_pGraph = other.m_pGraph;
+		m_pSourceInstances = other.m_pSourceInstances;
+		m_pEnumerationCache = other.m_pEnumerationCache;
 		if (other.m_pInstance != NULL)
 		{
 			if (m_pInstance != NULL)
@@ -141,31 +191,234 @@ wbem::framework::instance_names_t *AssociationMapper::getAssociationNames()
 		m_associationClassName.c_str(),
 		(m_pInstance == NULL ? "NULL" : m_pInstance->getClass().c_str()));
 	instance_names_t *result = new instance_names_t();
+	try
+	{
+		addAssociations(*result);
+	}
+	catch (Exception &)
+	{
+		delete result;
+		throw;
+	}
 
-	classIsA("", "");
+	COMMON_LOG_DEBUG_F("Returning %d Instance Names", (int) result->size());
+	return result;
+}
 
-	for (size_t i = 0; i < m_associationTable.size(); i++)
+/*
+ * Run the same association join as getAssociationNames but keep the instances on the
+ * other side of each association instead of building association object paths
+ */
+wbem::framework::instances_t *AssociationMapper::getAssociatedInstances()
+{
+	LogEnterExit logging(__FILE__, __FUNCTION__, __LINE__);
+	instances_t *result = new instances_t();
+	if (m_pInstance != NULL)
 	{
+		instance_names_t objectPaths; // stays empty while collecting instances
+		m_pAssociatedInstances = result;
 		try
 		{
-			addAssociationObjectPaths(*result, m_associationTable[i]);
+			addAssociations(objectPaths);
 		}
 		catch (Exception &)
 		{
+			m_pAssociatedInstances = NULL;
 			delete result;
 			throw;
 		}
+		m_pAssociatedInstances = NULL;
 	}
 
-	COMMON_LOG_DEBUG_F("Returning %d Instance Names", (int) result->size());
+	COMMON_LOG_DEBUG_F("Returning %d Associated Instances", (int) result->size());
 	return result;
 }
 
+/*
+ * Same as getAssociatedInstances but every source instance takes part in each join at once
+ */
+void AssociationMapper::getAssociatedInstances(const instances_t &sources,
+	instances_t &associated, std::vector<size_t> &sourceIndexes)
+{
+	LogEnterExit logging(__FILE__, __FUNCTION__, __LINE__);
+	if (m_pInstance != NULL && !sources.empty())
+	{
+		instance_names_t objectPaths; // stays empty while collecting instances
+		m_pSourceInstances = &sources;
+		m_pAssociatedInstances = &associated;
+		m_pAssociatedSources = &sourceIndexes;
+		try
+		{
+			addAssociations(objectPaths);
+		}
+		catch (Exception &)
+		{
+			m_pSourceInstances = NULL;
+			m_pAssociatedInstances = NULL;
+			m_pAssociatedSources = NULL;
+			throw;
+		}
+		m_pSourceInstances = NULL;
+		m_pAssociatedInstances = NULL;
+		m_pAssociatedSources = NULL;
+	}
+}
+
+void AssociationMapper::addAssociations(instance_names_t &objectPaths)
+{
+	// only look at the table entries that can involve the instance and association class
+	std::vector<const AssociationEdge *> edges;
+	m_pGraph->getEdges(m_pInstance == NULL ? "" : m_pInstance->getClass(),
+		m_associationClassName, edges);
+	COMMON_LOG_DEBUG_F("%d of %d association table entries apply",
+		(int) edges.size(), (int) m_pGraph->getEdgeCount());
+
+	UINT32 maxConcurrency = m_pProviderFactory->getAssociationConcurrency();
+	if (maxConcurrency > 1 && edges.size() > 1)
+	{
+		addAssociationsConcurrently(objectPaths, edges, maxConcurrency);
+	}
+	else
+	{
+		for (size_t i = 0; i < edges.size() && !RequestContext::stopRequested(); i++)
+		{
+			addAssociationObjectPaths(objectPaths, *edges[i]);
+		}
+	}
+}
+
+void AssociationMapper::addAssociationsConcurrently(instance_names_t &objectPaths,
+	const std::vector<const AssociationEdge *> &edges, const UINT32 maxConcurrency)
+{
+	LogEnterExit logging(__FILE__, __FUNCTION__, __LINE__);
+
+	// the filters may ask the CIMOM about the class hierarchy, so they stay on this thread
+	std::vector<const AssociationEdge *> applicable;
+	for (size_t i = 0; i < edges.size(); i++)
+	{
+		if (associationApplies(*edges[i]))
+		{
+			applicable.push_back(edges[i]);
+		}
+	}
+
+	// each entry gets its own results so they can be merged in table order
+	std::vector<instance_names_t> entryPaths(applicable.size());
+	std::vector<instances_t> entryInstances(applicable.size());
+	std::vector<std::vector<size_t> > entrySources(applicable.size());
+	std::vector<std::exception_ptr> entryErrors(applicable.size());
+	std::atomic<size_t> nextEntry(0);
+	RequestContext *pRequestContext = RequestContext::getCurrent();
+
+	// every runner claims the next entry nobody has started yet, using its own mapper
+	std::function<void()> runner = [&]()
+	{
+		std::unique_ptr<RequestScope> pRequestScope;
+		if (pRequestContext != NULL)
+		{
+			pRequestScope.reset(new RequestScope(*pRequestContext));
+		}
+
+		AssociationMapper mapper(*this);
+		for (size_t i = nextEntry++; i < applicable.size() && !RequestContext::stopRequested();
+			i = nextEntry++)
+		{
+			mapper.m_pAssociatedInstances =
+				m_pAssociatedInstances != NULL ? &entryInstances[i] : NULL;
+			mapper.m_pAssociatedSources =
+				m_pAssociatedSources != NULL ? &entrySources[i] : NULL;
+			try
+			{
+				mapper.addMatchingAssociationObjectPaths(entryPaths[i], *applicable[i]);
+			}
+			catch (...)
+			{
+				entryErrors[i] = std::current_exception();
+			}
+		}
+	};
+
+	// this thread is one of the runners, so the request moves on even if the pool is busy.
+	// Pool runners that haven't started once this thread is done are not waited for, they
+	// may be queued behind the worker running this request. The state outlives the call for
+	// them.
+	struct RunnerState
+	{
+		std::mutex lock;
+		std::condition_variable done;
+		size_t running;
+		bool closed;
+	};
+	std::shared_ptr<RunnerState> pRunners = std::make_shared<RunnerState>();
+	pRunners->running = 0;
+	pRunners->closed = false;
+	size_t poolRunners = std::min((size_t)maxConcurrency, applicable.size());
+	poolRunners = poolRunners > 0 ? poolRunners - 1 : 0;
+	for (size_t r = 0; r < poolRunners; r++)
+	{
+		ThreadPool::getShared().submit([pRunners, &runner]()
+		{
+			{
+				std::lock_guard<std::mutex> lock(pRunners->lock);
+				if (pRunners->closed)
+				{
+					return;
+				}
+				pRunners->running++;
+			}
+			runner();
+			std::lock_guard<std::mutex> lock(pRunners->lock);
+			if (--pRunners->running == 0)
+			{
+				pRunners->done.notify_all();
+			}
+		});
+	}
+	runner();
+	{
+		std::unique_lock<std::mutex> lock(pRunners->lock);
+		pRunners->closed = true;
+		while (pRunners->running > 0)
+		{
+			pRunners->done.wait(lock);
+		}
+	}
+
+	for (size_t i = 0; i < applicable.size(); i++)
+	{
+		if (entryErrors[i])
+		{
+			std::rethrow_exception(entryErrors[i]);
+		}
+		objectPaths.insert(objectPaths.end(), entryPaths[i].begin(), entryPaths[i].end());
+		if (m_pAssociatedInstances != NULL)
+		{
+			m_pAssociatedInstances->insert(m_pAssociatedInstances->end(),
+				entryInstances[i].begin(), entryInstances[i].end());
+		}
+		if (m_pAssociatedSources != NULL)
+		{
+			m_pAssociatedSources->insert(m_pAssociatedSources->end(),
+				entrySources[i].begin(), entrySources[i].end());
+		}
+	}
+}
+
 void AssociationMapper::addAssociationObjectPaths(
-	instance_names_t &objectPaths, const struct associationMap &association)
+	instance_names_t &objectPaths, const AssociationEdge &edge)
 throw(Exception)
 {
-	if (!isAssociationClass(association.associationClassName))
+	if (associationApplies(edge))
+	{
+		addMatchingAssociationObjectPaths(objectPaths, edge);
+	}
+}
+
+bool AssociationMapper::associationApplies(const AssociationEdge &edge)
+{
+	bool applies = false;
+	const struct associationMap &association = edge.association;
+	if (!edge.isConfigured)
 	{
 		COMMON_LOG_ERROR_F("Association Class %s not configured in "
 			"the Association Class Array",
@@ -173,7 +426,7 @@ throw(Exception)
 	}
 	else
 	{
-		const associationClass &associationClass = m_classMap[association.associationClassName];
+		const associationClass &associationClass = edge.associationClass;
 
 		// initial filtering logic to determine if entry in association table applies to request
 		bool instanceIsNull = m_pInstance == NULL;
@@ -204,112 +457,148 @@ throw(Exception)
 								 (instanceIsAntOrNull &&
 								  m_resultRoleName == associationClass.dependentPropertyName));
 
-		if (instanceIsEmptyOrAntOrDep &&
-			assocClassFilter && resultClassFilter && roleFilter && resultRoleFilter)
-		{
-			// add all if no instance path was provided. Otherwise check if the object path matches
-			// the antecedent or dependent of the association
+		applies = instanceIsEmptyOrAntOrDep &&
+			assocClassFilter && resultClassFilter && roleFilter && resultRoleFilter;
+	}
+	return applies;
+}
 
-			// get the Instance Factory for both Antecedent and Dependent
-			InstanceFactory *pDepFactory =
-				m_pProviderFactory->getInstanceFactory(association.dependentClassName);
-			InstanceFactory *pAntFactory =
-				m_pProviderFactory->getInstanceFactory(association.antecedentClassName);
-			if (pAntFactory && pDepFactory)
-			{
-				// Instance class could be antecedent and/or dependent so need to check both.
-				if (instanceIsAnt)
-				{
-					addAssociationObjectPathsWithInstanceAsAntecedent(objectPaths, association,
-						*pAntFactory, *pDepFactory);
-				}
-				if (instanceIsDep)
-				{
-					addAssociationObjectPathsWithInstanceAsDependent(objectPaths, association,
-						*pAntFactory, *pDepFactory);
-				}
-				// no instance passed in
-				if (instanceIsNull)
-				{
-					addAssociationObjectPathsForAllInstances(objectPaths, association,
-						*pAntFactory, *pDepFactory);
-				}
+void AssociationMapper::addMatchingAssociationObjectPaths(
+	instance_names_t &objectPaths, const AssociationEdge &edge)
+throw(Exception)
+{
+	const struct associationMap &association = edge.association;
+	bool instanceIsNull = m_pInstance == NULL;
+	bool instanceIsAnt = m_pInstance != NULL && m_pInstance->getClass() ==
+												association.antecedentClassName;
+	bool instanceIsDep = m_pInstance != NULL && m_pInstance->getClass() ==
+												association.dependentClassName;
+
+	// add all if no instance path was provided. Otherwise check if the object path matches
+	// the antecedent or dependent of the association
+
+	// get the Instance Factory for both Antecedent and Dependent
+	InstanceFactory *pDepFactory =
+		m_pProviderFactory->getInstanceFactory(association.dependentClassName);
+	InstanceFactory *pAntFactory =
+		m_pProviderFactory->getInstanceFactory(association.antecedentClassName);
+	if (pAntFactory && pDepFactory)
+	{
+		// Instance class could be antecedent and/or dependent so need to check both.
+		if (instanceIsAnt)
+		{
+			addAssociationObjectPathsWithInstanceAsAntecedent(objectPaths, edge,
+				*pAntFactory, *pDepFactory);
+		}
+		if (instanceIsDep)
+		{
+			addAssociationObjectPathsWithInstanceAsDependent(objectPaths, edge,
+				*pAntFactory, *pDepFactory);
+		}
+		// no instance passed in
+		if (instanceIsNull)
+		{
+			addAssociationObjectPathsForAllInstances(objectPaths, edge,
+				*pAntFactory, *pDepFactory);
+		}
 
-				delete pAntFactory;
-				delete pDepFactory;
-			}
-			else
-			{
-				// Clean up before throwing
-				if (pAntFactory)
-				{
-					delete pAntFactory;
-				}
-				if (pDepFactory)
-				{
-					delete pDepFactory;
-				}
-				COMMON_LOG_ERROR("Unknown error. pAntFactory, or pDepFactory was NULL");
-				throw Exception("Antecedent or dependent class factory missing");
-			}
+		delete pAntFactory;
+		delete pDepFactory;
+	}
+	else
+	{
+		// Clean up before throwing
+		if (pAntFactory)
+		{
+			delete pAntFactory;
+		}
+		if (pDepFactory)
+		{
+			delete pDepFactory;
 		}
+		COMMON_LOG_ERROR("Unknown error. pAntFactory, or pDepFactory was NULL");
+		throw Exception("Antecedent or dependent class factory missing");
 	}
 }
 
 void AssociationMapper::addAssociationObjectPathsWithInstanceAsAntecedent(
-	instance_names_t &objectPaths, const struct associationMap &association,
+	instance_names_t &objectPaths, const AssociationEdge &edge,
 	InstanceFactory &antFactory, InstanceFactory &depFactory)
 {
 	LogEnterExit logging(__FILE__, __FUNCTION__, __LINE__);
+	const struct associationMap &association = edge.association;
 
 	// Instance is the Antecedent
 	instances_t antecedentInstances = getInstanceListWithMemberInstance();
 
 	// get all possible instances of the Dependent class
-	instances_t *pDependentInstances = getInstanceListFromFactory(depFactory);
+	instances_t *pDependentInstances =
+		getInstanceListFromFactory(depFactory, association.dependentClassName);
 
 	// Build up the result list
-	addValidObjectPathsForAssociationBetweenAntecedentAndDependentInstances(objectPaths,
-		association,
-		antecedentInstances, antFactory,
-		*pDependentInstances, depFactory);
+	if (m_pAssociatedInstances != NULL)
+	{
+		addAssociatedInstances(edge,
+			antecedentInstances, antFactory,
+			*pDependentInstances, depFactory, true);
+	}
+	else
+	{
+		addValidObjectPathsForAssociationBetweenAntecedentAndDependentInstances(objectPaths,
+			edge,
+			antecedentInstances, antFactory,
+			*pDependentInstances, depFactory);
+	}
 
 	delete pDependentInstances;
 }
 
 void AssociationMapper::addAssociationObjectPathsWithInstanceAsDependent(
-	instance_names_t &objectPaths, const struct associationMap &association,
+	instance_names_t &objectPaths, const AssociationEdge &edge,
 	InstanceFactory &antFactory, InstanceFactory &depFactory)
 {
 	LogEnterExit logging(__FILE__, __FUNCTION__, __LINE__);
+	const struct associationMap &association = edge.association;
 	// get all possible instances of the Antecedent class
-	instances_t *pAntecedentInstances = getInstanceListFromFactory(antFactory);
+	instances_t *pAntecedentInstances =
+		getInstanceListFromFactory(antFactory, association.antecedentClassName);
 
 	// Instance is the Dependent
 	instances_t dependentInstances = getInstanceListWithMemberInstance();
 
 	// Build up the result list
-	addValidObjectPathsForAssociationBetweenAntecedentAndDependentInstances(objectPaths,
-		association,
-		*pAntecedentInstances, antFactory,
-		dependentInstances, depFactory);
+	if (m_pAssociatedInstances != NULL)
+	{
+		addAssociatedInstances(edge,
+			*pAntecedentInstances, antFactory,
+			dependentInstances, depFactory, false);
+	}
+	else
+	{
+		addValidObjectPathsForAssociationBetweenAntecedentAndDependentInstances(objectPaths,
+			edge,
+			*pAntecedentInstances, antFactory,
+			dependentInstances, depFactory);
+	}
 
 	delete pAntecedentInstances;
 }
 
 void AssociationMapper::addAssociationObjectPathsForAllInstances(
-	instance_names_t &objectPaths, const struct associationMap &association,
+	instance_names_t &objectPaths, const AssociationEdge &edge,
 	InstanceFactory &antFactory, InstanceFactory &depFactory)
 {
 	LogEnterExit logging(__FILE__, __FUNCTION__, __LINE__);
+	const struct associationMap &association = edge.association;
 	// get all possible instances of the Antecedent class
-	instances_t *pAntecedentInstances = getInstanceListFromFactory(antFactory);
+	instances_t *pAntecedentInstances =
+		getInstanceListFromFactory(antFactory, association.antecedentClassName);
 
 	// get all possible instances of the Dependent class
 	instances_t *pDependentInstances = NULL;
 	try // if something goes haywire, need to clean up the antecedent instances
 	{
-		pDependentInstances = getInstanceListFromFactory(depFactory);
+		pDependentInstances = getInstanceListFromFactory(depFactory, association.dependentClassName);
 	}
 	catch (Exception &)
 	{
@@ -319,7 +608,7 @@ void AssociationMapper::addAssociationObjectPathsForAllInstances(
 
 	// Build up the result list
 	addValidObjectPathsForAssociationBetweenAntecedentAndDependentInstances(objectPaths,
-		association,
+		edge,
 		*pAntecedentInstances, antFactory,
 		*pDependentInstances, depFactory);
 
@@ -328,11 +617,19 @@ void AssociationMapper::addAssociationObjectPathsForAllInstances(
 }
 
 wbem::framework::instances_t *AssociationMapper::getInstanceListFromFactory(
-	InstanceFactory &factory) throw(wbem::framework::Exception)
+	InstanceFactory &factory, const std::string &className) throw(wbem::framework::Exception)
 {
 	LogEnterExit logging(__FILE__, __FUNCTION__, __LINE__);
-	attribute_names_t attributes;
-	instances_t *pInstances = factory.getInstances(attributes);
+	instances_t *pInstances = NULL;
+	if (m_pEnumerationCache != NULL)
+	{
+		pInstances = m_pEnumerationCache->getInstances(factory, className);
+	}
+	else
+	{
+		attribute_names_t attributes;
+		pInstances = factory.getInstancesShared(className, attributes);
+	}
 	if (!pInstances)
 	{
 		COMMON_LOG_ERROR("Unknown error. pInstances was NULL");
@@ -346,54 +643,190 @@ wbem::framework::instances_t AssociationMapper::getInstanceListWithMemberInstanc
 {
 	LogEnterExit logging(__FILE__, __FUNCTION__, __LINE__);
 	instances_t instances;
-	instances.push_back(*m_pInstance);
+	if (m_pSourceInstances != NULL)
+	{
+		instances = *m_pSourceInstances;
+	}
+	else
+	{
+		instances.push_back(*m_pInstance);
+	}
 
 	return instances;
 }
 
 void AssociationMapper::addValidObjectPathsForAssociationBetweenAntecedentAndDependentInstances(
-	instance_names_t &objectPaths, const struct associationMap &association,
+	instance_names_t &objectPaths, const AssociationEdge &edge,
 	instances_t &antInstances, InstanceFactory &antFactory, instances_t &depInstances,
 	InstanceFactory &depFactory)
 {
 	LogEnterExit logging(__FILE__, __FUNCTION__, __LINE__);
+	const struct associationMap &association = edge.association;
+
+	association_pairs_t matches;
+	getAssociatedPairs(edge, antInstances, antFactory, depInstances, depFactory, matches);
+
+	// an instance may be in many associations, only build its reference once
+	std::vector<Attribute> antRefs(antInstances.size());
+	std::vector<Attribute> depRefs(depInstances.size());
+	for (size_t m = 0; m < matches.size(); m++)
+	{
+		Attribute &antRef = antRefs[matches[m].first];
+		if (antRef.getType() != REFERENCE_T)
+		{
+			antRef = Attribute(antInstances[matches[m].first].getObjectPath(), true);
+		}
+		Attribute &depRef = depRefs[matches[m].second];
+		if (depRef.getType() != REFERENCE_T)
+		{
+			depRef = Attribute(depInstances[matches[m].second].getObjectPath(), true);
+		}
+		addAssociationObjectPath(objectPaths, association, antRef, depRef);
+	}
+}
+
+void AssociationMapper::addAssociatedInstances(const AssociationEdge &edge,
+	instances_t &antInstances, InstanceFactory &antFactory,
+	instances_t &depInstances, InstanceFactory &depFactory,
+	bool instanceIsAntecedent)
+{
+	LogEnterExit logging(__FILE__, __FUNCTION__, __LINE__);
+	const struct associationMap &association = edge.association;
+
+	association_pairs_t matches;
+	getAssociatedPairs(edge, antInstances, antFactory, depInstances, depFactory, matches);
+
+	// only an association between instances of the same class can lead back to the instance
+	bool checkForSelf = association.antecedentClassName == association.dependentClassName;
+	std::vector<std::string> sourcePaths;
+
+	for (size_t m = 0; m < matches.size(); m++)
+	{
+		size_t source = instanceIsAntecedent ? matches[m].first : matches[m].second;
+		const Instance &associated = instanceIsAntecedent
+			? depInstances[matches[m].second]
+			: antInstances[matches[m].first];
+		// don't list the instance as one of its own associators
+		if (checkForSelf)
+		{
+			sourcePaths.resize(instanceIsAntecedent ? antInstances.size() : depInstances.size());
+			if (sourcePaths[source].empty())
+			{
+				sourcePaths[source] = (instanceIsAntecedent ? antInstances[source]
+					: depInstances[source]).getObjectPath().asString(true);
+			}
+			if (associated.getObjectPath().asString(true) == sourcePaths[source])
+			{
+				continue;
+			}
+		}
+		m_pAssociatedInstances->push_back(associated);
+		if (m_pAssociatedSources != NULL)
+		{
+			m_pAssociatedSources->push_back(source);
+		}
+	}
+}
+
+void AssociationMapper::getAssociatedPairs(const AssociationEdge &edge,
+	instances_t &antInstances, InstanceFactory &antFactory,
+	instances_t &depInstances, InstanceFactory &depFactory,
+	association_pairs_t &matches)
+{
+	const struct associationMap &association = edge.association;
+	// FK associations can be joined on the FK value instead of comparing every pair
+	if (association.type == ASSOCIATIONTYPE_SIMPLEFK ||
+		association.type == ASSOCIATIONTYPE_FILTEREDFK)
+	{
+		getFkAssociatedPairs(edge, antInstances, depInstances, matches);
+		return;
+	}
+
 	// Search for valid associations between all antecedent and dependent instances
-	for (instances_t::iterator aIter = antInstances.begin();
-		 aIter != antInstances.end(); aIter++)
+	for (size_t a = 0; a < antInstances.size() && !RequestContext::stopRequested(); a++)
 	{
-		for (instances_t::iterator dIter = depInstances.begin();
-			 dIter != depInstances.end(); dIter++)
+		for (size_t d = 0; d < depInstances.size(); d++)
 		{
-			if (instancesHaveAssociation(association,
-				*aIter, antFactory, *dIter, depFactory))
+			if (instancesHaveAssociation(edge,
+				antInstances[a], antFactory, depInstances[d], depFactory))
 			{
-				const struct associationClass &associationClass =
-					m_classMap[association.associationClassName];
-
-				attributes_t keys;
-				framework::Attribute antecdentAttribute
-					= Attribute(aIter->getObjectPath().asString(true), true);
-				antecdentAttribute.setIsAssociationClassInstance(true);
-				keys[associationClass.antecedentPropertyName]
-					= antecdentAttribute;
-				framework::Attribute dependentAttribute
-					= Attribute(dIter->getObjectPath().asString(true), true);
-				dependentAttribute.setIsAssociationClassInstance(true);
-				keys[associationClass.dependentPropertyName]
-					= dependentAttribute;
-				ObjectPath path(".", m_cimNamespace, association.associationClassName, keys);
-				objectPaths.push_back(path);
+				matches.push_back(std::make_pair(a, d));
 			}
 		}
 	}
 }
 
-bool AssociationMapper::instancesHaveAssociation(
+void AssociationMapper::getFkAssociatedPairs(const AssociationEdge &edge,
+	instances_t &antInstances, instances_t &depInstances,
+	association_pairs_t &matches)
+{
+	LogEnterExit logging(__FILE__, __FUNCTION__, __LINE__);
+
+	// index whichever side is smaller
+	bool indexAntecedents = antInstances.size() < depInstances.size();
+	instances_t &indexed = indexAntecedents ? antInstances : depInstances;
+	instances_t &probing = indexAntecedents ? depInstances : antInstances;
+	const FkNormalizer &indexedFk = indexAntecedents ? edge.antecedentFk : edge.dependentFk;
+	const FkNormalizer &probingFk = indexAntecedents ? edge.dependentFk : edge.antecedentFk;
+
+	std::unordered_map<std::string, std::vector<size_t> > index;
+	index.reserve(indexed.size());
+	std::string fkValue;
+	for (size_t i = 0; i < indexed.size(); i++)
+	{
+		if (indexedFk.getValue(indexed[i], fkValue))
+		{
+			index[fkValue].push_back(i);
+		}
+	}
+
+	size_t firstMatch = matches.size();
+	for (size_t p = 0; p < probing.size() && !RequestContext::stopRequested(); p++)
+	{
+		if (probingFk.getValue(probing[p], fkValue))
+		{
+			std::unordered_map<std::string, std::vector<size_t> >::const_iterator hit =
+				index.find(fkValue);
+			if (hit != index.end())
+			{
+				for (size_t i = 0; i < hit->second.size(); i++)
+				{
+					matches.push_back(indexAntecedents
+						? std::make_pair(hit->second[i], p)
+						: std::make_pair(p, hit->second[i]));
+				}
+			}
+		}
+	}
+
+	// keep the same order the pairwise comparison would produce
+	if (indexAntecedents)
+	{
+		std::sort(matches.begin() + firstMatch, matches.end());
+	}
+}
+
+void AssociationMapper::addAssociationObjectPath(instance_names_t &objectPaths,
 	const struct associationMap &association,
+	const Attribute &antecedentRef, const Attribute &dependentRef)
+{
+	const struct associationClass &associationClass =
+		*m_pGraph->findAssociationClass(association.associationClassName);
+
+	attributes_t keys;
+	keys[associationClass.antecedentPropertyName] = antecedentRef;
+	keys[associationClass.dependentPropertyName] = dependentRef;
+	ObjectPath path(".", m_cimNamespace, association.associationClassName, keys);
+	objectPaths.push_back(path);
+}
+
+bool AssociationMapper::instancesHaveAssociation(
+	const AssociationEdge &edge,
 	Instance &antInstance, InstanceFactory &antFactory,
 	Instance &depInstance, InstanceFactory &depFactory)
 {
 	LogEnterExit logging(__FILE__, __FUNCTION__, __LINE__);
+	const struct associationMap &association = edge.association;
 	bool instancesAreAssociated = false;
 
 	// determine if instances are associated based on the Association Type
@@ -410,9 +843,9 @@ bool AssociationMapper::instancesHaveAssociation(
 					&depInstance);
 			break;
 		case ASSOCIATIONTYPE_SIMPLEFK:
-			instancesAreAssociated = simpleFkMatch(
-				&antInstance, association.antecedentFk,
-				&depInstance, association.dependentFk);
+		case ASSOCIATIONTYPE_FILTEREDFK:
+			instancesAreAssociated = fkMatch(edge.antecedentFk, antInstance,
+				edge.dependentFk, depInstance);
 			break;
 	}
 
@@ -474,7 +907,8 @@ throw(framework::Exception)
 	{
 		if (isAssociationClass(m_associationClassName))
 		{
-			const struct associationClass &assocClass = m_classMap[m_associationClassName];
+			const struct associationClass &assocClass =
+				*m_pGraph->findAssociationClass(m_associationClassName);
 
 			attributes.push_back(assocClass.antecedentPropertyName);
 			attributes.push_back(assocClass.dependentPropertyName);
@@ -495,7 +929,7 @@ bool AssociationMapper::isAssociationClass(const std::string &className)
 	LogEnterExit logging(__FILE__, __FUNCTION__, __LINE__);
 	bool found = false;
 
-	if (m_classMap.find(className) != m_classMap.end())
+	if (m_pGraph->findAssociationClass(className) != NULL)
 	{
 		found = true;
 	}
@@ -511,8 +945,8 @@ bool AssociationMapper::simpleFkMatch(
 	Instance *pDepInstance, const std::string &depFk)
 {
 	LogEnterExit logging(__FILE__, __FUNCTION__, __LINE__);
-	return filteredFkMatch(pAntInstance, antFk, std::vector<std::string>(),
-		pDepInstance, depFk, std::vector<std::string>());
+	return fkMatch(FkNormalizer(antFk, std::vector<std::string>()), *pAntInstance,
+		FkNormalizer(depFk, std::vector<std::string>()), *pDepInstance);
 }
 
 /*
@@ -523,12 +957,8 @@ bool AssociationMapper::filteredFkMatch(
 	Instance *pDepInstance, const std::string &depFk, const std::string &depFkFilter)
 {
 	LogEnterExit logging(__FILE__, __FUNCTION__, __LINE__);
-	std::vector<std::string> antFkFilterList;
-	std::vector<std::string> depFkFilterList;
-	antFkFilterList.push_back(antFkFilter);
-	depFkFilterList.push_back(depFkFilter);
-	return filteredFkMatch(pAntInstance, antFk, antFkFilterList,
-		pDepInstance, depFk, depFkFilterList);
+	return fkMatch(FkNormalizer(antFk, antFkFilter), *pAntInstance,
+		FkNormalizer(depFk, depFkFilter), *pDepInstance);
 }
 
 
@@ -540,17 +970,44 @@ bool AssociationMapper::filteredFkMatch(
 	Instance *pDepInstance, const std::string &depFk, const std::vector<std::string> &depFkFilter)
 {
 	LogEnterExit logging(__FILE__, __FUNCTION__, __LINE__);
-	bool result = false;
-	framework::Attribute antAttribute;
-	framework::Attribute depAttribute;
-	if (pAntInstance->getAttribute(antFk, antAttribute) == framework::SUCCESS &&
-		pDepInstance->getAttribute(depFk, depAttribute) == framework::SUCCESS)
+	return fkMatch(FkNormalizer(antFk, antFkFilter), *pAntInstance,
+		FkNormalizer(depFk, depFkFilter), *pDepInstance);
+}
+
+/*
+ * Called for every pair the pairwise comparison looks at, so no log tracing
+ */
+bool AssociationMapper::fkMatch(const FkNormalizer &antFk, const Instance &antInstance,
+	const FkNormalizer &depFk, const Instance &depInstance)
+{
+	std::string antString;
+	std::string depString;
+	return antFk.getValue(antInstance, antString) &&
+		depFk.getValue(depInstance, depString) &&
+		antString == depString;
+}
+
+instances_t *ClassEnumerationCache::getInstances(InstanceFactory &factory,
+	const std::string &className)
+{
 	{
-		std::string antString = StringUtil::removeStrings(antAttribute.asStr(), antFkFilter);
-		std::string depString = StringUtil::removeStrings(depAttribute.asStr(), depFkFilter);
-		result = (antString == depString);
+		std::lock_guard<std::mutex> lock(m_lock);
+		std::map<std::string, instances_t>::const_iterator iter = m_instances.find(className);
+		if (iter != m_instances.end())
+		{
+			return new instances_t(iter->second);
+		}
 	}
-	return result;
+
+	// enumerate outside of the lock, concurrent joins of the same class share the call
+	attribute_names_t attributes;
+	instances_t *pInstances = factory.getInstancesShared(className, attributes);
+	if (pInstances != NULL)
+	{
+		std::lock_guard<std::mutex> lock(m_lock);
+		m_instances.insert(std::make_pair(className, *pInstances));
+	}
+	return pInstances;
 }
 
 }
@@ -27,6 +27,10 @@
 #ifndef INTEL_CIM_FRAMEWORK_ASSOCIATIONMAPPER_H
 #define INTEL_CIM_FRAMEWORK_ASSOCIATIONMAPPER_H
 
+#include <memory>
+#include <mutex>
+
+#include "AssociationGraph.h"
 #include "ObjectPath.h"
 #include "InstanceFactory.h"
 #include "Instance.h"
@@ -38,39 +42,22 @@ namespace wbem
 namespace framework
 {
 
-
 /*!
- * Type of association defined in the Association table
+ * Instances of each class enumerated while serving one request, so a request that joins
+ * the same class more than once only enumerates it once.
  */
-enum associationType
+class INVM_CIM_API ClassEnumerationCache
 {
-	ASSOCIATIONTYPE_BASIC,   //!< ASSOCIATIONTYPE_BASIC
-	ASSOCIATIONTYPE_SIMPLEFK, //!< ASSOCIATIONTYPE_SIMPLEFK
-	ASSOCIATIONTYPE_COMPLEX  //!< ASSOCIATIONTYPE_COMPLEX
-};
-
-/*!
- * Represents an Association Class
- */
-struct associationClass
-{
-	std::string className; //!< Name of class
-	std::string antecedentPropertyName; //!< Name of the antecedent property
-	std::string dependentPropertyName; //!< Name of the dependent property
-};
+public:
+	/*!
+	 * Get the instances of a class, enumerating them with the factory the first time.
+	 * @return a copy of the instances, owned by the caller
+	 */
+	instances_t *getInstances(InstanceFactory &factory, const std::string &className);
 
-/*!
- * Data structure to contain the mapping data to dynamically build associations and association
- * class instances
- */
-struct associationMap
-{
-	std::string associationClassName; //!< name of the association class
-	enum associationType type; //!< information on how to determine if instances are associated
-	std::string antecedentClassName; //!< defines the reference to the antecedent
-	std::string dependentClassName;  //!< defines the reference to the dependent
-	std::string antecedentFk; //!< Type SimpleFk requires antecedentFK
-	std::string dependentFk; //!< Type SimpleFk requires dependentFK
+private:
+	std::mutex m_lock;
+	std::map<std::string, instances_t> m_instances;
 };
 
 class INVM_CIM_API AssociationMapper
@@ -88,6 +75,20 @@ public:
 		const std::string &roleName = "",
 		const std::string &resultRoleName = "");
 
+	/*!
+	 * Create a mapper over an association graph that has already been compiled, so the
+	 * association tables don't need to be copied and indexed for every request.
+	 */
+	AssociationMapper(
+		InstanceFactoryCreator *pProviderFactory,
+		std::shared_ptr<const AssociationGraph> pGraph,
+		std::string cimNamespace,
+		Instance *pInstance = NULL,
+		const std::string &associationClassName = "",
+		const std::string &resultClassName = "",
+		const std::string &roleName = "",
+		const std::string &resultRoleName = "");
+
 	/*!
 	 * Copy Constructor
 	 */
@@ -105,6 +106,35 @@ public:
 
 	virtual framework::instance_names_t *getAssociationNames();
 
+	/*!
+	 * Get the instances on the other side of every association the mapper's instance is
+	 * part of. The instances are the ones the association join already fetched, so no
+	 * association object paths are built and nothing is fetched again.
+	 * @return the associated instances, in the same order getAssociationNames would
+	 * 		return the associations. Empty if the mapper has no instance.
+	 */
+	virtual framework::instances_t *getAssociatedInstances();
+
+	/*!
+	 * Get the instances associated with each of a set of source instances in one join per
+	 * association table entry. The mapper's instance decides which entries apply, so every
+	 * source must be of the same class as it.
+	 * @param[in] sources
+	 * 		The source instances.
+	 * @param[out] associated
+	 * 		The associated instances are added to this list.
+	 * @param[out] sourceIndexes
+	 * 		The index in sources of the instance each associated instance was found for.
+	 */
+	void getAssociatedInstances(const instances_t &sources,
+		instances_t &associated, std::vector<size_t> &sourceIndexes);
+
+	/*!
+	 * Use a cache for class enumerations, so a class is enumerated once no matter how many
+	 * times the request joins it. The cache must outlive the mapper's requests.
+	 */
+	void setEnumerationCache(ClassEnumerationCache *pCache) { m_pEnumerationCache = pCache; }
+
 
 	bool isAssociationClass(const std::string &className);
 
@@ -122,14 +152,19 @@ public:
 		Instance *pAntInstance, const std::string &antFk, const std::string &antFkFilter,
 		Instance *pDepInstance, const std::string &depFk, const std::string &depFkFilter);
 
+	/*!
+	 * Determine if two instances are associated by comparing their normalized FK values.
+	 */
+	static bool fkMatch(const FkNormalizer &antFk, const Instance &antInstance,
+		const FkNormalizer &depFk, const Instance &depInstance);
+
 
 private:
 	virtual void populateAttributeList(
 		framework::attribute_names_t &attributes) throw(framework::Exception);
 
 	InstanceFactoryCreator *m_pProviderFactory;
-	std::map<std::string, struct associationClass> m_classMap;
-	std::vector<struct associationMap> m_associationTable;
+	std::shared_ptr<const AssociationGraph> m_pGraph;
 	std::string m_cimNamespace;
 	std::string m_associationClassName;
 	std::string m_resultClassName;
@@ -137,26 +172,58 @@ private:
 	std::string m_resultRoleName;
 	Instance *m_pInstance;
 
+	// when set, the associated instances are collected here instead of building object paths
+	instances_t *m_pAssociatedInstances;
+	// when set, the index of the source each associated instance was found for
+	std::vector<size_t> *m_pAssociatedSources;
+	// when set, the join uses these in place of m_pInstance
+	const instances_t *m_pSourceInstances;
+	ClassEnumerationCache *m_pEnumerationCache;
+
+	// matching (antecedent index, dependent index) pairs
+	typedef std::vector<std::pair<size_t, size_t> > association_pairs_t;
+
+	void addAssociations(instance_names_t &objectPaths);
+
+	/*
+	 * Evaluate the entries on the framework thread pool, at most maxConcurrency at a time,
+	 * and add the results in the same order the entries would be evaluated one by one.
+	 */
+	void addAssociationsConcurrently(instance_names_t &objectPaths,
+		const std::vector<const AssociationEdge *> &edges, const UINT32 maxConcurrency);
+
 	bool resultClassEmptyOrMatches(const struct associationMap &association,
 		bool instanceIsAnt,
 		bool instanceIsDep);
 
 	void addAssociationObjectPaths(instance_names_t &objectPaths,
-		const struct associationMap &association)
+		const AssociationEdge &edge)
+		throw(Exception);
+
+	/*
+	 * Check the request filters against an association table entry.
+	 */
+	bool associationApplies(const AssociationEdge &edge);
+
+	/*
+	 * Add the association object paths for an entry the request filters already accepted.
+	 */
+	void addMatchingAssociationObjectPaths(instance_names_t &objectPaths,
+		const AssociationEdge &edge)
 		throw(Exception);
 
 	/*
 	 * Add any valid association object paths using m_pInstance as the dependent.
 	 */
 	void addAssociationObjectPathsWithInstanceAsAntecedent(instance_names_t &objectPaths,
-		const struct associationMap &association,
+		const AssociationEdge &edge,
 		InstanceFactory &antFactory, InstanceFactory &depFactory);
 
 	/*
 	 * Add any valid association object paths using m_pInstance as the antecedent.
 	 */
 	void addAssociationObjectPathsWithInstanceAsDependent(instance_names_t &objectPaths,
-		const struct associationMap &association,
+		const AssociationEdge &edge,
 		InstanceFactory &antFactory, InstanceFactory &depFactory);
 
 	/*
@@ -164,16 +231,18 @@ private:
 	 * class instances.
 	 */
 	void addAssociationObjectPathsForAllInstances(instance_names_t &objectPaths,
-		const struct associationMap &association,
+		const AssociationEdge &edge,
 		InstanceFactory &antFactory, InstanceFactory &depFactory);
 
 	/*
-	 * Grabs all instances from an instance factory.
+	 * Grabs all instances of a class from an instance factory.
 	 */
-	instances_t *getInstanceListFromFactory(InstanceFactory &factory) throw(Exception);
+	instances_t *getInstanceListFromFactory(InstanceFactory &factory,
+		const std::string &className) throw(Exception);
 
 	/*
-	 * Grabs a non-pointer copy of an instance list with just the member instance.
+	 * Grabs a non-pointer copy of an instance list with just the member instance, or the
+	 * source instances if the mapper was given some.
 	 */
 	instances_t getInstanceListWithMemberInstance();
 
@@ -183,14 +252,46 @@ private:
 	 */
 	void addValidObjectPathsForAssociationBetweenAntecedentAndDependentInstances(
 		instance_names_t &objectPaths,
-		const struct associationMap &association,
+		const AssociationEdge &edge,
 		instances_t &antInstances, InstanceFactory &antFactory,
 		instances_t &depInstances, InstanceFactory &depFactory);
 
+	/*
+	 * Adds the instances on the other side of any valid association with m_pInstance.
+	 */
+	void addAssociatedInstances(const AssociationEdge &edge,
+		instances_t &antInstances, InstanceFactory &antFactory,
+		instances_t &depInstances, InstanceFactory &depFactory,
+		bool instanceIsAntecedent);
+
+	/*
+	 * Finds the pairs of antecedent and dependent instances that have the given association,
+	 * in antecedent then dependent order.
+	 */
+	void getAssociatedPairs(const AssociationEdge &edge,
+		instances_t &antInstances, InstanceFactory &antFactory,
+		instances_t &depInstances, InstanceFactory &depFactory,
+		association_pairs_t &matches);
+
+	/*
+	 * Finds the pairs for a foreign key association by indexing the smaller side on
+	 * its FK value and probing the index with the other side.
+	 */
+	void getFkAssociatedPairs(const AssociationEdge &edge,
+		instances_t &antInstances, instances_t &depInstances,
+		association_pairs_t &matches);
+
+	/*
+	 * Adds a single association object path with the antecedent and dependent references.
+	 */
+	void addAssociationObjectPath(instance_names_t &objectPaths,
+		const struct associationMap &association,
+		const Attribute &antecedentRef, const Attribute &dependentRef);
+
 	/*
 	 * Returns true if the antecedent and dependent instances have a given association.
 	 */
-	bool instancesHaveAssociation(const struct associationMap &association,
+	bool instancesHaveAssociation(const AssociationEdge &edge,
 		Instance &antInstance, InstanceFactory &antFactory,
 		Instance &depInstance, InstanceFactory &depFactory);
 };
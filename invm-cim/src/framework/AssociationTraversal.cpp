@@ -0,0 +1,250 @@
+/*
+ * Copyright (c) 2015 2016, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of Intel Corporation nor the names of its contributors
+ *     may be used to endorse or promote products derived from this software
+ *     without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * This file contains the implementation of the multi-hop association traversal.
+ */
+
+#include <algorithm>
+#include <map>
+
+#include <logger/logging.h>
+#include "AssociationTraversal.h"
+#include "AssociationFactory.h"
+#include "ProviderFactory.h"
+#include "RequestContext.h"
+
+namespace wbem
+{
+namespace framework
+{
+
+/*
+ * Helper to delete the association factories handed out by the provider
+ */
+static void deleteFactories(std::vector<InstanceFactory *> &factories)
+{
+	for (size_t i = 0; i < factories.size(); i++)
+	{
+		delete factories[i];
+	}
+	factories.clear();
+}
+
+AssociationTraversal::AssociationTraversal(const std::vector<AssociationStep> &steps)
+	: m_steps(steps)
+{
+}
+
+instances_t *AssociationTraversal::traverse(const Instance &start,
+		std::vector<instance_names_t> *pPaths)
+{
+	LogEnterExit logging(__FILE__, __FUNCTION__, __LINE__);
+	COMMON_LOG_DEBUG_F("Traversing %d steps from %s",
+			(int) m_steps.size(), start.getClass().c_str());
+
+	ClassEnumerationCache cache;
+	instances_t frontier;
+	frontier.push_back(start);
+
+	// for every step, where each instance of that step's frontier was reached from
+	std::vector<std::vector<size_t> > frontierSources;
+	// only kept when the caller wants the paths
+	std::vector<instance_names_t> frontierPaths;
+	if (pPaths)
+	{
+		frontierPaths.push_back(instance_names_t(1, start.getObjectPath()));
+	}
+
+	size_t step = 0;
+	for (; step < m_steps.size() && !frontier.empty() && !RequestContext::stopRequested(); step++)
+	{
+		instances_t results;
+		std::vector<size_t> resultSources;
+		addStepResults(m_steps[step], frontier, cache, results, resultSources);
+		COMMON_LOG_DEBUG_F("Step %d reached %d instances", (int) step, (int) results.size());
+
+		if (pPaths)
+		{
+			instance_names_t paths;
+			for (size_t i = 0; i < results.size(); i++)
+			{
+				paths.push_back(results[i].getObjectPath());
+			}
+			frontierPaths.push_back(paths);
+		}
+		frontierSources.push_back(resultSources);
+		frontier.swap(results);
+	}
+
+	// a traversal that stopped early hasn't reached the end of the chain
+	if (step < m_steps.size())
+	{
+		frontier.clear();
+	}
+
+	if (pPaths)
+	{
+		pPaths->clear();
+		for (size_t i = 0; i < frontier.size(); i++)
+		{
+			instance_names_t path(frontierPaths.size());
+			size_t index = i;
+			for (size_t level = frontierPaths.size(); level > 0; level--)
+			{
+				path[level - 1] = frontierPaths[level - 1][index];
+				if (level > 1)
+				{
+					index = frontierSources[level - 2][index];
+				}
+			}
+			pPaths->push_back(path);
+		}
+	}
+
+	return new instances_t(frontier);
+}
+
+void AssociationTraversal::addStepResults(const AssociationStep &step,
+		const instances_t &sources, ClassEnumerationCache &cache,
+		instances_t &results, std::vector<size_t> &resultSources)
+{
+	// the association factories depend on the class of the source instance
+	std::map<std::string, std::vector<size_t> > sourcesByClass;
+	for (size_t i = 0; i < sources.size(); i++)
+	{
+		sourcesByClass[sources[i].getClass()].push_back(i);
+	}
+
+	instances_t unordered;
+	std::vector<size_t> unorderedSources;
+	for (std::map<std::string, std::vector<size_t> >::const_iterator iter = sourcesByClass.begin();
+			iter != sourcesByClass.end() && !RequestContext::stopRequested(); iter++)
+	{
+		const std::vector<size_t> &classIndexes = iter->second;
+		instances_t classSources;
+		for (size_t i = 0; i < classIndexes.size(); i++)
+		{
+			classSources.push_back(sources[classIndexes[i]]);
+		}
+
+		instances_t classResults;
+		std::vector<size_t> classResultSources;
+		addClassStepResults(step, classSources, cache, classResults, classResultSources);
+		for (size_t i = 0; i < classResults.size(); i++)
+		{
+			unordered.push_back(classResults[i]);
+			unorderedSources.push_back(classIndexes[classResultSources[i]]);
+		}
+	}
+
+	// same order as asking for the associators of each source in turn
+	std::vector<size_t> order(unordered.size());
+	for (size_t i = 0; i < order.size(); i++)
+	{
+		order[i] = i;
+	}
+	std::stable_sort(order.begin(), order.end(),
+		[&unorderedSources](size_t lhs, size_t rhs)
+		{
+			return unorderedSources[lhs] < unorderedSources[rhs];
+		});
+	for (size_t i = 0; i < order.size(); i++)
+	{
+		results.push_back(unordered[order[i]]);
+		resultSources.push_back(unorderedSources[order[i]]);
+	}
+}
+
+void AssociationTraversal::addClassStepResults(const AssociationStep &step,
+		const instances_t &sources, ClassEnumerationCache &cache,
+		instances_t &results, std::vector<size_t> &resultSources)
+{
+	Instance representative(sources.front());
+	std::vector<InstanceFactory *> factories = ProviderFactory::getAssociationFactoriesStatic(
+			&representative,
+			step.associationClassName, step.resultClassName,
+			step.roleName, step.resultRoleName);
+
+	bool joinAll = true;
+	for (size_t f = 0; f < factories.size(); f++)
+	{
+		AssociationFactory *pFactory = dynamic_cast<AssociationFactory *>(factories[f]);
+		joinAll = joinAll &&
+				(factories[f] == NULL || (pFactory != NULL && pFactory->joinsAssociationTable()));
+	}
+
+	try
+	{
+		if (joinAll)
+		{
+			for (size_t f = 0; f < factories.size(); f++)
+			{
+				AssociationFactory *pFactory = dynamic_cast<AssociationFactory *>(factories[f]);
+				if (pFactory)
+				{
+					pFactory->getAssociatedInstances(sources, cache, results, resultSources);
+				}
+			}
+			deleteFactories(factories);
+		}
+		else
+		{
+			// a custom association factory only knows about the instance it was created for
+			deleteFactories(factories);
+			for (size_t s = 0; s < sources.size() && !RequestContext::stopRequested(); s++)
+			{
+				Instance source(sources[s]);
+				ObjectPath sourcePath = source.getObjectPath();
+				factories = ProviderFactory::getAssociationFactoriesStatic(&source,
+						step.associationClassName, step.resultClassName,
+						step.roleName, step.resultRoleName);
+				for (size_t f = 0; f < factories.size(); f++)
+				{
+					if (factories[f] == NULL)
+					{
+						continue;
+					}
+					size_t before = results.size();
+					factories[f]->getAssociatedInstances(sourcePath, results);
+					resultSources.resize(results.size(), s);
+					COMMON_LOG_DEBUG_F("Got %d associators one at a time",
+							(int) (results.size() - before));
+				}
+				deleteFactories(factories);
+			}
+		}
+	}
+	catch (Exception &)
+	{
+		deleteFactories(factories);
+		throw;
+	}
+}
+
+} // framework
+} // wbem
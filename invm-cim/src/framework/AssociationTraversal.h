@@ -0,0 +1,119 @@
+/*
+ * Copyright (c) 2015 2016, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of Intel Corporation nor the names of its contributors
+ *     may be used to endorse or promote products derived from this software
+ *     without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * This file defines a multi-hop walk over the provider's associations.
+ */
+
+#ifndef	_WBEM_FRAMEWORK_ASSOCIATION_TRAVERSAL_H_
+#define	_WBEM_FRAMEWORK_ASSOCIATION_TRAVERSAL_H_
+
+#include <string>
+#include <vector>
+
+#include "Instance.h"
+#include "InstanceFactory.h"
+#include "AssociationMapper.h"
+#include "Export.h"
+
+namespace wbem
+{
+namespace framework
+{
+
+/*!
+ * One hop of an association traversal. The fields filter the hop the same way the
+ * parameters of an associators request do. Empty fields don't filter.
+ */
+struct AssociationStep
+{
+	AssociationStep(const std::string &associationClassName = "",
+			const std::string &resultClassName = "",
+			const std::string &roleName = "",
+			const std::string &resultRoleName = "")
+		: associationClassName(associationClassName), resultClassName(resultClassName),
+		roleName(roleName), resultRoleName(resultRoleName) {}
+
+	std::string associationClassName;
+	std::string resultClassName;
+	std::string roleName;
+	std::string resultRoleName;
+};
+
+/*!
+ * Follows a chain of associations from a starting instance, e.g. from a DIMM to its memory
+ * pool to the pool's namespaces.
+ * @remarks Each hop joins every instance reached by the previous hop at once instead of
+ * running one associators request per instance, and each class is enumerated at most once
+ * for the whole traversal.
+ */
+class INVM_CIM_API AssociationTraversal
+{
+	public:
+		/*!
+		 * Initialize a traversal.
+		 * @param[in] steps
+		 * 		The hops to follow, in order.
+		 */
+		AssociationTraversal(const std::vector<AssociationStep> &steps);
+
+		/*!
+		 * Follow the steps from an instance.
+		 * @param[in] start
+		 * 		The instance to start from.
+		 * @param[out] pPaths
+		 * 		If not NULL, gets the object paths from start to each returned instance,
+		 * 		in the same order as the returned instances.
+		 * @return The instances reached by the last step, once for every path reaching
+		 * 		them. The caller is responsible for deleting the list.
+		 * @throw Exception if an association factory fails.
+		 */
+		instances_t *traverse(const Instance &start,
+				std::vector<instance_names_t> *pPaths = NULL);
+
+	private:
+		/*
+		 * Take one step from every instance in sources. Each instance reached is added to
+		 * results along with the index of the source it was reached from.
+		 */
+		void addStepResults(const AssociationStep &step, const instances_t &sources,
+				ClassEnumerationCache &cache,
+				instances_t &results, std::vector<size_t> &resultSources);
+
+		/*
+		 * Take one step from a group of instances of the same class.
+		 */
+		void addClassStepResults(const AssociationStep &step, const instances_t &sources,
+				ClassEnumerationCache &cache,
+				instances_t &results, std::vector<size_t> &resultSources);
+
+		std::vector<AssociationStep> m_steps;
+};
+
+} // framework
+} // wbem
+#endif  // _WBEM_FRAMEWORK_ASSOCIATION_TRAVERSAL_H_
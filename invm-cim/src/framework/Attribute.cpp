@@ -41,6 +41,7 @@
 #include <iomanip>
 #include "Attribute.h"
 #include "ExceptionBadParameter.h"
+#include "ObjectPath.h"
 
 wbem::framework::Attribute::~Attribute()
 {
@@ -105,6 +106,9 @@ wbem::framework::Attribute::Attribute(const wbem::framework::Attribute &attribut
 		case BOOLEAN_LIST_T:
 			m_BooleanList = attribute.m_BooleanList;
 			break;
+		case REFERENCE_T:
+			m_pReference = attribute.m_pReference;
+			break;
 		case ENUM16_T:
 			m_Str = attribute.m_Str;
 			m_Value.uint16 = attribute.m_Value.uint16;
@@ -287,6 +291,15 @@ wbem::framework::Attribute::Attribute(const UINT64 value, enum DatetimeSubtype t
 	m_IsAssociationClassInstance = false;
 }
 
+wbem::framework::Attribute::Attribute(const ObjectPath &reference, bool isKey)
+	: m_pReference(new ObjectPath(reference))
+{
+	m_Type = REFERENCE_T;
+	m_IsKey = isKey;
+	m_IsEmbedded = false;
+	m_IsAssociationClassInstance = true;
+}
+
 wbem::framework::Attribute::Attribute(UINT8_LIST values, bool isKey)
 {
 	m_Type = UINT8_LIST_T;
@@ -384,10 +397,20 @@ std::string wbem::framework::Attribute::stringValue() const
 		convert_seconds_to_datetime_interval(m_Value.uint64, interval);
 		return interval;
 	}
+	if (m_Type == REFERENCE_T)
+	{
+		return m_pReference->asString(true);
+	}
 	COMMON_LOG_WARN_F("Attempted to get stringValue of an attribute of type: %d", m_Type);
 	return std::string();
 }
 
+const std::string &wbem::framework::Attribute::stringRef() const
+{
+	static const std::string emptyStr;
+	return (m_Type == STR_T || m_Type == ENUM_T || m_Type == ENUM16_T) ? m_Str : emptyStr;
+}
+
 
 /*
  * Convert the value to an integer and return
@@ -739,6 +762,26 @@ wbem::framework::BOOLEAN_LIST wbem::framework::Attribute::booleanListValue() con
 	return result;
 }
 
+wbem::framework::ObjectPath wbem::framework::Attribute::referenceValue() const
+{
+	ObjectPath result;
+	if (m_Type == REFERENCE_T)
+	{
+		result = *m_pReference;
+	}
+	else
+	{
+		COMMON_LOG_ERROR("Invalid type.");
+	}
+	return result;
+}
+
+const wbem::framework::ObjectPath &wbem::framework::Attribute::referenceRef() const
+{
+	static const ObjectPath emptyPath;
+	return m_Type == REFERENCE_T ? *m_pReference : emptyPath;
+}
+
 wbem::framework::Attribute& wbem::framework::Attribute::operator=(const Attribute& rhs)
 {
 	if (this == &rhs)
@@ -806,6 +849,9 @@ wbem::framework::Attribute& wbem::framework::Attribute::operator=(const Attribut
 		case BOOLEAN_LIST_T:
 			m_BooleanList = rhs.m_BooleanList;
 			break;
+		case REFERENCE_T:
+			m_pReference = rhs.m_pReference;
+			break;
 		case ENUM16_T:
 			m_Str = rhs.m_Str;
 			m_Value.uint16 = rhs.m_Value.uint16;
@@ -938,6 +984,9 @@ std::string wbem::framework::Attribute::asStr(std::string prefix, std::string su
 			convert_seconds_to_datetime_interval(m_Value.uint64, datetime);
 			result << datetime;
 			break;
+		case REFERENCE_T:
+			result << m_pReference->asString(true);
+			break;
 		default:
 			COMMON_LOG_ERROR_F("Invalid attribute type %d", m_Type);
 			break;
@@ -1094,6 +1143,9 @@ bool wbem::framework::Attribute::operator==(const Attribute& rhs) const
 			case STR_T:
 				result = (this->m_Str == rhs.stringValue());
 				break;
+			case REFERENCE_T:
+				result = (this->stringValue() == rhs.stringValue());
+				break;
 			case UINT8_LIST_T:
 				result = listEqual(this->m_UInt8List, rhs.uint8ListValue());
 				break;
@@ -1138,6 +1190,11 @@ bool wbem::framework::Attribute::typesMatch(enum DataType lhs, enum DataType rhs
 		{
 			match = ((rhs == ENUM16_T) || (rhs == UINT16_T));
 		}
+		// references used to be stored as strings, they still compare equal
+		else if ((lhs == STR_T) || (lhs == REFERENCE_T))
+		{
+			match = ((rhs == STR_T) || (rhs == REFERENCE_T));
+		}
 	}
 	return match;
 }
@@ -1186,7 +1243,7 @@ void wbem::framework::Attribute::normalize()
 }
 
 
-bool wbem::framework::Attribute::isEmbedded()
+bool wbem::framework::Attribute::isEmbedded() const
 {
 	return m_IsEmbedded && m_Type == STR_T;
 }
@@ -1197,9 +1254,9 @@ void wbem::framework::Attribute::setIsEmbedded(bool value)
 	m_IsEmbedded = value;
 }
 
-bool wbem::framework::Attribute::isAssociationClassInstance()
+bool wbem::framework::Attribute::isAssociationClassInstance() const
 {
-	return m_IsAssociationClassInstance && m_Type == STR_T;
+	return m_Type == REFERENCE_T || (m_IsAssociationClassInstance && m_Type == STR_T);
 }
 
 void wbem::framework::Attribute::setIsAssociationClassInstance(bool value)
@@ -36,6 +36,7 @@
 
 #include <string>
 #include <map>
+#include <memory>
 #include <vector>
 
 #include "Exception.h"
@@ -47,6 +48,8 @@ namespace wbem
 namespace framework
 {
 
+class ObjectPath;
+
 /*!
  * Subtypes of the datetime type
  */
@@ -81,7 +84,8 @@ enum DataType
 	ENUM_T,       //!< Enumeration meaning a string and an integer.
 	ENUM16_T,	  //!< Enumeration with the integer as a uint16
 	DATETIME_T,	//!< datetime
-	DATETIME_INTERVAL_T //!< datetime interval
+	DATETIME_INTERVAL_T, //!< datetime interval
+	REFERENCE_T	//!< reference to another instance
 };
 
 /*!
@@ -224,6 +228,17 @@ class INVM_CIM_API Attribute
 		Attribute(UINT64 value, enum DatetimeSubtype type, bool isKey)
 			throw (Exception);
 
+		/*!
+		 * Constructor for a reference attribute.
+		 * @param[in] reference
+		 * 		The object path of the referenced instance.
+		 * @param[in] isKey
+		 * 		True if this attribute is a key of the Instance.
+		 * @remarks The path is only converted to a string when the attribute is
+		 * 		asked for its string value.
+		 */
+		Attribute(const ObjectPath &reference, bool isKey);
+
 		/*!
 		 * Constructor for a signed 8 bit integer attribute.
 		 * @param[in] value
@@ -390,6 +405,12 @@ class INVM_CIM_API Attribute
 		 */
 		std::string stringValue() const;
 
+		/*!
+		 * Retrieve the value of a string or enumeration attribute without copying it.
+		 * @return Returns the attribute value or an empty string for any other type.
+		 */
+		const std::string &stringRef() const;
+
 		/*!
 		 * Retrieve the attribute value as an integer.
 		 * @return The attribute value or 0 for a non-number type attribute.
@@ -463,6 +484,18 @@ class INVM_CIM_API Attribute
 		 */
 		BOOLEAN_LIST booleanListValue() const;
 
+		/*!
+		 * Retrieve the object path of a reference attribute.
+		 * @return The referenced object path or an empty path if not type REFERENCE_T.
+		 */
+		ObjectPath referenceValue() const;
+
+		/*!
+		 * Retrieve the object path of a reference attribute without copying it.
+		 * @return The referenced object path or an empty path if not type REFERENCE_T.
+		 */
+		const ObjectPath &referenceRef() const;
+
 		/*!
 		 * Retrieve the attribute type.
 		 * @return The attribute type enumeration value.
@@ -479,11 +512,11 @@ class INVM_CIM_API Attribute
 		 */
 		bool operator !=(const Attribute& rhs) const;
 
-	bool isEmbedded();
+	bool isEmbedded() const;
 
 	void setIsEmbedded(bool value);
 
-	bool isAssociationClassInstance();
+	bool isAssociationClassInstance() const;
 
 	void setIsAssociationClassInstance(bool value);
 
@@ -520,6 +553,8 @@ private:
 		UINT64_LIST m_UInt64List;
 		STR_LIST m_StrList;
 		BOOLEAN_LIST m_BooleanList;
+		// shared between copies, a reference is never modified once built
+		std::shared_ptr<const ObjectPath> m_pReference;
 
 		/*
 		 * Helper function to compare lists of values
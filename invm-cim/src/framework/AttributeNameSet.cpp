@@ -0,0 +1,106 @@
+/*
+ * Copyright (c) 2015 2016, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of Intel Corporation nor the names of its contributors
+ *     may be used to endorse or promote products derived from this software
+ *     without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * This file contains the implementation of a case-insensitive set of attribute names.
+ */
+
+#include <cctype>
+
+#include "AttributeNameSet.h"
+
+/*
+ * FNV-1a over the lowercased characters so that names differing only in case hash alike
+ */
+size_t wbem::framework::AttributeNameHash::operator()(const std::string &name) const
+{
+	size_t hash = 2166136261u;
+	for (std::string::const_iterator iter = name.begin(); iter != name.end(); iter++)
+	{
+		hash ^= (size_t)tolower((unsigned char)*iter);
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+bool wbem::framework::AttributeNameEqual::operator()(
+		const std::string &lhs, const std::string &rhs) const
+{
+	if (lhs.size() != rhs.size())
+	{
+		return false;
+	}
+	for (size_t i = 0; i < lhs.size(); i++)
+	{
+		if (tolower((unsigned char)lhs[i]) != tolower((unsigned char)rhs[i]))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+wbem::framework::AttributeNameSet::AttributeNameSet()
+{
+}
+
+wbem::framework::AttributeNameSet::AttributeNameSet(const attribute_names_t &names)
+{
+	m_set.reserve(names.size());
+	for (attribute_names_t::const_iterator iter = names.begin(); iter != names.end(); iter++)
+	{
+		insert(*iter);
+	}
+}
+
+void wbem::framework::AttributeNameSet::insert(const std::string &name)
+{
+	// first one in wins, duplicates that differ only in case are dropped
+	if (m_set.insert(name).second)
+	{
+		m_names.push_back(name);
+	}
+}
+
+bool wbem::framework::AttributeNameSet::contains(const std::string &name) const
+{
+	return m_set.find(name) != m_set.end();
+}
+
+bool wbem::framework::AttributeNameSet::getCanonicalName(const std::string &name,
+		std::string &canonicalName) const
+{
+	bool found = false;
+	std::unordered_set<std::string, AttributeNameHash, AttributeNameEqual>::const_iterator iter =
+			m_set.find(name);
+	if (iter != m_set.end())
+	{
+		canonicalName = *iter;
+		found = true;
+	}
+	return found;
+}
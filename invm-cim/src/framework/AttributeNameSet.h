@@ -0,0 +1,124 @@
+/*
+ * Copyright (c) 2015 2016, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of Intel Corporation nor the names of its contributors
+ *     may be used to endorse or promote products derived from this software
+ *     without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * This file defines a case-insensitive set of attribute names.
+ */
+
+#ifndef	_WBEM_FRAMEWORK_ATTRIBUTE_NAME_SET_H_
+#define	_WBEM_FRAMEWORK_ATTRIBUTE_NAME_SET_H_
+
+#include <string>
+#include <unordered_set>
+
+#include "Attribute.h"
+
+namespace wbem
+{
+namespace framework
+{
+
+/*!
+ * Hash functor for attribute names that ignores case.
+ */
+struct INVM_CIM_API AttributeNameHash
+{
+	size_t operator()(const std::string &name) const;
+};
+
+/*!
+ * Equality functor for attribute names that ignores case.
+ */
+struct INVM_CIM_API AttributeNameEqual
+{
+	bool operator()(const std::string &lhs, const std::string &rhs) const;
+};
+
+/*!
+ * A hashed set of attribute names that are matched without regard to case.
+ * The names are stored as they were inserted so the canonical (MOF) case of
+ * a requested name can be recovered.
+ */
+class INVM_CIM_API AttributeNameSet
+{
+	public:
+		/*!
+		 * Initialize an empty set.
+		 */
+		AttributeNameSet();
+
+		/*!
+		 * Initialize a set from a list of attribute names.
+		 * @param[in] names
+		 * 		The attribute names in their canonical case.
+		 */
+		AttributeNameSet(const attribute_names_t &names);
+
+		/*!
+		 * Add an attribute name to the set.
+		 * @param[in] name
+		 * 		The attribute name in its canonical case.
+		 */
+		void insert(const std::string &name);
+
+		/*!
+		 * Determine if the set contains an attribute name.
+		 * @param[in] name
+		 * 		The attribute name, in any case.
+		 * @return
+		 * 		true if the name is in the set.
+		 */
+		bool contains(const std::string &name) const;
+
+		/*!
+		 * Look up the canonical case of an attribute name.
+		 * @param[in] name
+		 * 		The attribute name, in any case.
+		 * @param[out] canonicalName
+		 * 		The name as it was inserted into the set.
+		 * @return
+		 * 		true if the name is in the set.
+		 */
+		bool getCanonicalName(const std::string &name, std::string &canonicalName) const;
+
+		/*!
+		 * Retrieve the attribute names in the order they were inserted.
+		 */
+		const attribute_names_t &getNames() const { return m_names; }
+
+		size_t size() const { return m_names.size(); }
+
+		bool empty() const { return m_names.empty(); }
+
+	private:
+		std::unordered_set<std::string, AttributeNameHash, AttributeNameEqual> m_set;
+		attribute_names_t m_names;
+};
+
+} // framework
+} // wbem
+#endif  // _WBEM_FRAMEWORK_ATTRIBUTE_NAME_SET_H_
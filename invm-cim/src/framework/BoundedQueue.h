@@ -0,0 +1,129 @@
+/*
+ * Copyright (c) 2015 2016, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of Intel Corporation nor the names of its contributors
+ *     may be used to endorse or promote products derived from this software
+ *     without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * This file defines a blocking queue of limited size for passing work between threads.
+ */
+
+#ifndef	_WBEM_FRAMEWORK_BOUNDED_QUEUE_H_
+#define	_WBEM_FRAMEWORK_BOUNDED_QUEUE_H_
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <utility>
+
+namespace wbem
+{
+namespace framework
+{
+
+/*!
+ * A first-in first-out queue between a producer and a consumer thread. The producer waits
+ * while the queue is full and the consumer waits while it is empty, so neither can get more
+ * than the capacity ahead of the other.
+ * @remarks Either side closes the queue when it is done. Closing wakes every waiting thread;
+ * items already queued can still be taken.
+ */
+template <class T>
+class BoundedQueue
+{
+	public:
+		/*!
+		 * @param[in] capacity
+		 * 		The most items held at once. At least one is allowed.
+		 */
+		BoundedQueue(const size_t capacity) :
+			m_capacity(capacity > 0 ? capacity : 1), m_closed(false) {}
+
+		/*!
+		 * Add an item to the back of the queue, waiting while the queue is full.
+		 * @param[in,out] item
+		 * 		The item. Its contents are moved into the queue.
+		 * @return
+		 * 		false if the queue is closed, in which case the item is left alone.
+		 */
+		bool push(T &item)
+		{
+			std::unique_lock<std::mutex> lock(m_lock);
+			m_notFull.wait(lock, [this]() { return m_closed || m_items.size() < m_capacity; });
+			bool pushed = !m_closed;
+			if (pushed)
+			{
+				m_items.push_back(std::move(item));
+				m_notEmpty.notify_one();
+			}
+			return pushed;
+		}
+
+		/*!
+		 * Take the item at the front of the queue, waiting while the queue is empty.
+		 * @param[out] item
+		 * 		Receives the item.
+		 * @return
+		 * 		false once the queue is closed and empty.
+		 */
+		bool pop(T &item)
+		{
+			std::unique_lock<std::mutex> lock(m_lock);
+			m_notEmpty.wait(lock, [this]() { return m_closed || !m_items.empty(); });
+			bool popped = !m_items.empty();
+			if (popped)
+			{
+				item = std::move(m_items.front());
+				m_items.pop_front();
+				m_notFull.notify_one();
+			}
+			return popped;
+		}
+
+		/*!
+		 * Stop accepting items.
+		 */
+		void close()
+		{
+			std::lock_guard<std::mutex> lock(m_lock);
+			m_closed = true;
+			m_notFull.notify_all();
+			m_notEmpty.notify_all();
+		}
+
+	private:
+		BoundedQueue(const BoundedQueue &);
+		BoundedQueue &operator=(const BoundedQueue &);
+
+		const size_t m_capacity;
+		std::mutex m_lock;
+		std::condition_variable m_notFull;
+		std::condition_variable m_notEmpty;
+		std::deque<T> m_items;
+		bool m_closed;
+};
+
+} // framework
+} // wbem
+#endif  // _WBEM_FRAMEWORK_BOUNDED_QUEUE_H_
@@ -33,6 +33,7 @@
 #include <algorithm>
 #include <sstream>
 #include <map>
+#include <mutex>
 #include <iomanip>
 #include <string/s_str.h>
 #include <rapidxml.hpp>
@@ -42,6 +43,7 @@
 
 #include "ExceptionBadParameter.h"
 #include "ExceptionNotSupported.h"
+#include "ObjectPathBuilder.h"
 #include "StringUtil.h"
 
 /*
@@ -200,6 +202,12 @@ wbem::framework::Attribute wbem::framework::CimXml::createAttribute(std::string
 			return Attribute(toType<UINT64>(value), DATETIME_SUBTYPE_DATETIME, isKey);
 		case DATETIME_INTERVAL_T:
 			return Attribute(toType<UINT64>(value), DATETIME_SUBTYPE_INTERVAL, isKey);
+		case REFERENCE_T:
+		{
+			ObjectPath reference;
+			ObjectPathBuilder(value).Build(&reference);
+			return Attribute(reference, isKey);
+		}
 		case UINT16_LIST_T:
 			return Attribute(createList<UINT16>(pValue), isKey);
 		case UINT32_LIST_T:
@@ -250,23 +258,28 @@ std::vector<T> wbem::framework::CimXml::createList(rapidxml::xml_node<> *pValueA
  */
 void wbem::framework::CimXml::setupMap()
 {
-	if(m_enumStringMap.size() == 0)
-	{
-		m_enumStringMap[BOOLEAN_T] = "boolean";
-		m_enumStringMap[UINT8_T] = "uint8";
-		m_enumStringMap[UINT16_T] = "uint16";
-		m_enumStringMap[UINT32_T] = "uint32";
-		m_enumStringMap[UINT64_T] = "uint64";
-		m_enumStringMap[SINT8_T] = "int8";
-		m_enumStringMap[SINT16_T] = "int16";
-		m_enumStringMap[SINT32_T] = "int32";
-		m_enumStringMap[SINT64_T] = "int64";
-		m_enumStringMap[STR_T] = "string";
-		m_enumStringMap[ENUM_T] = "enum";
-		m_enumStringMap[ENUM16_T] = "enum";
-		m_enumStringMap[DATETIME_T] = "datetime";
-		m_enumStringMap[DATETIME_INTERVAL_T] = "datetime_interval";
-	}
+	// only fill the map once, even if multiple threads get here first
+	static std::once_flag mapInitialized;
+	std::call_once(mapInitialized, fillMap);
+}
+
+void wbem::framework::CimXml::fillMap()
+{
+	m_enumStringMap[BOOLEAN_T] = "boolean";
+	m_enumStringMap[UINT8_T] = "uint8";
+	m_enumStringMap[UINT16_T] = "uint16";
+	m_enumStringMap[UINT32_T] = "uint32";
+	m_enumStringMap[UINT64_T] = "uint64";
+	m_enumStringMap[SINT8_T] = "int8";
+	m_enumStringMap[SINT16_T] = "int16";
+	m_enumStringMap[SINT32_T] = "int32";
+	m_enumStringMap[SINT64_T] = "int64";
+	m_enumStringMap[STR_T] = "string";
+	m_enumStringMap[ENUM_T] = "enum";
+	m_enumStringMap[ENUM16_T] = "enum";
+	m_enumStringMap[DATETIME_T] = "datetime";
+	m_enumStringMap[DATETIME_INTERVAL_T] = "datetime_interval";
+	m_enumStringMap[REFERENCE_T] = "reference";
 }
 
 /*
@@ -138,6 +138,7 @@ class INVM_CIM_API CimXml
 
 		static std::map<enum DataType, std::string> m_enumStringMap;
 		static void setupMap();
+		static void fillMap();
 
 		typedef std::pair<enum DataType, std::string> enumString_t;
 		typedef std::map<enum DataType, std::string>::iterator enumStringIterator_t;
@@ -0,0 +1,147 @@
+/*
+ * Copyright (c) 2015 2016, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of Intel Corporation nor the names of its contributors
+ *     may be used to endorse or promote products derived from this software
+ *     without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * This file implements the registry of activated indication filters.
+ */
+
+#include <vector>
+#include <logger/logging.h>
+#include "CimomAdapter.h"
+#include "IndicationFilterRegistry.h"
+
+namespace wbem
+{
+namespace framework
+{
+
+IndicationFilterRegistry::IndicationFilterRegistry()
+{
+}
+
+IndicationFilterRegistry &IndicationFilterRegistry::getSingleton()
+{
+	static IndicationFilterRegistry registry;
+	return registry;
+}
+
+bool IndicationFilterRegistry::activate(const std::string &query)
+{
+	LogEnterExit logging(__FILE__, __FUNCTION__, __LINE__);
+
+	struct Filter filter;
+	filter.classOnly = false;
+	filter.activations = 0;
+	try
+	{
+		filter.pPlan = WqlPlanCache::getSingleton().getPlan(query);
+		const WqlConditional *pConditional = filter.pPlan->getQuery().getConditional();
+		if (pConditional)
+		{
+			const std::vector<struct WqlComparisonClause> &clauses =
+					pConditional->getConditions();
+			for (size_t i = 0; i < clauses.size() && !filter.classOnly; i++)
+			{
+				filter.classOnly = clauses[i].op == OP_ISA;
+			}
+		}
+	}
+	catch (Exception &e)
+	{
+		COMMON_LOG_WARN_F("Filter '%s' isn't a supported WQL query, not filtering: %s",
+				query.c_str(), e.what());
+	}
+
+	std::lock_guard<std::mutex> lock(m_lock);
+	std::string key = WqlPlanCache::getKey(query);
+	std::map<std::string, struct Filter>::iterator iFilter = m_filters.find(key);
+	if (iFilter == m_filters.end())
+	{
+		iFilter = m_filters.insert(std::make_pair(key, filter)).first;
+	}
+	iFilter->second.activations++;
+	return filter.pPlan.get() != NULL;
+}
+
+void IndicationFilterRegistry::deactivate(const std::string &query)
+{
+	LogEnterExit logging(__FILE__, __FUNCTION__, __LINE__);
+
+	std::lock_guard<std::mutex> lock(m_lock);
+	std::map<std::string, struct Filter>::iterator iFilter =
+			m_filters.find(WqlPlanCache::getKey(query));
+	if (iFilter == m_filters.end())
+	{
+		COMMON_LOG_WARN_F("Filter '%s' wasn't active", query.c_str());
+	}
+	else if (--iFilter->second.activations == 0)
+	{
+		m_filters.erase(iFilter);
+	}
+}
+
+bool IndicationFilterRegistry::isWanted(const Instance &indication)
+{
+	// evaluate outside the lock, classIsA may need to ask the CIMOM
+	std::vector<struct Filter> filters;
+	{
+		std::lock_guard<std::mutex> lock(m_lock);
+		for (std::map<std::string, struct Filter>::const_iterator iFilter = m_filters.begin();
+				iFilter != m_filters.end(); iFilter++)
+		{
+			filters.push_back(iFilter->second);
+		}
+	}
+
+	bool wanted = filters.empty();
+	std::string className = indication.getClass();
+	for (size_t i = 0; i < filters.size() && !wanted; i++)
+	{
+		const WqlPlan *pPlan = filters[i].pPlan.get();
+		// if the CIMOM can't say whether the class matches, let the CIMOM decide
+		bool isA = false;
+		wanted = !pPlan ||
+				!classIsA(className, pPlan->getQuery().getClassName(), isA) ||
+				(isA && (filters[i].classOnly || pPlan->getEvaluator().matches(indication)));
+	}
+	return wanted;
+}
+
+void IndicationFilterRegistry::clear()
+{
+	std::lock_guard<std::mutex> lock(m_lock);
+	m_filters.clear();
+}
+
+size_t IndicationFilterRegistry::size()
+{
+	std::lock_guard<std::mutex> lock(m_lock);
+	return m_filters.size();
+}
+
+} // framework
+} // wbem
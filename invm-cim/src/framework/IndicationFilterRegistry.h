@@ -0,0 +1,113 @@
+/*
+ * Copyright (c) 2015 2016, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of Intel Corporation nor the names of its contributors
+ *     may be used to endorse or promote products derived from this software
+ *     without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * This file defines the registry of activated indication filters, used to drop indications
+ * no subscriber wants before they are handed to the CIMOM.
+ */
+
+#ifndef	_WBEM_FRAMEWORK_INDICATION_FILTER_REGISTRY_H_
+#define	_WBEM_FRAMEWORK_INDICATION_FILTER_REGISTRY_H_
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "Instance.h"
+#include "WqlPlanCache.h"
+#include "Export.h"
+
+namespace wbem
+{
+namespace framework
+{
+
+/*!
+ * The indication filters the CIMOM has activated, each compiled to a WQL plan.
+ * @remarks An indication is wanted if it is an instance of the class of an active filter
+ * (or of a subclass) and satisfies the filter's conditional. A filter whose query can't be
+ * compiled wants every indication, as does a filter that uses ISA, since ISA is false
+ * here whenever the CIMOM can't tell the class hierarchy. With no active filters, every
+ * indication is wanted, so the CIMOM has the final say.
+ */
+class INVM_CIM_API IndicationFilterRegistry
+{
+	public:
+		IndicationFilterRegistry();
+
+		/*!
+		 * Get the registry shared by the provider.
+		 */
+		static IndicationFilterRegistry &getSingleton();
+
+		/*!
+		 * Add an activation of a filter. Filters with the same query are counted together.
+		 * @param query - the filter's query
+		 * @return false if the query couldn't be compiled
+		 */
+		bool activate(const std::string &query);
+
+		/*!
+		 * Remove an activation of a filter.
+		 * @param query - the filter's query
+		 */
+		void deactivate(const std::string &query);
+
+		/*!
+		 * Returns true if any active filter may want the indication.
+		 */
+		bool isWanted(const Instance &indication);
+
+		/*!
+		 * Remove every filter.
+		 */
+		void clear();
+
+		/*!
+		 * Returns the number of different filters active.
+		 */
+		size_t size();
+
+	protected:
+		/*
+		 * An active filter
+		 */
+		struct Filter
+		{
+			std::shared_ptr<const WqlPlan> pPlan; //!< NULL if the query couldn't be compiled
+			bool classOnly; //!< only the class can be checked
+			size_t activations;
+		};
+
+		std::mutex m_lock;
+		std::map<std::string, struct Filter> m_filters; //!< keyed by WqlPlanCache::getKey
+};
+
+} // framework
+} // wbem
+#endif  // _WBEM_FRAMEWORK_INDICATION_FILTER_REGISTRY_H_
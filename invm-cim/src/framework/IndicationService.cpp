@@ -29,8 +29,24 @@
  * File Description
  */
 #include "IndicationService.h"
+#include "AssociationIndex.h"
 
 wbem::framework::IndicationService::IndicationService()
 {
 	m_pContext = NULL;
 }
+
+void wbem::framework::IndicationService::instanceCreated(const ObjectPath &path)
+{
+	AssociationIndex::getSingleton().instanceCreated(path);
+}
+
+void wbem::framework::IndicationService::instanceDeleted(const ObjectPath &path)
+{
+	AssociationIndex::getSingleton().instanceDeleted(path);
+}
+
+void wbem::framework::IndicationService::instanceModified(const ObjectPath &path)
+{
+	AssociationIndex::getSingleton().instanceModified(path);
+}
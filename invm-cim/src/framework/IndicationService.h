@@ -29,6 +29,7 @@
 #ifndef INTEL_CIM_FRAMEWORK_INDICATIONSERVICE_H
 #define INTEL_CIM_FRAMEWORK_INDICATIONSERVICE_H
 
+#include "ObjectPath.h"
 #include "Export.h"
 
 namespace wbem
@@ -41,11 +42,25 @@ class INVM_CIM_API IndicationService
 public:
 	IndicationService();
 
+	/*
+	 * Start and stop sending indications through the adapter. The adapter stays valid after
+	 * stopIndicating and is passed again the next time indications are started, so a thread
+	 * that hasn't noticed the stop yet may still use it.
+	 */
 	virtual void startIndicating(CimomAdapter *pContext) = 0;
 	virtual void stopIndicating() = 0;
 
 	wbem::framework::CimomAdapter *getContext() { return m_pContext; }
 
+	/*
+	 * Report instance changes so the association index stays up to date. A provider that
+	 * turns on ProviderFactory::useAssociationIndex must report every change, whether or
+	 * not it is indicating.
+	 */
+	void instanceCreated(const ObjectPath &path);
+	void instanceDeleted(const ObjectPath &path);
+	void instanceModified(const ObjectPath &path);
+
 protected:
 	wbem::framework::CimomAdapter *m_pContext;
 };
@@ -31,7 +31,6 @@
 
 #include <sstream>
 
-#include "StringUtil.h"
 #include <string/s_str.h>
 #include "Instance.h"
 #include "CimXml.h"
@@ -108,6 +107,27 @@ int wbem::framework::Instance::getAttributeI(std::string &key, wbem::framework::
 	return wbem::framework::FAIL;
 }
 
+/*
+ * Find an attribute in this instance without copying it.
+ */
+const wbem::framework::Attribute *wbem::framework::Instance::findAttribute(
+		const std::string &key) const
+{
+	wbem::framework::attributes_t::const_iterator iter = m_InstanceAttributes.find(key);
+	if (iter == m_InstanceAttributes.end())
+	{
+		// case insensitive search
+		for (iter = m_InstanceAttributes.begin(); iter != m_InstanceAttributes.end(); ++iter)
+		{
+			if (key.length() == iter->first.length() &&
+					s_strncmpi(iter->first.c_str(), key.c_str(), iter->first.length()) == 0)
+			{
+				break;
+			}
+		}
+	}
+	return iter != m_InstanceAttributes.end() ? &iter->second : NULL;
+}
 
 /*
  * Get the object path for this instance
@@ -144,15 +164,12 @@ int wbem::framework::Instance::setAttribute(const std::string &key,
 		const framework::Attribute &value,
 		const framework::attribute_names_t &attributes)
 {
-	wbem::framework::Attribute newAttr;
-	getAttribute(key, newAttr);
-
 	// if the attribute list is empty or the attribute is specified, set it
-	bool found = false;
-	found = attributes.size() == 0;
+	bool found = attributes.empty();
+	AttributeNameEqual equal;
 	for (unsigned int i = 0; (i < attributes.size() && !found); i++)
 	{
-		if (StringUtil::stringCompareIgnoreCase(attributes[i], key))
+		if (equal(attributes[i], key))
 		{
 			found = true;
 		}
@@ -165,6 +182,22 @@ int wbem::framework::Instance::setAttribute(const std::string &key,
 	return wbem::framework::SUCCESS;
 }
 
+/*
+ * check attribute set before deciding to load an attribute.
+ */
+int wbem::framework::Instance::setAttribute(const std::string &key,
+		const framework::Attribute &value,
+		const framework::AttributeNameSet &attributes)
+{
+	// if the attribute set is empty or the attribute is specified, set it
+	if (attributes.empty() || attributes.contains(key))
+	{
+		setAttribute(key, value);
+	}
+
+	return wbem::framework::SUCCESS;
+}
+
 /*
  * Allows the caller to iterate over the attributes.
  */
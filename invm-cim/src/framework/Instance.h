@@ -35,6 +35,7 @@
 #include <map>
 #include <string>
 
+#include "AttributeNameSet.h"
 #include "Attribute.h"
 #include "Exception.h"
 #include "ObjectPath.h"
@@ -95,6 +96,17 @@ class INVM_CIM_API Instance
 		 */
 		int getAttributeI(std::string& key, wbem::framework::Attribute& value) const;
 
+		/*!
+		 * Find an attribute without copying it, trying the exact name first and then
+		 * ignoring case.
+		 * @param[in] key
+		 * 		The name of the attribute.
+		 * @return
+		 * 		The attribute, or NULL if it was not found. It is valid until the
+		 * 		instance is modified.
+		 */
+		const Attribute *findAttribute(const std::string &key) const;
+
 		/*!
 		 * Add the specified attribute.
 		 * @param[in] key
@@ -122,6 +134,22 @@ class INVM_CIM_API Instance
 		int setAttribute(const std::string& key, const framework::Attribute &value,
 			const framework::attribute_names_t &attributes);
 
+		/*!
+		 * Add the specified attribute if the specified set of attribute names is
+		 * empty (implying add all) or the set contains the name of the attribute.
+		 * @param key
+		 * 		The name of the attribute to add.
+		 * @param value
+		 * 		The attribute to add.
+		 * @param attributes
+		 * 		The set of attribute names.  An empty set means add all attributes.
+		 * @remarks This method is used for attribute filtering.
+		 * @return
+		 * 		wbem::framework::SUCCESS.
+		 */
+		int setAttribute(const std::string& key, const framework::Attribute &value,
+			const framework::AttributeNameSet &attributes);
+
 		/*!
 		 * Convert the instance into an NvmObjectPath.
 		 * @return
@@ -187,6 +215,17 @@ class INVM_CIM_API Instance
 		static void setAttributeToInstance(Instance *pInstance, attribute_names_t &attributes,
 				std::string &attributeKey, const T &attributeValue);
 
+		/*!
+		 *
+		 * @param pInstance
+		 * @param attributes
+		 * @param attributeKey
+		 * @param attributeValue
+		 */
+		template<typename T>
+		static void setAttributeToInstance(Instance *pInstance, const AttributeNameSet &attributes,
+				std::string &attributeKey, const T &attributeValue);
+
 		/*
 		 * Equality operator
 		 */
@@ -229,14 +268,39 @@ inline void wbem::framework::Instance::setAttributeToInstance(Instance* pInstanc
 		attribute_names_t& attributes, std::string& attributeKey, const T& attributeValue)
 {
 	// loop through each desired attribute name to see if attributeKey is wanted
+	AttributeNameEqual equal;
 	for (attribute_names_t::const_iterator iter=attributes.begin(); iter!=attributes.end(); ++iter)
 	{
-	if (iter->compare(attributeKey) == 0) // found attributeKey ... add
+		if (equal(*iter, attributeKey)) // found attributeKey ... add
 		{
 			framework::Attribute attribute(attributeValue, false);
 			pInstance->setAttribute(attributeKey, attribute);
+			break;
 		}
 	}
 }
 
+/*!
+ * Inline helper method to set the value of an attribute on the specified instance
+ * if it is included in the specified set of attribute names.
+ * @param pInstance
+ * 		The instance to set the value of the attribute on.
+ * @param attributes
+ * 		The set of attribute names.
+ * @param attributeKey
+ * 		The attribute name.
+ * @param attributeValue
+ * 		The attribute value.
+ */
+template<typename T>
+inline void wbem::framework::Instance::setAttributeToInstance(Instance* pInstance,
+		const AttributeNameSet& attributes, std::string& attributeKey, const T& attributeValue)
+{
+	if (attributes.contains(attributeKey))
+	{
+		framework::Attribute attribute(attributeValue, false);
+		pInstance->setAttribute(attributeKey, attribute);
+	}
+}
+
 #endif  // #ifndef _WBEM_FRAMEWORK_INSTANCE_H_
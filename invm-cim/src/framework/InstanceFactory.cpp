@@ -33,13 +33,97 @@
 #include <logger/logging.h>
 
 #include <algorithm>
+#include <mutex>
+#include <typeinfo>
+#include <unordered_map>
+#include <unordered_set>
 
+#include "AssociationIndex.h"
 #include "ExceptionBadAttribute.h"
 #include "ExceptionNotSupported.h"
 #include "InstanceFactory.h"
 
 #include "ProviderFactory.h"
 #include "ObjectPathBuilder.h"
+#include "RequestContext.h"
+#include "WqlPlanCache.h"
+#include "WqlPredicate.h"
+
+namespace
+{
+/* the provider keeps the association index up to date */
+bool useAssociationIndex()
+{
+	wbem::framework::ProviderFactory *pProviderFactory =
+			wbem::framework::ProviderFactory::getSingleton();
+	return pProviderFactory && pProviderFactory->useAssociationIndex();
+}
+
+/* results computed after the request was told to stop are partial and can't be indexed */
+bool requestTruncated()
+{
+	wbem::framework::RequestContext *pContext = wbem::framework::RequestContext::getCurrent();
+	return pContext && pContext->isTruncated();
+}
+
+/* collects streamed reference names into a list */
+class ReferenceNameCollector : public wbem::framework::ReferenceSink
+{
+	public:
+		ReferenceNameCollector(wbem::framework::instance_names_t &names) : m_names(names) {}
+
+		void addReference(const wbem::framework::ObjectPath &path,
+				const wbem::framework::Instance *pInstance)
+		{
+			m_names.push_back(path);
+		}
+
+	private:
+		wbem::framework::instance_names_t &m_names;
+};
+
+/* collects streamed reference instances into a list */
+class ReferenceInstanceCollector : public wbem::framework::ReferenceSink
+{
+	public:
+		ReferenceInstanceCollector(wbem::framework::instances_t &instances) : m_instances(instances) {}
+
+		void addReference(const wbem::framework::ObjectPath &path,
+				const wbem::framework::Instance *pInstance)
+		{
+			if (pInstance)
+			{
+				m_instances.push_back(*pInstance);
+			}
+		}
+
+	private:
+		wbem::framework::instances_t &m_instances;
+};
+
+/* passes references on while keeping a copy for the association index */
+class IndexingReferenceSink : public wbem::framework::ReferenceSink
+{
+	public:
+		IndexingReferenceSink(wbem::framework::ReferenceSink &sink,
+				wbem::framework::AssociationIndexEntry &entry) : m_sink(sink), m_entry(entry) {}
+
+		void addReference(const wbem::framework::ObjectPath &path,
+				const wbem::framework::Instance *pInstance)
+		{
+			m_entry.paths.push_back(path);
+			if (pInstance)
+			{
+				m_entry.instances.push_back(*pInstance);
+			}
+			m_sink.addReference(path, pInstance);
+		}
+
+	private:
+		wbem::framework::ReferenceSink &m_sink;
+		wbem::framework::AssociationIndexEntry &m_entry;
+};
+}
 
 wbem::framework::InstanceFactory::InstanceFactory()
 {
@@ -93,93 +177,247 @@ wbem::framework::instance_names_t* wbem::framework::InstanceFactory::getInstance
 	throw wbem::framework::ExceptionNotSupported(__FILE__, (char*) __func__);
 }
 
+/*
+ * Collects the instances from streamInstancesByName into a list
+ */
+class InstanceListSink : public wbem::framework::InstanceSink
+{
+	public:
+		InstanceListSink(wbem::framework::instances_t &instances) : m_instances(instances) {}
+
+		bool addInstance(wbem::framework::Instance &instance)
+		{
+			m_instances.push_back(std::move(instance));
+			return true;
+		}
+
+	private:
+		wbem::framework::instances_t &m_instances;
+};
+
 wbem::framework::instances_t* wbem::framework::InstanceFactory::getInstances(
 		attribute_names_t &attributes)
 {
 	LogEnterExit logging(__FILE__, __FUNCTION__, __LINE__);
 
-	// declarations visible to both try and catch
-	instance_names_t *pPaths = NULL;
-	instances_t *pInstList = NULL;
-
+	// create the return list
+	instances_t *pInstList = new framework::instances_t();
+	InstanceListSink sink(*pInstList);
 	try
 	{
-		checkAttributes(attributes);
+		if (!streamInstancesByName(attributes, sink))
+		{
+			delete pInstList;
+			pInstList = NULL;
+		}
+	}
+	// on error, cleanup but don't handle
+	catch (Exception &)
+	{
+		delete pInstList;
+		throw;
+	}
 
-		// get the instances names using intrinsic
-		pPaths = getInstanceNames();
+	return pInstList;
+}
 
-		if(pPaths != NULL)
-		{
-			// create the return list
-			pInstList = new framework::instances_t();
+bool wbem::framework::InstanceFactory::streamInstancesByName(attribute_names_t &attributes,
+		InstanceSink &sink)
+{
+	LogEnterExit logging(__FILE__, __FUNCTION__, __LINE__);
+
+	checkAttributes(attributes);
 
-			// loop through the names
-			for (framework::instance_names_t::iterator iter = pPaths->begin();
-					iter != pPaths->end(); iter++)
+	// get the instances names using intrinsic
+	instance_names_t *pPaths = getInstanceNames();
+	if (pPaths == NULL)
+	{
+		COMMON_LOG_ERROR("getInstanceNames() returned NULL");
+		return false;
+	}
+	rememberKeyNames(*pPaths);
+
+	try
+	{
+		// loop through the names until the sink has enough
+		bool wanted = true;
+		for (framework::instance_names_t::iterator iter = pPaths->begin();
+				iter != pPaths->end() && wanted && !RequestContext::stopRequested(); iter++)
+		{
+			framework::Instance* pInst = NULL;
+			try
 			{
-				framework::Instance* pInst = NULL;
-				try
+				// create an instance for the name, pass it on
+				pInst = getInstance(*iter, attributes);
+				if (pInst != NULL)
 				{
-					// create an instance for the name, add it to the list
-					pInst = getInstance(*iter, attributes);
-					if (pInst != NULL)
-					{
-						pInstList->push_back(*pInst);
-						delete pInst;
-					}
+					wanted = sink.addInstance(*pInst);
+					delete pInst;
 				}
-				// if a single instance fails, eat the exception and keep going
-				catch (framework::Exception &e)
+			}
+			// if a single instance fails, eat the exception and keep going
+			catch (framework::Exception &e)
+			{
+				if (pInst != NULL)
 				{
-					if (pInst != NULL)
-					{
-						delete pInst;
-					}
-					// if only one instance throw the exception
-					if (pPaths->size() == 1)
-					{
-						throw;
-					}
-					// else eat the exception and keep going
-					COMMON_LOG_WARN_F("Error adding instance: %s", e.what());
+					delete pInst;
+				}
+				// if only one instance throw the exception
+				if (pPaths->size() == 1)
+				{
+					throw;
 				}
+				// else eat the exception and keep going
+				COMMON_LOG_WARN_F("Error adding instance: %s", e.what());
 			}
 		}
-		else
-		{
-			COMMON_LOG_ERROR("getInstanceNames() returned NULL");
-		}
 	}
-	// on error, cleanup but don't handle
 	catch (Exception &)
 	{
-		if (pPaths)
+		delete pPaths;
+		throw;
+	}
+
+	delete pPaths;
+	return true;
+}
+
+void wbem::framework::InstanceFactory::streamInstances(const std::string &className,
+		attribute_names_t &attributes, InstanceSink &sink)
+{
+	LogEnterExit logging(__FILE__, __FUNCTION__, __LINE__);
+
+	bool streamed = false;
+	if (streamsInstances())
+	{
+		try
 		{
-			delete pPaths;
+			streamed = streamInstancesByName(attributes, sink);
 		}
-		if (pInstList)
+		// only thrown before any instance reached the sink, enumerate the list instead
+		catch (ExceptionNotSupported &)
 		{
-			delete pInstList;
+			COMMON_LOG_DEBUG("Factory can't stream its instances by name, enumerating instead");
 		}
+	}
 
-		// Re-throw the original (dynamic-type) exception.  We do this so that
-		// we prevent the "slicing" of data from the original exception, which
-		// would occur when throwing the caught base (static-type) exception.
-		// This is also more efficient because we carry the existing exception forward
-		// instead of telling throw to create a new copy from the caught (static-type)
-		// base exception.
-		throw;
+	if (!streamed)
+	{
+		instances_t *pInstances = getInstancesShared(className, attributes);
+		if (pInstances)
+		{
+			bool wanted = true;
+			for (instances_t::iterator iInstance = pInstances->begin();
+					iInstance != pInstances->end() && wanted; iInstance++)
+			{
+				wanted = sink.addInstance(*iInstance);
+			}
+			delete pInstances;
+		}
 	}
+}
 
-	// clean up
-	if (pPaths)
+/*
+ * In-flight enumerations, shared between threads asking for the same thing
+ */
+namespace
+{
+	wbem::framework::SingleFlight<wbem::framework::instances_t> g_instancesFlight;
+	wbem::framework::SingleFlight<wbem::framework::instance_names_t> g_instanceNamesFlight;
+}
+
+/*
+ * Build the key identifying an enumeration: the factory class, CIM class, namespace and the
+ * attribute list (order and case don't matter).
+ */
+static std::string getSharedRequestKey(const wbem::framework::InstanceFactory &factory,
+		const std::string &className, const std::string &cimNamespace,
+		const wbem::framework::attribute_names_t &attributes)
+{
+	wbem::framework::attribute_names_t projection(attributes);
+	for (size_t i = 0; i < projection.size(); i++)
 	{
-		pPaths->clear();
-		delete pPaths;
+		std::transform(projection[i].begin(), projection[i].end(),
+				projection[i].begin(), tolower);
 	}
+	std::sort(projection.begin(), projection.end());
 
-	return pInstList;
+	std::string key = typeid(factory).name();
+	key += '\n';
+	key += className;
+	key += '\n';
+	key += cimNamespace;
+	key += '\n';
+	for (size_t i = 0; i < projection.size(); i++)
+	{
+		key += projection[i];
+		key += ',';
+	}
+	return key;
+}
+
+wbem::framework::instances_t* wbem::framework::InstanceFactory::getInstancesShared(
+		const std::string &className, attribute_names_t &attributes)
+{
+	LogEnterExit logging(__FILE__, __FUNCTION__, __LINE__);
+
+	instances_t *pInstances = NULL;
+	if (sharesRequests())
+	{
+		std::string key = getSharedRequestKey(*this, className, m_cimNamespace, attributes);
+		pInstances = g_instancesFlight.run(key, [this, &attributes]()
+		{
+			return getInstances(attributes);
+		});
+	}
+	else
+	{
+		pInstances = getInstances(attributes);
+	}
+	return pInstances;
+}
+
+wbem::framework::instance_names_t* wbem::framework::InstanceFactory::getInstanceNamesShared(
+		const std::string &className)
+{
+	LogEnterExit logging(__FILE__, __FUNCTION__, __LINE__);
+
+	instance_names_t *pNames = NULL;
+	if (sharesRequests())
+	{
+		std::string key = getSharedRequestKey(*this, className, m_cimNamespace,
+				attribute_names_t());
+		pNames = g_instanceNamesFlight.run(key, [this]()
+		{
+			return getInstanceNames();
+		});
+	}
+	else
+	{
+		pNames = getInstanceNames();
+	}
+	return pNames;
+}
+
+void wbem::framework::InstanceFactory::warmUp(const std::string &className)
+{
+	LogEnterExit logging(__FILE__, __FUNCTION__, __LINE__);
+
+	if (cachesSupportedAttributes())
+	{
+		getSupportedAttributes();
+		COMMON_LOG_DEBUG_F("Warmed up the supported attributes of %s", className.c_str());
+	}
+}
+
+wbem::framework::SingleFlightCounters wbem::framework::InstanceFactory::getSharedInstancesCounters()
+{
+	return g_instancesFlight.getCounters();
+}
+
+wbem::framework::SingleFlightCounters wbem::framework::InstanceFactory::getSharedInstanceNamesCounters()
+{
+	return g_instanceNamesFlight.getCounters();
 }
 
 wbem::framework::UINT32 wbem::framework::InstanceFactory::executeMethod(
@@ -226,6 +464,7 @@ wbem::framework::instance_names_t* wbem::framework::InstanceFactory::associatorN
 	{
 		pNames->push_back(iInstance->getObjectPath());
 	}
+	delete pInstances;
 
 	return pNames;
 }
@@ -249,6 +488,17 @@ wbem::framework::instances_t* wbem::framework::InstanceFactory::associatorInstan
 	COMMON_LOG_DEBUG_F("roleName: %s", roleName.c_str());
 	COMMON_LOG_DEBUG_F("resultRoleName: %s", resultRoleName.c_str());
 
+	bool indexed = useAssociationIndex();
+	AssociationIndex &index = AssociationIndex::getSingleton();
+	UINT64 generation = index.getGeneration();
+	AssociationIndexEntry indexEntry;
+	if (indexed && index.find(ASSOCIATIONINDEXKIND_ASSOCIATORS, objectPath,
+			associationClassName, resultClassName, roleName, resultRoleName, indexEntry))
+	{
+		COMMON_LOG_DEBUG("Associators found in the association index");
+		return new instances_t(indexEntry.instances);
+	}
+
 	instances_t* pInstances = new instances_t();
 
 	attribute_names_t attributes;
@@ -261,43 +511,14 @@ wbem::framework::instances_t* wbem::framework::InstanceFactory::associatorInstan
 	{
 		COMMON_LOG_DEBUG("Inspecting association factory...");
 		InstanceFactory *pAssociationFactory = associationFactories.back();
-		if (pAssociationFactory)
+		// once the request has to stop, just clean up the remaining factories
+		if (pAssociationFactory && RequestContext::stopRequested())
 		{
-			instance_names_t *pAssociationNames = pAssociationFactory->getInstanceNames();
-			COMMON_LOG_DEBUG_F("Got %u association names", pAssociationNames->size());
-
-			instance_names_t::iterator iter = pAssociationNames->begin();
-			for(; iter != pAssociationNames->end(); iter++)
-			{
-				attributes_t keys = iter->getKeys();
-				attributes_t::iterator iKey = keys.begin();
-				for(; iKey != keys.end(); iKey++)
-				{
-					ObjectPathBuilder builder(iKey->second.asStr());
-					ObjectPath associatedObjectPath;
-					builder.Build(&associatedObjectPath);
-					// don't list the instance as one of its own associators
-					if (associatedObjectPath.asString(true) != objectPath.asString(true))
-					{
-						COMMON_LOG_DEBUG_F("Adding associator: %s",
-								associatedObjectPath.asString(true).c_str());
-						InstanceFactory *pAssociatedFactory =
-								ProviderFactory::getInstanceFactoryStatic(associatedObjectPath.getClass());
-						if (pAssociatedFactory != NULL)
-						{
-							attribute_names_t attributes;
-							wbem::framework::Instance *pAssociatedInstance = pAssociatedFactory->getInstance(
-									associatedObjectPath, attributes);
-							pInstances->push_back(*pAssociatedInstance);
-
-							delete pAssociatedInstance;
-							delete pAssociatedFactory;
-						}
-					}
-				}
-			}
-
-			delete pAssociationNames;
+			delete pAssociationFactory;
+		}
+		else if (pAssociationFactory)
+		{
+			pAssociationFactory->getAssociatedInstances(objectPath, *pInstances);
 			delete pAssociationFactory;
 		}
 
@@ -309,15 +530,79 @@ wbem::framework::instances_t* wbem::framework::InstanceFactory::associatorInstan
 		delete (pInstance);
 	}
 
+	if (indexed && !requestTruncated())
+	{
+		indexEntry.instances = *pInstances;
+		index.add(ASSOCIATIONINDEXKIND_ASSOCIATORS, objectPath,
+				associationClassName, resultClassName, roleName, resultRoleName,
+				indexEntry, generation);
+	}
+
 	return pInstances;
 }
 
 /*
- * Reference names are the object paths of association classes with an antecedent
- * or dependent equal to the object path being requested of.
+ * Find the instances on the other end of each association name
  */
-wbem::framework::instance_names_t *wbem::framework::InstanceFactory::referenceNames(
+void wbem::framework::InstanceFactory::getAssociatedInstances(ObjectPath &objectPath,
+		instances_t &associatedInstances)
+{
+	LogEnterExit logging(__FILE__, __FUNCTION__, __LINE__);
+	instance_names_t *pAssociationNames = getInstanceNames();
+	COMMON_LOG_DEBUG_F("Got %u association names", pAssociationNames->size());
+
+	instance_names_t::iterator iter = pAssociationNames->begin();
+	for(; iter != pAssociationNames->end() && !RequestContext::stopRequested(); iter++)
+	{
+		attributes_t keys = iter->getKeys();
+		attributes_t::iterator iKey = keys.begin();
+		for(; iKey != keys.end(); iKey++)
+		{
+			ObjectPath associatedObjectPath;
+			if (iKey->second.getType() == REFERENCE_T)
+			{
+				associatedObjectPath = iKey->second.referenceValue();
+			}
+			else
+			{
+				ObjectPathBuilder builder(iKey->second.asStr());
+				builder.Build(&associatedObjectPath);
+			}
+			// don't list the instance as one of its own associators
+			if (associatedObjectPath.asString(true) != objectPath.asString(true))
+			{
+				COMMON_LOG_DEBUG_F("Adding associator: %s",
+						associatedObjectPath.asString(true).c_str());
+				InstanceFactory *pAssociatedFactory =
+						ProviderFactory::getInstanceFactoryStatic(associatedObjectPath.getClass());
+				if (pAssociatedFactory != NULL)
+				{
+					attribute_names_t attributes;
+					wbem::framework::Instance *pAssociatedInstance = pAssociatedFactory->getInstance(
+							associatedObjectPath, attributes);
+					associatedInstances.push_back(*pAssociatedInstance);
+
+					delete pAssociatedInstance;
+					delete pAssociatedFactory;
+				}
+			}
+		}
+	}
+
+	delete pAssociationNames;
+}
+
+/*
+ * References are the association objects with an antecedent or dependent equal to the
+ * object path being requested of. Each association factory is read once and its batch is
+ * handed to the sink and freed before the next factory runs, so only the set of paths
+ * already passed on is held for the whole request. That set keeps an association object
+ * reported by more than one factory from reaching the sink twice.
+ */
+void wbem::framework::InstanceFactory::streamReferences(
 		ObjectPath &objectPath,
+		ReferenceSink &sink,
+		const bool withInstances,
 		const std::string &associationClassName,
 		const std::string &resultClassName,
 		const std::string &roleName,
@@ -330,32 +615,147 @@ wbem::framework::instance_names_t *wbem::framework::InstanceFactory::referenceNa
 	COMMON_LOG_DEBUG_F("roleName: %s", roleName.c_str());
 	COMMON_LOG_DEBUG_F("resultRoleName: %s", resultRoleName.c_str());
 
-	wbem::framework::instance_names_t *pInstanceNames = NULL;
+	bool indexed = useAssociationIndex();
+	enum associationIndexKind indexKind = withInstances ?
+			ASSOCIATIONINDEXKIND_REFERENCES : ASSOCIATIONINDEXKIND_REFERENCENAMES;
+	AssociationIndex &index = AssociationIndex::getSingleton();
+	UINT64 generation = index.getGeneration();
+	AssociationIndexEntry indexEntry;
+	if (indexed && index.find(indexKind, objectPath,
+			associationClassName, resultClassName, roleName, resultRoleName, indexEntry))
+	{
+		COMMON_LOG_DEBUG("References found in the association index");
+		for (size_t i = 0; i < indexEntry.paths.size(); i++)
+		{
+			sink.addReference(indexEntry.paths[i], withInstances ? &indexEntry.instances[i] : NULL);
+		}
+		return;
+	}
+	IndexingReferenceSink indexingSink(sink, indexEntry);
+	ReferenceSink *pSink = indexed ? &indexingSink : &sink;
 
 	attribute_names_t attributes;
-	std::vector<InstanceFactory *> associationFactories = ProviderFactory::getAssociationFactoriesStatic(
-			getInstance(objectPath, attributes),
-			associationClassName, resultClassName, roleName, resultRoleName);
-	while (!associationFactories.empty())
+	Instance *pInstance = getInstance(objectPath, attributes);
+	std::vector<InstanceFactory *> associationFactories;
+	try
 	{
-		InstanceFactory * pAssociationFactory = associationFactories.back();
-		if (pAssociationFactory)
+		associationFactories = ProviderFactory::getAssociationFactoriesStatic(
+				pInstance, associationClassName, resultClassName, roleName, resultRoleName);
+	}
+	catch (Exception &)
+	{
+		delete pInstance;
+		throw;
+	}
+	COMMON_LOG_DEBUG_F("Got %u association factories", associationFactories.size());
+
+	// only another factory can report the same object again, so with a single factory
+	// nothing needs to be remembered
+	size_t factoryCount = 0;
+	for (size_t i = 0; i < associationFactories.size(); i++)
+	{
+		factoryCount += associationFactories[i] != NULL ? 1 : 0;
+	}
+	bool deduplicate = factoryCount > 1;
+	std::unordered_set<ObjectPath, ObjectPathHash, ObjectPathEqual> referencesFound;
+	try
+	{
+		for (size_t i = 0; i < associationFactories.size() && !RequestContext::stopRequested(); i++)
 		{
-			pInstanceNames = pAssociationFactory->getInstanceNames();
+			InstanceFactory *pAssociationFactory = associationFactories[i];
+			if (!pAssociationFactory)
+			{
+				continue;
+			}
+
+			if (withInstances)
+			{
+				attribute_names_t associationAttributes;
+				instances_t *pAssociations = pAssociationFactory->getInstances(associationAttributes);
+				if (pAssociations)
+				{
+					for (instances_t::const_iterator iAssociation = pAssociations->begin();
+							iAssociation != pAssociations->end(); iAssociation++)
+					{
+						ObjectPath path = iAssociation->getObjectPath();
+						if (!deduplicate || referencesFound.insert(path).second)
+						{
+							pSink->addReference(path, &(*iAssociation));
+						}
+					}
+					delete pAssociations;
+				}
+			}
+			else
+			{
+				instance_names_t *pAssociationNames = pAssociationFactory->getInstanceNames();
+				if (pAssociationNames)
+				{
+					for (instance_names_t::const_iterator iName = pAssociationNames->begin();
+							iName != pAssociationNames->end(); iName++)
+					{
+						if (!deduplicate || referencesFound.insert(*iName).second)
+						{
+							pSink->addReference(*iName, NULL);
+						}
+					}
+					delete pAssociationNames;
+				}
+			}
 
 			delete pAssociationFactory;
+			associationFactories[i] = NULL;
 		}
+	}
+	catch (Exception &)
+	{
+		for (size_t i = 0; i < associationFactories.size(); i++)
+		{
+			delete associationFactories[i];
+		}
+		delete pInstance;
+		throw;
+	}
 
-		associationFactories.pop_back();
+	// factories left over after a stop request
+	for (size_t i = 0; i < associationFactories.size(); i++)
+	{
+		delete associationFactories[i];
+	}
+	delete pInstance;
+	if (indexed && !requestTruncated())
+	{
+		index.add(indexKind, objectPath,
+				associationClassName, resultClassName, roleName, resultRoleName,
+				indexEntry, generation);
+	}
+}
+
+wbem::framework::instance_names_t *wbem::framework::InstanceFactory::referenceNames(
+		ObjectPath &objectPath,
+		const std::string &associationClassName,
+		const std::string &resultClassName,
+		const std::string &roleName,
+		const std::string &resultRoleName)
+{
+	LogEnterExit logging(__FILE__, __FUNCTION__, __LINE__);
+
+	instance_names_t *pInstanceNames = new instance_names_t();
+	try
+	{
+		ReferenceNameCollector collector(*pInstanceNames);
+		streamReferences(objectPath, collector, false,
+				associationClassName, resultClassName, roleName, resultRoleName);
+	}
+	catch (Exception &)
+	{
+		delete pInstanceNames;
+		throw;
 	}
 
 	return pInstanceNames;
 }
 
-/*
- * Reference instances are the instances of association classes with an antecedent
- * or dependent equal to the object path being requested of.
- */
 wbem::framework::instances_t *wbem::framework::InstanceFactory::referenceInstances(
 		ObjectPath &objectPath,
 		const std::string &associationClassName,
@@ -363,31 +763,177 @@ wbem::framework::instances_t *wbem::framework::InstanceFactory::referenceInstanc
 		const std::string &roleName,
 		const std::string &resultRoleName)
 {
-	COMMON_LOG_DEBUG_F("Object Path ClassName: %s", objectPath.getClass().c_str());
-	COMMON_LOG_DEBUG_F("associationClassName: %s", associationClassName.c_str());
-	COMMON_LOG_DEBUG_F("resultClassName: %s", resultClassName.c_str());
-	COMMON_LOG_DEBUG_F("roleName: %s", roleName.c_str());
-	COMMON_LOG_DEBUG_F("resultRoleName: %s", resultRoleName.c_str());
+	LogEnterExit logging(__FILE__, __FUNCTION__, __LINE__);
 
-	wbem::framework::instances_t *pInstances = NULL;
+	instances_t *pInstances = new instances_t();
+	try
+	{
+		ReferenceInstanceCollector collector(*pInstances);
+		streamReferences(objectPath, collector, true,
+				associationClassName, resultClassName, roleName, resultRoleName);
+	}
+	catch (Exception &)
+	{
+		delete pInstances;
+		throw;
+	}
 
-	attribute_names_t attributesOne;
-	std::vector<InstanceFactory *> associationFactories = ProviderFactory::getAssociationFactoriesStatic(
-			getInstance(objectPath, attributesOne),
-			associationClassName, resultClassName, roleName, resultRoleName);
-	while (!associationFactories.empty())
+	return pInstances;
+}
+
+/*
+ * Fetch only the attributes the query needs, then filter and project in the provider so
+ * the client doesn't have to enumerate everything.
+ */
+wbem::framework::instances_t *wbem::framework::InstanceFactory::execQuery(const WqlPlan &plan)
+{
+	LogEnterExit logging(__FILE__, __FUNCTION__, __LINE__);
+	const WqlQuery &query = plan.getQuery();
+	const WqlEvaluator &evaluator = plan.getEvaluator();
+	COMMON_LOG_DEBUG_F("Query: %s", query.getQueryString().c_str());
+
+	attribute_names_t attributes = evaluator.getFetchAttributes();
+	instances_t *pInstances = NULL;
+	if (evaluator.isCountOnly())
+	{
+		pInstances = getInstancesFromNames(query.getClassName());
+	}
+	else if (query.getConditional())
+	{
+		pInstances = getInstancesWhere(*query.getConditional(), attributes);
+	}
+	if (!pInstances)
+	{
+		pInstances = getInstancesShared(query.getClassName(), attributes);
+	}
+	if (!pInstances)
+	{
+		COMMON_LOG_ERROR("Unknown error. pInstances was NULL");
+		throw Exception("Factory returned NULL for getInstances");
+	}
+
+	instances_t *pResults = new instances_t();
+	evaluator.evaluate(*pInstances, *pResults);
+	delete pInstances;
+
+	return pResults;
+}
+
+/*
+ * Instances holding only their keys, for a query that only counts them. Returns NULL if
+ * the factory can't list its instance names.
+ */
+wbem::framework::instances_t *wbem::framework::InstanceFactory::getInstancesFromNames(
+		const std::string &className)
+{
+	LogEnterExit logging(__FILE__, __FUNCTION__, __LINE__);
+
+	instances_t *pInstances = NULL;
+	try
 	{
-		InstanceFactory * pAssociationFactory = associationFactories.back();
-		if (pAssociationFactory)
+		instance_names_t *pPaths = getInstanceNamesShared(className);
+		if (pPaths)
 		{
-			attribute_names_t attributesTwo;
-			pInstances = pAssociationFactory->getInstances(attributesTwo);
+			pInstances = new instances_t();
+			for (instance_names_t::iterator iPath = pPaths->begin();
+					iPath != pPaths->end(); iPath++)
+			{
+				pInstances->push_back(Instance(*iPath));
+			}
+			delete pPaths;
+		}
+	}
+	catch (ExceptionNotSupported &)
+	{
+		COMMON_LOG_DEBUG("Factory doesn't support getInstanceNames, enumerating instead");
+	}
+	return pInstances;
+}
 
-			delete pAssociationFactory;
+wbem::framework::instances_t *wbem::framework::InstanceFactory::getInstancesWhere(
+		const WqlConditional &conditional, attribute_names_t &attributes)
+{
+	LogEnterExit logging(__FILE__, __FUNCTION__, __LINE__);
+
+	// only an equality on a key narrows the instances enough to pay for the names,
+	// and only if every comparison must hold
+	WqlPredicate predicate(&conditional);
+	if (!predicate.isConjunction() || !predicate.hasEquality())
+	{
+		return NULL;
+	}
+	AttributeNameSet keyNames;
+	if (getKnownKeyNames(keyNames) && !predicate.hasEqualityOn(keyNames))
+	{
+		COMMON_LOG_DEBUG("No equality on a key in the query, enumerating instead");
+		return NULL;
+	}
+
+	instance_names_t *pPaths = NULL;
+	try
+	{
+		pPaths = getInstanceNames();
+	}
+	catch (ExceptionNotSupported &)
+	{
+		COMMON_LOG_DEBUG("Factory doesn't support getInstanceNames, enumerating instead");
+	}
+	if (!pPaths)
+	{
+		return NULL;
+	}
+	rememberKeyNames(*pPaths);
+
+	instance_names_t matches;
+	for (instance_names_t::const_iterator iPath = pPaths->begin();
+			iPath != pPaths->end(); iPath++)
+	{
+		if (predicate.matchesKeys(*iPath))
+		{
+			matches.push_back(*iPath);
 		}
+	}
 
-		associationFactories.pop_back();
+	bool pruned = matches.size() < pPaths->size();
+	COMMON_LOG_DEBUG_F("%d of %d instance names match the keys in the query",
+			(int)matches.size(), (int)pPaths->size());
+	delete pPaths;
+	if (!pruned)
+	{
+		return NULL;
 	}
+
+	checkAttributes(attributes);
+	instances_t *pInstances = new instances_t();
+	for (instance_names_t::iterator iPath = matches.begin();
+			iPath != matches.end() && !RequestContext::stopRequested(); iPath++)
+	{
+		Instance *pInstance = NULL;
+		try
+		{
+			pInstance = getInstance(*iPath, attributes);
+			if (pInstance)
+			{
+				pInstances->push_back(*pInstance);
+				delete pInstance;
+			}
+		}
+		catch (Exception &e)
+		{
+			if (pInstance)
+			{
+				delete pInstance;
+			}
+			// as in getInstances, a lone instance reports its error
+			if (matches.size() == 1)
+			{
+				delete pInstances;
+				throw;
+			}
+			COMMON_LOG_WARN_F("Error adding instance: %s", e.what());
+		}
+	}
+
 	return pInstances;
 }
 
@@ -395,16 +941,10 @@ bool wbem::framework::InstanceFactory::containsAttribute(
 	const std::string &key, const attribute_names_t &attributes)
 {
 	// Compare case-insensitive values
-	std::string keyLower = key;
-	std::transform(keyLower.begin(), keyLower.end(), keyLower.begin(), tolower);
-
-	// look at each attribute
+	AttributeNameEqual equal;
 	for (attribute_names_t::const_iterator iter=attributes.begin(); iter!=attributes.end(); ++iter)
 	{
-		// Convert attribute to lowercase
-		std::string attrLower = *iter;
-		std::transform(attrLower.begin(), attrLower.end(), attrLower.begin(), tolower);
-		if (keyLower == attrLower) // found the key
+		if (equal(key, *iter)) // found the key
 		{
 			return true;
 		}
@@ -412,6 +952,98 @@ bool wbem::framework::InstanceFactory::containsAttribute(
 	return false;
 }
 
+bool wbem::framework::InstanceFactory::containsAttribute(
+	const std::string &key, const AttributeNameSet &attributes)
+{
+	return attributes.contains(key);
+}
+
+std::string wbem::framework::InstanceFactory::getFactoryClassKey()
+{
+	std::string factoryClass = typeid(*this).name();
+	factoryClass += '\n';
+	factoryClass += getSupportedAttributesVariant();
+	return factoryClass;
+}
+
+/*
+ * Supported attribute sets, built once per concrete factory class
+ */
+namespace
+{
+	std::mutex g_supportedAttributesLock;
+	std::unordered_map<std::string, wbem::framework::AttributeNameSet> g_supportedAttributes;
+}
+
+const wbem::framework::AttributeNameSet &wbem::framework::InstanceFactory::getSupportedAttributes()
+{
+	std::string factoryClass = getFactoryClassKey();
+
+	{
+		std::lock_guard<std::mutex> lock(g_supportedAttributesLock);
+		std::unordered_map<std::string, AttributeNameSet>::const_iterator iter =
+				g_supportedAttributes.find(factoryClass);
+		if (iter != g_supportedAttributes.end())
+		{
+			return iter->second;
+		}
+	}
+
+	// populate outside of the lock, the subclass may do real work here
+	attribute_names_t supportedAttributes;
+	populateAttributeList(supportedAttributes);
+
+	std::lock_guard<std::mutex> lock(g_supportedAttributesLock);
+	// if another thread got here first, its set is kept. Map references stay valid on insert.
+	return g_supportedAttributes.insert(
+			std::make_pair(factoryClass, AttributeNameSet(supportedAttributes))).first->second;
+}
+
+/*
+ * Key names by factory class, learned from the paths the factories return
+ */
+namespace
+{
+	std::mutex g_keyNamesLock;
+	std::unordered_map<std::string, wbem::framework::AttributeNameSet> g_keyNames;
+}
+
+bool wbem::framework::InstanceFactory::getKnownKeyNames(AttributeNameSet &keyNames)
+{
+	std::string factoryClass = getFactoryClassKey();
+
+	std::lock_guard<std::mutex> lock(g_keyNamesLock);
+	std::unordered_map<std::string, AttributeNameSet>::const_iterator iter =
+			g_keyNames.find(factoryClass);
+	bool known = iter != g_keyNames.end();
+	if (known)
+	{
+		keyNames = iter->second;
+	}
+	return known;
+}
+
+void wbem::framework::InstanceFactory::rememberKeyNames(const instance_names_t &paths)
+{
+	if (!paths.empty())
+	{
+		std::string factoryClass = getFactoryClassKey();
+
+		AttributeNameSet keyNames;
+		const attributes_t &keys = paths.front().getKeys();
+		for (attributes_t::const_iterator iKey = keys.begin(); iKey != keys.end(); iKey++)
+		{
+			if (iKey->second.isKey())
+			{
+				keyNames.insert(iKey->first);
+			}
+		}
+
+		std::lock_guard<std::mutex> lock(g_keyNamesLock);
+		g_keyNames.insert(std::make_pair(factoryClass, keyNames));
+	}
+}
+
 /*
  * Verify the attributes list
  * @param attributes
@@ -420,17 +1052,25 @@ bool wbem::framework::InstanceFactory::containsAttribute(
  */
 void wbem::framework::InstanceFactory::checkAttributes(attribute_names_t &attributes)
 {
-	attribute_names_t supportedAttributes;
-	populateAttributeList(supportedAttributes);
+	AttributeNameSet populatedAttributes;
+	if (!cachesSupportedAttributes())
+	{
+		attribute_names_t names;
+		populateAttributeList(names);
+		populatedAttributes = AttributeNameSet(names);
+	}
+	const AttributeNameSet &supportedAttributes =
+			cachesSupportedAttributes() ? getSupportedAttributes() : populatedAttributes;
 	if (attributes.empty())
 	{
-		attributes = supportedAttributes;
+		attributes = supportedAttributes.getNames();
 	}
 	else
 	{
-		for (attribute_names_t::const_iterator iter = attributes.begin(); iter != attributes.end(); iter++)
+		for (attribute_names_t::iterator iter = attributes.begin(); iter != attributes.end(); iter++)
 		{
-			if (!containsAttribute((*iter), supportedAttributes))
+			// CIM names are case-insensitive, hand back the name in the case the class uses
+			if (!supportedAttributes.getCanonicalName(*iter, *iter))
 			{
 				throw ExceptionBadAttribute((*iter).c_str());
 			}
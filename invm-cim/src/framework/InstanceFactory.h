@@ -32,14 +32,22 @@
 #ifndef	_WBEM_FRAMEWORK_INSTANCE_FACTORY_H_
 #define	_WBEM_FRAMEWORK_INSTANCE_FACTORY_H_
 
+#include "AttributeNameSet.h"
 #include "Exception.h"
 #include "Instance.h"
+#include "InstanceSink.h"
 #include "ObjectPath.h"
+#include "ReferenceSink.h"
+#include "SingleFlight.h"
 
 namespace wbem
 {
 namespace framework
 {
+
+class WqlConditional;
+class WqlPlan;
+
 /*
  * WBEM has two return values for operations/methods.  Per-method return
  * values are defined in MOFs and HTTP return values are defined in the
@@ -207,6 +215,42 @@ class INVM_CIM_API InstanceFactory
 				const std::string &roleName = "",
 				const std::string &resultRoleName = "");
 
+		/*!
+		 * Called on an association factory to get the instances associated with the
+		 * instance at objectPath.
+		 * @param[in] objectPath
+		 * 		The instance the association factory was created for.
+		 * @param[out] associatedInstances
+		 * 		The associated instances are added to this list.
+		 * @remarks The default implementation resolves every reference in
+		 * getInstanceNames() through the referenced class's factory.
+		 */
+		virtual void getAssociatedInstances(ObjectPath &objectPath,
+				instances_t &associatedInstances);
+
+		/*!
+		 * Find the association objects that refer to the specified instance in every
+		 * association factory that applies, passing each one to sink as it is found.
+		 * An association object reported by more than one factory is passed once.
+		 * @param[in] objectPath
+		 * 		The instance the references are for.
+		 * @param[in] sink
+		 * 		Receives each association object.
+		 * @param[in] withInstances
+		 * 		If true the sink is given each association instance, otherwise only its path.
+		 * @remarks Each factory's association objects are freed before the next factory
+		 * runs. When more than one factory applies, the path of every object passed on is
+		 * kept until the call returns so one reported twice is dropped, so that memory
+		 * grows with the number of references.
+		 */
+		virtual void streamReferences(ObjectPath &objectPath,
+				ReferenceSink &sink,
+				const bool withInstances,
+				const std::string &associationClassName = "",
+				const std::string &resultClassName = "",
+				const std::string &roleName = "",
+				const std::string &resultRoleName = "");
+
 		/*!
 		 * Standard CIM method to retrieve a list of the names of association objects
 		 * that refer to the specified instance.
@@ -229,6 +273,48 @@ class INVM_CIM_API InstanceFactory
 				const std::string &roleName = "",
 				const std::string &resultRoleName = "");
 
+		/*!
+		 * Standard CIM method to retrieve the instances that satisfy a WQL query, with
+		 * only the selected attributes.
+		 * @param[in] plan
+		 * 		The compiled query, usually shared through the WqlPlanCache. Its class is
+		 * 		the class this factory is for.
+		 * @remarks The default implementation enumerates the class with the attributes the
+		 * query needs and evaluates the query over the result.
+		 * @return
+		 * 		The list of instances. The caller must delete it.
+		 */
+		virtual instances_t *execQuery(const WqlPlan &plan);
+
+		/*!
+		 * Retrieve the instances that may satisfy a WQL conditional, pruning at the source
+		 * instead of building every instance.
+		 * @param[in] conditional
+		 * 		The WHERE clause of the query.
+		 * @param[in] attributes
+		 * 		The list of attribute names to retrieve for each instance.
+		 * @remarks Override this to push the conditional into the backend. The list
+		 * returned may hold instances that don't match; execQuery still evaluates the
+		 * conditional over it. The default implementation handles equality on key
+		 * properties in conditionals connected by AND: it gets the instance names, drops those whose keys can't match and
+		 * retrieves the rest with getInstance.
+		 * @return
+		 * 		The list of instances, which the caller must delete, or NULL if the factory
+		 * 		can't prune and the whole class should be enumerated.
+		 */
+		virtual instances_t *getInstancesWhere(const WqlConditional &conditional,
+				attribute_names_t &attributes);
+
+		/*!
+		 * Retrieve instances holding only their keys, built from the instance names.
+		 * @param[in] className
+		 * 		The CIM class being enumerated.
+		 * @return
+		 * 		The list of instances, which the caller must delete, or NULL if the factory
+		 * 		doesn't support getInstanceNames.
+		 */
+		instances_t *getInstancesFromNames(const std::string &className);
+
 		// default implementation exists but requires that getInstance and getInstanceNames
 		// and populateAttributeList are implemented
 		/*!
@@ -242,6 +328,86 @@ class INVM_CIM_API InstanceFactory
 		 */
 		virtual instances_t* getInstances(attribute_names_t &attributes);
 
+		/*!
+		 * Retrieve a list of instances in this factory, sharing the work with any identical
+		 * call (same class, namespace and attribute list) already in progress on another thread
+		 * if the factory shares requests (see sharesRequests).
+		 * @param[in] className
+		 * 		The CIM class being enumerated.
+		 * @param[in] attributes
+		 * 		The list of attribute names to retrieve for each instance.
+		 * @return
+		 * 		The list of instances. The caller must delete it.
+		 */
+		instances_t* getInstancesShared(const std::string &className, attribute_names_t &attributes);
+
+		/*!
+		 * Find the instances in this factory, passing each one to sink as it is found.
+		 * @param[in] className
+		 * 		The CIM class being enumerated.
+		 * @param[in] attributes
+		 * 		The list of attribute names to retrieve for each instance.
+		 * @param[in] sink
+		 * 		Receives each instance. Once it returns false no more are looked for.
+		 * @remarks If streamsInstances is true, the default implementation streams through
+		 * getInstanceNames and getInstance (see streamInstancesByName), falling back to the
+		 * list if they aren't supported. Otherwise it gets the list from getInstancesShared,
+		 * so nothing reaches the sink until every instance is found.
+		 */
+		virtual void streamInstances(const std::string &className,
+				attribute_names_t &attributes, InstanceSink &sink);
+
+		/*!
+		 * Returns true if streamInstances passes each instance on as it is found, so the
+		 * caller can work on it while the rest are found.
+		 * @remarks The default is false, so getInstances (and any override of it) is used.
+		 * Return true from a factory whose instances are better found one at a time by
+		 * getInstanceNames and getInstance, or that overrides streamInstances.
+		 */
+		virtual bool streamsInstances() { return false; }
+
+		/*!
+		 * Retrieve a list of object paths for the instances in this factory, sharing the work
+		 * with any identical call already in progress on another thread if the factory shares
+		 * requests (see sharesRequests).
+		 * @param[in] className
+		 * 		The CIM class being enumerated.
+		 * @return
+		 * 		The list of object paths. The caller must delete it.
+		 */
+		instance_names_t* getInstanceNamesShared(const std::string &className);
+
+		/*!
+		 * Returns true if any two factories of this class return the same instances for the
+		 * same class, namespace and attribute list, so concurrent enumerations can share one
+		 * call to getInstances or getInstanceNames.
+		 * @remarks The default is false. Factories whose results depend on how they were
+		 * constructed, e.g. an AssociationFactory, must not return true.
+		 */
+		virtual bool sharesRequests() { return false; }
+
+		/*!
+		 * Prepare the factory to serve requests for a class, e.g. when the provider is loaded.
+		 * @param[in] className
+		 * 		The CIM class to warm up.
+		 * @remarks The default implementation builds the supported attribute set if the
+		 * factory caches it (see cachesSupportedAttributes), which requests for the class read. Instances are not cached by the framework, so a
+		 * factory whose library keeps its own caches should override this to fill them.
+		 */
+		virtual void warmUp(const std::string &className);
+
+		/*!
+		 * Counters for getInstancesShared on factories that share requests, including how
+		 * many calls were collapsed.
+		 */
+		static SingleFlightCounters getSharedInstancesCounters();
+
+		/*!
+		 * Counters for getInstanceNamesShared on factories that share requests, including how
+		 * many calls were collapsed.
+		 */
+		static SingleFlightCounters getSharedInstanceNamesCounters();
+
 
 		// convenience method
 		/*!
@@ -256,6 +422,18 @@ class INVM_CIM_API InstanceFactory
 		 */
 		static bool containsAttribute(const std::string &key, const attribute_names_t &attributes);
 
+		/*!
+		 * Helper method to determine if the attribute name is in the specified set of attribute names.
+		 * @param[in] key
+		 * 		The attribute name to look for.
+		 * @param[in] attributes
+		 * 		The set of attribute names to search
+		 * @return
+		 * 		true if the attribute name was found in the set.
+		 * 		false if the attribute name was not found in the set.
+		 */
+		static bool containsAttribute(const std::string &key, const AttributeNameSet &attributes);
+
 		/*!
 		 * Determines if the two instances should be associated by the Association Class. Usually only
 		 * used if the association is more complex than simple FK relationships
@@ -288,6 +466,66 @@ class INVM_CIM_API InstanceFactory
 		 */
 		void checkAttributes(attribute_names_t &attributes);
 
+		/*!
+		 * Pass each instance to sink as it is found, using getInstanceNames and getInstance.
+		 * This is how the default getInstances finds its instances. An instance that can't
+		 * be retrieved is skipped, unless it is the only one.
+		 * @param[in] attributes
+		 * 		The list of attribute names to retrieve for each instance.
+		 * @param[in] sink
+		 * 		Receives each instance.
+		 * @return
+		 * 		false if getInstanceNames returned NULL.
+		 */
+		bool streamInstancesByName(attribute_names_t &attributes, InstanceSink &sink);
+
+		/*!
+		 * Retrieve the set of attributes supported by this factory's class.
+		 * @remarks The set is built from populateAttributeList the first time it is
+		 * requested for a class and shared by every factory of that class afterwards.
+		 * Only used for factories that cache their supported attributes.
+		 * @return
+		 * 		The supported attribute names.
+		 */
+		const AttributeNameSet &getSupportedAttributes();
+
+		/*!
+		 * Returns true if every factory of this class with the same
+		 * getSupportedAttributesVariant populates the same attribute list, so it only needs
+		 * to be populated once.
+		 * @remarks The default is false, so populateAttributeList is called on every request.
+		 */
+		virtual bool cachesSupportedAttributes() { return false; }
+
+		/*!
+		 * Distinguish factories of the same class that populate different attribute lists.
+		 * @return
+		 * 		A string that is the same for every factory with the same attribute list.
+		 * 		The default is an empty string.
+		 */
+		virtual std::string getSupportedAttributesVariant() { return ""; }
+
+		/*!
+		 * Identify the factory class and variant the supported attributes and key names
+		 * are remembered for.
+		 */
+		std::string getFactoryClassKey();
+
+		/*!
+		 * Retrieve the names of the keys of this factory's class, as seen in the paths from
+		 * getInstanceNames.
+		 * @param[out] keyNames
+		 * 		The key names.
+		 * @return
+		 * 		false if no path of the class has been seen yet.
+		 */
+		bool getKnownKeyNames(AttributeNameSet &keyNames);
+
+		/*!
+		 * Remember the key names of this factory's class from the first of a list of paths.
+		 */
+		void rememberKeyNames(const instance_names_t &paths);
+
 		/*
 		 * Check that each paths' keys exist in an object path received from getInstanceNames.
 		 *
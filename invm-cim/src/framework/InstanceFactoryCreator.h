@@ -41,6 +41,14 @@ class INVM_CIM_API InstanceFactoryCreator
 {
 public:
 	virtual InstanceFactory *getInstanceFactory(const std::string &className) = 0;
+
+	/*
+	 * How many association table entries a single request may evaluate at the same time
+	 * on the framework thread pool. 1 (the default) evaluates them one after the other on
+	 * the calling thread. Only raise it if the instance factories can be used from several
+	 * threads at once and don't call back into the CIMOM.
+	 */
+	virtual UINT32 getAssociationConcurrency() { return 1; }
 };
 
 }
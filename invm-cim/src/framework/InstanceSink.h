@@ -0,0 +1,64 @@
+/*
+ * Copyright (c) 2015 2016, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of Intel Corporation nor the names of its contributors
+ *     may be used to endorse or promote products derived from this software
+ *     without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * This file defines the interface that receives instances as they are found.
+ */
+
+#ifndef	_WBEM_FRAMEWORK_INSTANCE_SINK_H_
+#define	_WBEM_FRAMEWORK_INSTANCE_SINK_H_
+
+#include "Instance.h"
+#include "Export.h"
+
+namespace wbem
+{
+namespace framework
+{
+
+/*!
+ * Receives the instances found by InstanceFactory::streamInstances one at a time, so a
+ * caller can pass them on without holding every result in memory.
+ */
+class INVM_CIM_API InstanceSink
+{
+	public:
+		virtual ~InstanceSink() {}
+
+		/*!
+		 * Take the next instance.
+		 * @param[in,out] instance
+		 * 		The instance. The sink may move its contents out.
+		 * @return
+		 * 		false if the sink doesn't want any more instances.
+		 */
+		virtual bool addInstance(Instance &instance) = 0;
+};
+
+} // framework
+} // wbem
+#endif  // _WBEM_FRAMEWORK_INSTANCE_SINK_H_
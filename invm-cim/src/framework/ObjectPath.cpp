@@ -167,3 +167,86 @@ bool wbem::framework::ObjectPath::operator!=(const ObjectPath &rhs)
 	return (rhs.asString() != this->asString());
 }
 
+
+/*
+ * FNV-1a over the parts of the path that asString(true) includes. ObjectPathEqual compares
+ * a reference key with a string key by asStr(), so every key is hashed by asStr() too.
+ */
+static void hashString(size_t &hash, const std::string &value)
+{
+	for (std::string::const_iterator iter = value.begin(); iter != value.end(); iter++)
+	{
+		hash ^= (size_t)(unsigned char)*iter;
+		hash *= 16777619u;
+	}
+	// terminate each part so "ab"+"c" and "a"+"bc" differ
+	hash ^= 0xffu;
+	hash *= 16777619u;
+}
+
+size_t wbem::framework::ObjectPathHash::operator()(const ObjectPath &path) const
+{
+	size_t hash = 2166136261u;
+	hashString(hash, path.getNamespace());
+	hashString(hash, path.getClass());
+
+	const attributes_t &keys = path.getKeys();
+	for (attributes_t::const_iterator iter = keys.begin(); iter != keys.end(); iter++)
+	{
+		if (iter->second.isKey())
+		{
+			hashString(hash, iter->first);
+			hashString(hash, iter->second.asStr());
+		}
+	}
+	return hash;
+}
+
+bool wbem::framework::ObjectPathEqual::operator()(
+		const ObjectPath &lhs, const ObjectPath &rhs) const
+{
+	if (lhs.getClass() != rhs.getClass() || lhs.getNamespace() != rhs.getNamespace())
+	{
+		return false;
+	}
+
+	// only the key attributes are part of the path
+	const attributes_t &lhsKeys = lhs.getKeys();
+	const attributes_t &rhsKeys = rhs.getKeys();
+	attributes_t::const_iterator lhsIter = lhsKeys.begin();
+	attributes_t::const_iterator rhsIter = rhsKeys.begin();
+	while (true)
+	{
+		while (lhsIter != lhsKeys.end() && !lhsIter->second.isKey())
+		{
+			lhsIter++;
+		}
+		while (rhsIter != rhsKeys.end() && !rhsIter->second.isKey())
+		{
+			rhsIter++;
+		}
+		if (lhsIter == lhsKeys.end() || rhsIter == rhsKeys.end())
+		{
+			break;
+		}
+
+		if (lhsIter->first != rhsIter->first)
+		{
+			return false;
+		}
+		if (lhsIter->second.getType() == REFERENCE_T && rhsIter->second.getType() == REFERENCE_T)
+		{
+			if (!(*this)(lhsIter->second.referenceValue(), rhsIter->second.referenceValue()))
+			{
+				return false;
+			}
+		}
+		else if (lhsIter->second.asStr() != rhsIter->second.asStr())
+		{
+			return false;
+		}
+		lhsIter++;
+		rhsIter++;
+	}
+	return lhsIter == lhsKeys.end() && rhsIter == rhsKeys.end();
+}
@@ -184,6 +184,24 @@ class INVM_CIM_API ObjectPath
  */
 typedef std::vector<ObjectPath> instance_names_t;
 
+/*!
+ * Hash functor for object paths that ignores the host name.
+ * @remarks Reference keys are hashed from the path they hold, so no strings are built.
+ */
+struct INVM_CIM_API ObjectPathHash
+{
+	size_t operator()(const ObjectPath &path) const;
+};
+
+/*!
+ * Equality functor for object paths that ignores the host name, matching a comparison of
+ * asString(true) without building the strings.
+ */
+struct INVM_CIM_API ObjectPathEqual
+{
+	bool operator()(const ObjectPath &lhs, const ObjectPath &rhs) const;
+};
+
 }
 }
 #endif  // #ifndef _WBEM_FRAMEWORK_OBJECT_PATH_H_
@@ -25,7 +25,10 @@
  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <logger/logging.h>
 #include "ProviderFactory.h"
+#include "AssociationIndex.h"
+#include "RequestContext.h"
 #include "Strings.h"
 
 namespace wbem
@@ -33,9 +36,9 @@ namespace wbem
 namespace framework
 {
 
-ProviderFactory *ProviderFactory::m_pSingleton = NULL;
+std::atomic<ProviderFactory *> ProviderFactory::m_pSingleton(NULL);
 
-ProviderFactory::ProviderFactory()
+ProviderFactory::ProviderFactory() : m_actions(0)
 {
 	// Child ProviderFactory is expected to override this
 	setDefaultCimNamespace(INTEL_ROOT_NAMESPACE);
@@ -43,11 +46,9 @@ ProviderFactory::ProviderFactory()
 
 ProviderFactory::~ProviderFactory()
 {
-	if (this == m_pSingleton)
-	{
-		// We must be the singleton - set it to null before we go away
-		m_pSingleton = NULL;
-	}
+	// If we are the singleton - set it to null before we go away
+	ProviderFactory *pThis = this;
+	m_pSingleton.compare_exchange_strong(pThis, NULL);
 }
 
 ProviderFactory *ProviderFactory::getSingleton()
@@ -57,15 +58,71 @@ ProviderFactory *ProviderFactory::getSingleton()
 
 void ProviderFactory::setSingleton(ProviderFactory* pProviderFactory)
 {
-	deleteSingleton();
-	m_pSingleton = pProviderFactory;
+	ProviderFactory *pOld = m_pSingleton.exchange(pProviderFactory);
+	if (pOld && pOld != pProviderFactory)
+	{
+		delete pOld;
+	}
+	// results from another provider don't apply
+	AssociationIndex::getSingleton().clear();
 }
 
 void ProviderFactory::deleteSingleton()
 {
-	if (m_pSingleton)
+	ProviderFactory *pOld = m_pSingleton.exchange(NULL);
+	if (pOld)
+	{
+		delete pOld;
+	}
+	AssociationIndex::getSingleton().clear();
+}
+
+void ProviderFactory::warmUp()
+{
+	LogEnterExit logging(__FILE__, __FUNCTION__, __LINE__);
+
+	std::vector<std::string> classNames = getWarmUpClasses();
+	beginAction();
+	for (size_t i = 0; i < classNames.size() && !RequestContext::stopRequested(); i++)
+	{
+		InstanceFactory *pFactory = getInstanceFactory(classNames[i]);
+		if (pFactory == NULL)
+		{
+			COMMON_LOG_WARN_F("No factory to warm up for class %s", classNames[i].c_str());
+		}
+		else
+		{
+			try
+			{
+				pFactory->warmUp(classNames[i]);
+			}
+			catch (Exception &e)
+			{
+				COMMON_LOG_WARN_F("Failed to warm up class %s: %s",
+						classNames[i].c_str(), e.what());
+			}
+			delete pFactory;
+		}
+	}
+	endAction();
+}
+
+void ProviderFactory::beginAction()
+{
+	std::lock_guard<std::mutex> lock(m_actionLock);
+	if (m_actions == 0)
+	{
+		InitializeProvider();
+	}
+	m_actions++;
+}
+
+void ProviderFactory::endAction()
+{
+	std::lock_guard<std::mutex> lock(m_actionLock);
+	if (m_actions > 0 && --m_actions == 0)
 	{
-		delete m_pSingleton;
+		CleanUpProvider();
 	}
 }
 
@@ -33,6 +33,8 @@
 #ifndef WBEM_FRAMEWORK_PROVIDERFACTORY_H_
 #define WBEM_FRAMEWORK_PROVIDERFACTORY_H_
 
+#include <atomic>
+#include <mutex>
 #include <string>
 #include <vector>
 #include "InstanceFactory.h"
@@ -56,6 +58,9 @@ public:
 	 *
 	 * Setting the singleton will cause the old singleton, if any, to be automatically
 	 * deleted.
+	 *
+	 * The singleton pointer is atomic so CIMOM threads can read it while it is being
+	 * set. The provider must not swap or delete it while requests are still in flight.
 	 */
 	static ProviderFactory *getSingleton();
 	static void setSingleton(ProviderFactory *pProviderFactory);
@@ -71,6 +76,44 @@ public:
 	 */
 	virtual void CleanUpProvider() {};
 
+	/*
+	 * Start an action. Actions overlap, e.g. CIMOM requests on several threads and the
+	 * warm-up, so InitializeProvider is only called by the first of overlapping actions
+	 * and CleanUpProvider by the last. Neither is called while the other is running.
+	 */
+	void beginAction();
+
+	/*
+	 * End an action started with beginAction.
+	 */
+	void endAction();
+
+	/*
+	 * Time budget in milliseconds for each CIMOM request. When it runs out, enumerations
+	 * stop early and return the results gathered so far. 0 (the default) means no deadline.
+	 */
+	virtual UINT32 getRequestTimeout() { return 0; }
+
+	/*
+	 * Classes to warm up when the CIMOM loads the provider, so the caches requests read
+	 * (see InstanceFactory::warmUp) are filled before the first client request. Empty (the
+	 * default) disables warm-up.
+	 */
+	virtual std::vector<std::string> getWarmUpClasses() { return std::vector<std::string>(); }
+
+	/*
+	 * Answer associators and references requests from the association index instead of
+	 * joining again each time. Only return true if the indication service reports every
+	 * instance change, otherwise the index goes stale. Defaults to false.
+	 */
+	virtual bool useAssociationIndex() { return false; }
+
+	/*
+	 * Instantiate the factory for each warm-up class and let it warm itself up. Stops early
+	 * if the current request context is cancelled. Errors are logged and otherwise ignored.
+	 */
+	void warmUp();
+
 	/*
 	 * Fetches the default CIM namespace for this set of CIM providers.
 	 */
@@ -113,8 +156,10 @@ public:
 	virtual IndicationService *getIndicationService() = 0;
 
 protected:
-	static ProviderFactory *m_pSingleton;
+	static std::atomic<ProviderFactory *> m_pSingleton;
 	std::string m_defaultCimNamespace;
+	std::mutex m_actionLock;
+	UINT32 m_actions; // actions in progress, guarded by m_actionLock
 
 	/*
 	 * Sets the default CIM namespace for this set of CIM providers.
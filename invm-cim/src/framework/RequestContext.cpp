@@ -0,0 +1,133 @@
+/*
+ * Copyright (c) 2015 2016, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of Intel Corporation nor the names of its contributors
+ *     may be used to endorse or promote products derived from this software
+ *     without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * This file contains the implementation of the request context.
+ */
+
+#include <mutex>
+#include <set>
+
+#include <logger/logging.h>
+#include "RequestContext.h"
+
+namespace
+{
+	// the request the calling thread is servicing
+	thread_local wbem::framework::RequestContext *t_pCurrentRequest = NULL;
+
+	// every request in progress, so they can all be cancelled on unload. A request is in
+	// here once per thread working on it.
+	std::mutex g_activeRequestsLock;
+	std::multiset<wbem::framework::RequestContext *> g_activeRequests;
+}
+
+wbem::framework::RequestContext::RequestContext(const UINT32 timeoutMs)
+	: m_hasDeadline(timeoutMs > 0),
+	m_deadline(std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs)),
+	m_cancelled(false), m_truncated(false)
+{
+}
+
+void wbem::framework::RequestContext::cancel()
+{
+	m_cancelled = true;
+}
+
+bool wbem::framework::RequestContext::isCancelled() const
+{
+	return m_cancelled;
+}
+
+bool wbem::framework::RequestContext::isExpired() const
+{
+	return m_hasDeadline && std::chrono::steady_clock::now() >= m_deadline;
+}
+
+bool wbem::framework::RequestContext::shouldStop()
+{
+	bool stop = isCancelled() || isExpired();
+	if (stop && !m_truncated.exchange(true))
+	{
+		COMMON_LOG_WARN_F("Request %s, returning partial results",
+				isCancelled() ? "cancelled" : "deadline exceeded");
+	}
+	return stop;
+}
+
+bool wbem::framework::RequestContext::isTruncated() const
+{
+	return m_truncated;
+}
+
+void wbem::framework::RequestContext::setTruncated()
+{
+	if (!m_truncated.exchange(true))
+	{
+		COMMON_LOG_WARN("Request given partial results");
+	}
+}
+
+wbem::framework::RequestContext *wbem::framework::RequestContext::getCurrent()
+{
+	return t_pCurrentRequest;
+}
+
+bool wbem::framework::RequestContext::stopRequested()
+{
+	RequestContext *pContext = getCurrent();
+	return pContext != NULL && pContext->shouldStop();
+}
+
+void wbem::framework::RequestContext::cancelAll()
+{
+	std::lock_guard<std::mutex> lock(g_activeRequestsLock);
+	for (std::multiset<RequestContext *>::iterator iter = g_activeRequests.begin();
+			iter != g_activeRequests.end(); iter++)
+	{
+		(*iter)->cancel();
+	}
+}
+
+wbem::framework::RequestScope::RequestScope(RequestContext &context)
+	: m_pContext(&context), m_pPrevious(t_pCurrentRequest)
+{
+	t_pCurrentRequest = m_pContext;
+
+	std::lock_guard<std::mutex> lock(g_activeRequestsLock);
+	g_activeRequests.insert(m_pContext);
+}
+
+wbem::framework::RequestScope::~RequestScope()
+{
+	{
+		std::lock_guard<std::mutex> lock(g_activeRequestsLock);
+		g_activeRequests.erase(g_activeRequests.find(m_pContext));
+	}
+
+	t_pCurrentRequest = m_pPrevious;
+}
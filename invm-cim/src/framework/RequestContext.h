@@ -0,0 +1,147 @@
+/*
+ * Copyright (c) 2015 2016, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of Intel Corporation nor the names of its contributors
+ *     may be used to endorse or promote products derived from this software
+ *     without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * This file defines the context of a single CIMOM request. It carries the deadline and
+ * cancellation state that long running enumerations check so they can stop early.
+ */
+
+#ifndef	_WBEM_FRAMEWORK_REQUEST_CONTEXT_H_
+#define	_WBEM_FRAMEWORK_REQUEST_CONTEXT_H_
+
+#include <atomic>
+#include <chrono>
+
+#include "Types.h"
+#include "Export.h"
+
+namespace wbem
+{
+namespace framework
+{
+
+/*!
+ * Deadline and cancellation state for a single CIMOM request.
+ * @remarks A context is made current for the calling thread with a RequestScope. Framework
+ * loops (and providers doing slow device queries) call RequestContext::stopRequested() to find
+ * out whether they should give up and return what they have so far.
+ */
+class INVM_CIM_API RequestContext
+{
+	public:
+		/*!
+		 * Initialize a new request context.
+		 * @param[in] timeoutMs
+		 * 		The time budget for the request in milliseconds. 0 means no deadline.
+		 */
+		RequestContext(const UINT32 timeoutMs = 0);
+
+		/*!
+		 * Ask the request to stop as soon as possible. Safe to call from any thread.
+		 */
+		void cancel();
+
+		/*!
+		 * @return true if the request was cancelled.
+		 */
+		bool isCancelled() const;
+
+		/*!
+		 * @return true if the request has a deadline and it has passed.
+		 */
+		bool isExpired() const;
+
+		/*!
+		 * Check if the request should stop. If so the request is marked as truncated because
+		 * the caller is expected to return partial results.
+		 * @return true if the request was cancelled or its deadline has passed.
+		 */
+		bool shouldStop();
+
+		/*!
+		 * @return true if work was skipped because the request stopped early.
+		 */
+		bool isTruncated() const;
+
+		/*!
+		 * Mark the request as truncated when it is given partial results it didn't cut
+		 * short itself, e.g. results shared from another request that stopped early.
+		 */
+		void setTruncated();
+
+		/*!
+		 * Get the context of the request being serviced by the calling thread.
+		 * @return
+		 * 		The current context or NULL if the thread is not servicing a request.
+		 */
+		static RequestContext *getCurrent();
+
+		/*!
+		 * Check if the request being serviced by the calling thread should stop.
+		 * @return
+		 * 		false if there is no current request.
+		 */
+		static bool stopRequested();
+
+		/*!
+		 * Cancel every request currently in progress, e.g. when the provider is being unloaded.
+		 */
+		static void cancelAll();
+
+	private:
+		// Not copyable, the scope and the registry hold pointers to it
+		RequestContext(const RequestContext &);
+		RequestContext &operator=(const RequestContext &);
+
+		bool m_hasDeadline;
+		std::chrono::steady_clock::time_point m_deadline;
+		std::atomic<bool> m_cancelled;
+		std::atomic<bool> m_truncated;
+
+		friend class RequestScope;
+};
+
+/*!
+ * Makes a RequestContext current for the calling thread for the lifetime of the scope.
+ */
+class INVM_CIM_API RequestScope
+{
+	public:
+		RequestScope(RequestContext &context);
+		~RequestScope();
+
+	private:
+		RequestScope(const RequestScope &);
+		RequestScope &operator=(const RequestScope &);
+
+		RequestContext *m_pContext;
+		RequestContext *m_pPrevious;
+};
+
+} // framework
+} // wbem
+#endif  // _WBEM_FRAMEWORK_REQUEST_CONTEXT_H_
@@ -0,0 +1,228 @@
+/*
+ * Copyright (c) 2015 2016, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of Intel Corporation nor the names of its contributors
+ *     may be used to endorse or promote products derived from this software
+ *     without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * This file defines a helper that collapses identical concurrent requests into one.
+ */
+
+#ifndef	_WBEM_FRAMEWORK_SINGLE_FLIGHT_H_
+#define	_WBEM_FRAMEWORK_SINGLE_FLIGHT_H_
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "RequestContext.h"
+#include "Types.h"
+
+namespace wbem
+{
+namespace framework
+{
+
+/*!
+ * Counters describing how many calls went through a SingleFlight.
+ */
+struct SingleFlightCounters
+{
+	UINT64 executed; //!< calls that did the work themselves
+	UINT64 collapsed; //!< calls that waited on and shared another call's result
+};
+
+/*!
+ * Collapses concurrent calls with the same key into a single execution. The first caller
+ * for a key does the work while later callers wait and receive their own copy of the result.
+ * If the work throws, every waiting caller gets the same exception. If the first caller's
+ * request stopped early the result may be partial, so the waiting callers' requests are
+ * marked as truncated too.
+ * @remarks Results are not cached; once the call finishes the next caller starts a new one.
+ */
+template <class Result>
+class SingleFlight
+{
+	public:
+		SingleFlight() : m_executed(0), m_collapsed(0) {}
+
+		/*!
+		 * Run work, or wait for an identical call that is already running.
+		 * @param[in] key
+		 * 		Identifies calls that produce the same result.
+		 * @param[in] work
+		 * 		Produces the result. The result is owned by the caller.
+		 * @return
+		 * 		A result the caller must delete, or NULL if work returned NULL or the
+		 * 		caller's request stopped while waiting.
+		 */
+		Result *run(const std::string &key, std::function<Result *()> work)
+		{
+			std::shared_ptr<Flight> pFlight;
+			bool leader = false;
+			{
+				std::lock_guard<std::mutex> lock(m_lock);
+				typename std::map<std::string, std::shared_ptr<Flight> >::iterator iter =
+						m_flights.find(key);
+				if (iter != m_flights.end())
+				{
+					pFlight = iter->second;
+					pFlight->waiters++;
+				}
+				else
+				{
+					pFlight = std::make_shared<Flight>();
+					m_flights[key] = pFlight;
+					leader = true;
+				}
+			}
+
+			Result *pResult = NULL;
+			if (leader)
+			{
+				m_executed++;
+				try
+				{
+					pResult = work();
+				}
+				catch (...)
+				{
+					finish(key, pFlight, NULL, false, std::current_exception());
+					throw;
+				}
+				RequestContext *pContext = RequestContext::getCurrent();
+				bool truncated = pContext != NULL && pContext->isTruncated();
+				finish(key, pFlight, pResult, truncated, std::exception_ptr());
+			}
+			else
+			{
+				m_collapsed++;
+				pResult = wait(*pFlight);
+			}
+			return pResult;
+		}
+
+		/*!
+		 * Retrieve the counters.
+		 */
+		SingleFlightCounters getCounters() const
+		{
+			SingleFlightCounters counters;
+			counters.executed = m_executed;
+			counters.collapsed = m_collapsed;
+			return counters;
+		}
+
+	private:
+		struct Flight
+		{
+			Flight() : waiters(0), finished(false), truncated(false) {}
+
+			int waiters; // guarded by SingleFlight::m_lock
+			std::mutex lock;
+			std::condition_variable done;
+			bool finished;
+			bool truncated; // the result was cut short by the first caller's request
+			std::shared_ptr<Result> pResult;
+			std::exception_ptr error;
+		};
+
+		void finish(const std::string &key, std::shared_ptr<Flight> pFlight,
+				Result *pResult, bool truncated, std::exception_ptr error)
+		{
+			// stop new callers from joining before publishing the result
+			int waiters = 0;
+			{
+				std::lock_guard<std::mutex> lock(m_lock);
+				m_flights.erase(key);
+				waiters = pFlight->waiters;
+			}
+
+			std::lock_guard<std::mutex> lock(pFlight->lock);
+			// only pay for a copy if someone is waiting for it
+			if (pResult != NULL && waiters > 0)
+			{
+				pFlight->pResult.reset(new Result(*pResult));
+			}
+			pFlight->error = error;
+			pFlight->truncated = truncated;
+			pFlight->finished = true;
+			pFlight->done.notify_all();
+		}
+
+		Result *wait(Flight &flight)
+		{
+			Result *pResult = NULL;
+			std::unique_lock<std::mutex> lock(flight.lock);
+			bool stopped = false;
+			while (!flight.finished && !stopped)
+			{
+				// wake up now and then so the waiter's own deadline is honored
+				flight.done.wait_for(lock, std::chrono::milliseconds(100));
+				stopped = !flight.finished && RequestContext::stopRequested();
+			}
+
+			if (flight.finished)
+			{
+				if (flight.error)
+				{
+					std::rethrow_exception(flight.error);
+				}
+				if (flight.pResult)
+				{
+					pResult = new Result(*flight.pResult);
+				}
+				RequestContext *pContext = RequestContext::getCurrent();
+				if (flight.truncated && pContext != NULL)
+				{
+					pContext->setTruncated();
+				}
+			}
+			else
+			{
+				// partial is better than nothing, hand back an empty result
+				pResult = new Result();
+			}
+			return pResult;
+		}
+
+		// Not copyable
+		SingleFlight(const SingleFlight &);
+		SingleFlight &operator=(const SingleFlight &);
+
+		std::mutex m_lock;
+		std::map<std::string, std::shared_ptr<Flight> > m_flights;
+		std::atomic<UINT64> m_executed;
+		std::atomic<UINT64> m_collapsed;
+};
+
+} // framework
+} // wbem
+#endif  // _WBEM_FRAMEWORK_SINGLE_FLIGHT_H_
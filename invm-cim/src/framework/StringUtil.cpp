@@ -72,7 +72,7 @@ COMMON_INT64 wbem::framework::StringUtil::stringToInt64(const std::string& str)
 
 
 std::string wbem::framework::StringUtil::removeStrings(
-		const std::string& fkValue, std::vector<std::string> strList)
+		const std::string& fkValue, const std::vector<std::string> &strList)
 {
 	// avoid log tracing in this function, it is called a lot.
 	std::string ret = fkValue;
@@ -44,7 +44,7 @@ namespace framework
 		static bool stringCompareIgnoreCase(std::string str1, std::string str2);
 		static COMMON_UINT64 stringToUint64(const std::string& str);
 		static COMMON_INT64 stringToInt64(const std::string& str);
-		static std::string removeStrings(const std::string &fkValue, std::vector<std::string> strList);
+		static std::string removeStrings(const std::string &fkValue, const std::vector<std::string> &strList);
 
 		static std::string removeString(const std::string &fkValue, const std::string &st);
 	};
@@ -0,0 +1,99 @@
+/*
+ * Copyright (c) 2015 2016, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of Intel Corporation nor the names of its contributors
+ *     may be used to endorse or promote products derived from this software
+ *     without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * This file contains the implementation of the framework thread pool.
+ */
+
+#include "ThreadPool.h"
+
+wbem::framework::ThreadPool::ThreadPool(const size_t threadCount)
+	: m_stopping(false)
+{
+	size_t count = threadCount > 0 ? threadCount : 1;
+	for (size_t i = 0; i < count; i++)
+	{
+		m_threads.push_back(std::thread(&ThreadPool::runTasks, this));
+	}
+}
+
+wbem::framework::ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_lock);
+		m_stopping = true;
+	}
+	m_taskReady.notify_all();
+
+	for (size_t i = 0; i < m_threads.size(); i++)
+	{
+		m_threads[i].join();
+	}
+}
+
+void wbem::framework::ThreadPool::submit(const std::function<void()> &task)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_lock);
+		m_tasks.push_back(task);
+	}
+	m_taskReady.notify_one();
+}
+
+size_t wbem::framework::ThreadPool::getThreadCount() const
+{
+	return m_threads.size();
+}
+
+wbem::framework::ThreadPool &wbem::framework::ThreadPool::getShared()
+{
+	static ThreadPool pool(std::thread::hardware_concurrency());
+	return pool;
+}
+
+void wbem::framework::ThreadPool::runTasks()
+{
+	while (true)
+	{
+		std::function<void()> task;
+		{
+			std::unique_lock<std::mutex> lock(m_lock);
+			while (m_tasks.empty() && !m_stopping)
+			{
+				m_taskReady.wait(lock);
+			}
+			// queued tasks still run when stopping, callers may be waiting on them
+			if (m_tasks.empty())
+			{
+				break;
+			}
+			task = m_tasks.front();
+			m_tasks.pop_front();
+		}
+		task();
+	}
+}
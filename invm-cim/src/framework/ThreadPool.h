@@ -0,0 +1,102 @@
+/*
+ * Copyright (c) 2015 2016, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of Intel Corporation nor the names of its contributors
+ *     may be used to endorse or promote products derived from this software
+ *     without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * This file defines a small pool of worker threads shared by the framework.
+ */
+
+#ifndef	_WBEM_FRAMEWORK_THREAD_POOL_H_
+#define	_WBEM_FRAMEWORK_THREAD_POOL_H_
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "Export.h"
+
+namespace wbem
+{
+namespace framework
+{
+
+/*!
+ * A fixed set of worker threads that run submitted tasks in the order they were submitted.
+ * @remarks Tasks must not wait on other tasks in the same pool. A caller that needs results
+ * should do part of the work itself so it makes progress even when every worker is busy.
+ */
+class INVM_CIM_API ThreadPool
+{
+	public:
+		/*!
+		 * Start the worker threads.
+		 * @param[in] threadCount
+		 * 		Number of worker threads. At least one is started.
+		 */
+		ThreadPool(const size_t threadCount);
+
+		/*!
+		 * Finish the tasks already submitted and stop the worker threads.
+		 */
+		~ThreadPool();
+
+		/*!
+		 * Queue a task to run on one of the worker threads.
+		 * @param[in] task
+		 * 		The task. It must not throw.
+		 */
+		void submit(const std::function<void()> &task);
+
+		/*!
+		 * @return the number of worker threads
+		 */
+		size_t getThreadCount() const;
+
+		/*!
+		 * Get the pool shared by the framework. It is started the first time it is used
+		 * with one thread per hardware thread.
+		 */
+		static ThreadPool &getShared();
+
+	private:
+		ThreadPool(const ThreadPool &);
+		ThreadPool &operator=(const ThreadPool &);
+
+		void runTasks();
+
+		std::mutex m_lock;
+		std::condition_variable m_taskReady;
+		std::deque<std::function<void()> > m_tasks;
+		std::vector<std::thread> m_threads;
+		bool m_stopping;
+};
+
+} // framework
+} // wbem
+#endif  // _WBEM_FRAMEWORK_THREAD_POOL_H_
@@ -0,0 +1,330 @@
+/*
+ * Copyright (c) 2015 2016, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of Intel Corporation nor the names of its contributors
+ *     may be used to endorse or promote products derived from this software
+ *     without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * This file contains a WQL predicate that evaluates a batch of instances a column at a
+ * time.
+ */
+
+#include <algorithm>
+#include "WqlBatchPredicate.h"
+
+namespace wbem
+{
+namespace framework
+{
+
+/*
+ * The number of bitmap words for a batch
+ */
+static size_t bitmapWords(const size_t rows)
+{
+	return (rows + 63) / 64;
+}
+
+/*
+ * Clear the bits past the last row of a batch
+ */
+static void clearUnusedBits(selection_bitmap_t &selection, const size_t rows)
+{
+	if (rows % 64 != 0)
+	{
+		selection.back() &= (1ULL << (rows % 64)) - 1;
+	}
+}
+
+/*
+ * Returns true if no bit is set
+ */
+static bool noneSelected(const selection_bitmap_t &selection)
+{
+	for (size_t word = 0; word < selection.size(); word++)
+	{
+		if (selection[word] != 0)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+/*
+ * Set the bit for each value that passes the test and is present. The inner loop has no
+ * branches, so the compiler can vectorize it.
+ */
+template <typename T, typename Test>
+static void selectWhere(const std::vector<T> &values, const selection_bitmap_t &present,
+		const Test &test, selection_bitmap_t &selection)
+{
+	const size_t rows = values.size();
+	for (size_t word = 0; word < selection.size(); word++)
+	{
+		const size_t base = word * 64;
+		const size_t bits = std::min<size_t>(64, rows - base);
+		const T *pValues = &values[base];
+		UINT64 result = 0;
+		for (size_t bit = 0; bit < bits; bit++)
+		{
+			result |= (UINT64)test(pValues[bit]) << bit;
+		}
+		selection[word] = result & present[word];
+	}
+}
+
+/*
+ * Compare each value of a column with a number
+ */
+template <typename T>
+static void selectOrdered(const std::vector<T> &values, const selection_bitmap_t &present,
+		const ComparisonOperator op, const T value, selection_bitmap_t &selection)
+{
+	switch (op)
+	{
+		case OP_EQ:
+			selectWhere(values, present, [value](const T v) { return v == value; }, selection);
+			break;
+		case OP_GT:
+			selectWhere(values, present, [value](const T v) { return v > value; }, selection);
+			break;
+		case OP_LT:
+			selectWhere(values, present, [value](const T v) { return v < value; }, selection);
+			break;
+		case OP_GE:
+			selectWhere(values, present, [value](const T v) { return v >= value; }, selection);
+			break;
+		case OP_LE:
+			selectWhere(values, present, [value](const T v) { return v <= value; }, selection);
+			break;
+		case OP_NE:
+			selectWhere(values, present, [value](const T v) { return v != value; }, selection);
+			break;
+		default:
+			std::fill(selection.begin(), selection.end(), 0);
+			break;
+	}
+}
+
+WqlBatchPredicate::WqlBatchPredicate(const WqlConditional *pConditional) :
+	WqlPredicate(pConditional)
+{
+	// comparisons on the same attribute share its column
+	AttributeNameEqual equal;
+	for (size_t i = 0; i < m_comparisons.size(); i++)
+	{
+		size_t column = 0;
+		while (!equal(m_attributeNames[column], m_comparisons[i].attributeName))
+		{
+			column++;
+		}
+		m_columnIndexes.push_back(column);
+	}
+}
+
+void WqlBatchPredicate::select(const instances_t &instances, const size_t first,
+		const size_t count, selection_bitmap_t &selection) const
+{
+	std::vector<struct Column> columns(m_attributeNames.size());
+	for (size_t i = 0; i < columns.size(); i++)
+	{
+		buildColumn(instances, first, count, m_attributeNames[i], columns[i]);
+	}
+	run(columns, count, 0, m_program.size(), selection);
+}
+
+void WqlBatchPredicate::buildColumn(const instances_t &instances, const size_t first,
+		const size_t count, const std::string &name, struct Column &column)
+{
+	column.attributes.assign(count, NULL);
+	column.kind = COLUMNKIND_OTHER;
+	bool found = false;
+	for (size_t row = 0; row < count; row++)
+	{
+		const Attribute *pAttribute = instances[first + row].findAttribute(name);
+		column.attributes[row] = pAttribute;
+		if (pAttribute)
+		{
+			enum columnKind kind = COLUMNKIND_OTHER;
+			switch (pAttribute->getType())
+			{
+				case BOOLEAN_T:
+				case UINT8_T:
+				case UINT16_T:
+				case UINT32_T:
+				case UINT64_T:
+				case ENUM_T:
+				case ENUM16_T:
+					kind = COLUMNKIND_UNSIGNED;
+					break;
+				case SINT8_T:
+				case SINT16_T:
+				case SINT32_T:
+				case SINT64_T:
+					kind = COLUMNKIND_SIGNED;
+					break;
+				case REAL32_T:
+					kind = COLUMNKIND_REAL;
+					break;
+				default:
+					break;
+			}
+			column.kind = (!found || kind == column.kind) ? kind : COLUMNKIND_OTHER;
+			found = true;
+		}
+	}
+
+	column.present.assign(bitmapWords(count), 0);
+	switch (column.kind)
+	{
+		case COLUMNKIND_UNSIGNED:
+			column.uintValues.assign(count, 0);
+			break;
+		case COLUMNKIND_SIGNED:
+			column.sintValues.assign(count, 0);
+			break;
+		case COLUMNKIND_REAL:
+			column.realValues.assign(count, 0);
+			break;
+		case COLUMNKIND_OTHER:
+			// compared one attribute at a time
+			return;
+	}
+	for (size_t row = 0; row < count; row++)
+	{
+		const Attribute *pAttribute = column.attributes[row];
+		if (pAttribute)
+		{
+			column.present[row / 64] |= 1ULL << (row % 64);
+			switch (column.kind)
+			{
+				case COLUMNKIND_UNSIGNED:
+					column.uintValues[row] = pAttribute->uint64Value();
+					break;
+				case COLUMNKIND_SIGNED:
+					column.sintValues[row] = pAttribute->sint64Value();
+					break;
+				case COLUMNKIND_REAL:
+					column.realValues[row] = (double)pAttribute->real32Value();
+					break;
+				case COLUMNKIND_OTHER:
+					break;
+			}
+		}
+	}
+}
+
+void WqlBatchPredicate::selectComparison(const struct Column &column,
+		const struct Comparison &comparison, selection_bitmap_t &selection)
+{
+	bool isNumber = comparison.valueType == UINT64_T || comparison.valueType == BOOLEAN_T;
+	bool isNegative = comparison.valueType == SINT64_T;
+	bool isReal = comparison.valueType == REAL32_T;
+	bool isOrdering = comparison.op != OP_LIKE && comparison.op != OP_ISA;
+	if (isNumber && isOrdering && column.kind == COLUMNKIND_UNSIGNED)
+	{
+		selectOrdered(column.uintValues, column.present, comparison.op,
+				comparison.uintValue, selection);
+	}
+	else if ((isNumber || isNegative) && isOrdering && column.kind == COLUMNKIND_SIGNED)
+	{
+		selectOrdered(column.sintValues, column.present, comparison.op,
+				comparison.sintValue, selection);
+	}
+	else if ((isNumber || isNegative || isReal) && isOrdering &&
+			column.kind == COLUMNKIND_REAL)
+	{
+		selectOrdered(column.realValues, column.present, comparison.op,
+				comparison.realValue, selection);
+	}
+	else
+	{
+		// scalar fallback
+		std::fill(selection.begin(), selection.end(), 0);
+		for (size_t row = 0; row < column.attributes.size(); row++)
+		{
+			if (test(column.attributes[row], comparison))
+			{
+				selection[row / 64] |= 1ULL << (row % 64);
+			}
+		}
+	}
+}
+
+void WqlBatchPredicate::run(const std::vector<struct Column> &columns, const size_t rows,
+		const size_t start, const size_t end, selection_bitmap_t &selection) const
+{
+	// the register starts out true, as in matches
+	selection.assign(bitmapWords(rows), ~0ULL);
+	clearUnusedBits(selection, rows);
+
+	size_t next = start;
+	while (next < end)
+	{
+		const struct WqlInstruction &instruction = m_program[next++];
+		switch (instruction.opcode)
+		{
+			case WQLOP_TEST:
+				selectComparison(columns[m_columnIndexes[instruction.operand]],
+						m_comparisons[instruction.operand], selection);
+				break;
+			case WQLOP_NOT:
+				for (size_t word = 0; word < selection.size(); word++)
+				{
+					selection[word] = ~selection[word];
+				}
+				clearUnusedBits(selection, rows);
+				break;
+			case WQLOP_JUMPIFFALSE:
+				// the instructions jumped over are the right operand of an AND
+				if (!noneSelected(selection))
+				{
+					selection_bitmap_t operand;
+					run(columns, rows, next, instruction.operand, operand);
+					for (size_t word = 0; word < selection.size(); word++)
+					{
+						selection[word] &= operand[word];
+					}
+				}
+				next = instruction.operand;
+				break;
+			case WQLOP_JUMPIFTRUE:
+				// the instructions jumped over are the right operand of an OR
+				{
+					selection_bitmap_t operand;
+					run(columns, rows, next, instruction.operand, operand);
+					for (size_t word = 0; word < selection.size(); word++)
+					{
+						selection[word] |= operand[word];
+					}
+				}
+				next = instruction.operand;
+				break;
+		}
+	}
+}
+
+} /* namespace framework */
+} /* namespace wbem */
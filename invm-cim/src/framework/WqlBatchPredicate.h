@@ -0,0 +1,137 @@
+/*
+ * Copyright (c) 2015 2016, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of Intel Corporation nor the names of its contributors
+ *     may be used to endorse or promote products derived from this software
+ *     without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * This file contains a WQL predicate that evaluates a batch of instances a column at a
+ * time.
+ */
+
+#ifndef WQLBATCHPREDICATE_H_
+#define WQLBATCHPREDICATE_H_
+
+#include <vector>
+
+#include "Instance.h"
+#include "WqlPredicate.h"
+
+#define	WQL_BATCH_ROWS 1024 //!< Instances evaluated together by WqlEvaluator
+
+namespace wbem
+{
+namespace framework
+{
+
+/*!
+ * One bit per instance of a batch, the lowest bit of the first word for the first instance.
+ */
+typedef std::vector<UINT64> selection_bitmap_t;
+
+/*!
+ * A WQL predicate that evaluates a batch of instances at once. The attributes a comparison
+ * needs are gathered into a column, and a numeric comparison on a column of one kind of
+ * number is a plain loop over an array of values that sets a word of the selection bitmap
+ * at a time. Other comparisons (strings, LIKE, ISA, datetimes, and columns mixing kinds of
+ * values) fall back to testing one attribute at a time. AND, OR and NOT become bitwise
+ * operations on the bitmaps.
+ * @remarks The results are the same as calling matches for each instance.
+ */
+class INVM_CIM_API WqlBatchPredicate : public WqlPredicate
+{
+	public:
+		/*!
+		 * Compile a conditional.
+		 * @param pConditional
+		 * 		The conditional, or NULL for a predicate that matches every instance.
+		 */
+		WqlBatchPredicate(const WqlConditional *pConditional);
+
+		/*!
+		 * Evaluate the predicate over a range of instances.
+		 * @param instances - the instances
+		 * @param first - the first instance of the batch
+		 * @param count - the number of instances in the batch
+		 * @param selection - returns a bit set for each instance of the batch that matches
+		 */
+		void select(const instances_t &instances, const size_t first, const size_t count,
+				selection_bitmap_t &selection) const;
+
+		/*!
+		 * Returns true if the bit for a row of a batch is set.
+		 */
+		static bool isSelected(const selection_bitmap_t &selection, const size_t row)
+		{ return (selection[row / 64] >> (row % 64)) & 1; }
+
+	protected:
+		/*
+		 * The kinds of value a column can hold
+		 */
+		enum columnKind
+		{
+			COLUMNKIND_UNSIGNED, //!< booleans, unsigned integers and enumeration values
+			COLUMNKIND_SIGNED, //!< signed integers
+			COLUMNKIND_REAL, //!< floating point numbers
+			COLUMNKIND_OTHER //!< anything else, or a mix of kinds
+		};
+
+		/*
+		 * The values of one attribute for each instance of a batch
+		 */
+		struct Column
+		{
+			std::vector<const Attribute *> attributes; //!< NULL if the instance doesn't have it
+			enum columnKind kind;
+			selection_bitmap_t present; //!< instances with a value of the column's kind
+			std::vector<UINT64> uintValues; //!< filled in for its kind, 0 if not present
+			std::vector<SINT64> sintValues;
+			std::vector<double> realValues;
+		};
+
+		std::vector<size_t> m_columnIndexes; //!< index of each comparison's column
+
+		/*
+		 * Gather the values of an attribute for a batch of instances
+		 */
+		static void buildColumn(const instances_t &instances, const size_t first,
+				const size_t count, const std::string &name, struct Column &column);
+
+		/*
+		 * Evaluate one comparison over a column
+		 */
+		static void selectComparison(const struct Column &column,
+				const struct Comparison &comparison, selection_bitmap_t &selection);
+
+		/*
+		 * Run the instructions from start up to (not including) end over the columns
+		 */
+		void run(const std::vector<struct Column> &columns, const size_t rows,
+				const size_t start, const size_t end, selection_bitmap_t &selection) const;
+};
+
+} /* namespace framework */
+} /* namespace wbem */
+
+#endif /* WQLBATCHPREDICATE_H_ */
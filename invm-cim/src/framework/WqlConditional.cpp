@@ -29,12 +29,6 @@
  * This file contains a class to represent a WQL conditional statement.
  */
 
-#include <memory>
-#include <string/s_str.h>
-#include <string/x_str.h>
-#include <stdlib.h>
-#include <cerrno>
-#include <sstream>
 #include <logger/logging.h>
 #include "ExceptionInvalidWqlQuery.h"
 #include "WqlConditional.h"
@@ -48,54 +42,16 @@ namespace framework
 /*
  * Constructor
  */
-WqlConditional::WqlConditional(const std::vector<std::string>& tokens) throw (Exception)
+WqlConditional::WqlConditional(const WqlLexer &lexer, const size_t first, const size_t end)
+	throw (Exception)
 {
-	// rebuild a string from the tokens
-	std::stringstream stream;
-	for (size_t i = 0; i < tokens.size(); i++)
-	{
-		std::string token = tokens[i];
-		if (i > 0)
-		{
-			stream << " ";
-		}
-		stream << token;
-	}
-	m_str = stream.str();
-	initFromTokens(tokens);
+	initFromTokens(lexer, first, end);
 }
 
-WqlConditional::WqlConditional(const std::string& str) throw (Exception) :
-		m_str(str)
+WqlConditional::WqlConditional(const std::string& str) throw (Exception)
 {
-	size_t length = str.size() + 1;
-	std::unique_ptr<char[]> tempStr(new char[length]);
-	s_strcpy(tempStr.get(), str.c_str(), length);
-
-	// set of conditional tokens
-	std::vector<std::string> tokens;
-
-	// Tokenize the input string
-	bool openQuotes = false; // track open quotes
-	char quoteType = '\0'; // track open quotes
-	const char *delim = " \t\n"; // delimiters - whitespace
-	char *pNext = tempStr.get(); // where to start search for next token
-	char *pCh = x_strtok(&pNext, delim);
-	while (pCh != NULL)
-	{
-		std::string token = pCh;
-		std::vector<std::string> substrings = dissectConditionalToken(token, openQuotes, quoteType);
-		tokens.insert(tokens.end(), substrings.begin(), substrings.end());
-
-		// Keep going until we find a non-empty substring
-		do
-		{
-			pCh = x_strtok(&pNext, delim);
-		}
-		while (pCh && std::string(pCh).empty());
-	}
-
-	initFromTokens(tokens);
+	WqlLexer lexer(str);
+	initFromTokens(lexer, 0, lexer.size());
 }
 
 /*
@@ -108,9 +64,12 @@ WqlConditional::~WqlConditional()
 /*
  * Copy constructor
  */
-WqlConditional::WqlConditional(const WqlConditional& cond)
+WqlConditional::WqlConditional(const WqlConditional& cond) :
+		m_conditions(cond.m_conditions),
+		m_program(cond.m_program),
+		m_isConjunction(cond.m_isConjunction),
+		m_str(cond.m_str)
 {
-	m_conditions = cond.m_conditions;
 }
 
 /*
@@ -119,6 +78,9 @@ WqlConditional::WqlConditional(const WqlConditional& cond)
 WqlConditional& WqlConditional::operator=(const WqlConditional& cond)
 {
 	m_conditions = cond.m_conditions;
+	m_program = cond.m_program;
+	m_isConjunction = cond.m_isConjunction;
+	m_str = cond.m_str;
 
 	return *this;
 }
@@ -126,316 +88,272 @@ WqlConditional& WqlConditional::operator=(const WqlConditional& cond)
 /*
  * Parse the conditional from tokens
  */
-void WqlConditional::initFromTokens(const std::vector<std::string> &tokens) throw (Exception)
+void WqlConditional::initFromTokens(const WqlLexer &lexer, const size_t first,
+		const size_t end) throw (Exception)
 {
 	Trace logging(__FILE__, __FUNCTION__, __LINE__);
 
-	// Parsing states
-	enum ConditionalParseState
-	{
-		STATE_NAME,
-		STATE_OP,
-		STATE_VALUE,
-		STATE_DONE
-	};
-	enum ConditionalParseState state = STATE_NAME;
-	int depth = 0; // keep track of nested parentheses - for format validation
-	bool openQuotes = false; // keep track of open quote marks
-	std::string quoteType = ""; // what type of quote mark is open?
-	struct WqlComparisonClause temp;
-	std::string tempValue = "";
+	m_conditions.clear();
+	m_program.clear();
+	m_isConjunction = true;
+	m_str = lexer.getText(first, end);
+
+	size_t pos = first;
+	parseConditional(lexer, pos, end);
 
-	// Build the conditional list
-	for (std::vector<std::string>::const_iterator iter = tokens.begin(); iter != tokens.end(); iter++)
+	// Validate that the whole input string was used
+	if (pos < end)
 	{
-		const std::string &token = *iter;
-		switch (state)
+		if (lexer.isType(pos, WQLTOKEN_CLOSEPAREN))
 		{
-		case STATE_NAME:
-			// We only expect opening parens at the beginnings of clauses
-			if (token == "(")
-			{
-				depth++;
-			}
-			else
-			{
-				if (WqlQuery::isValidCimName(token))
-				{
-					temp.attributeName = token;
-					state = STATE_OP;
-				}
-				else
-				{
-					COMMON_LOG_ERROR_F("expected valid attribute name, got: %s", token.c_str());
-					throw ExceptionInvalidWqlQuery(ExceptionInvalidWqlQuery::REASON_BADATTR, token);
-				}
-			}
-			break;
-		case STATE_OP:
-			if (token == WQL_EQ)
-			{
-				temp.op = OP_EQ;
-			}
-			else if (token == WQL_GT)
-			{
-				temp.op = OP_GT;
-			}
-			else if (token == WQL_LT)
-			{
-				temp.op = OP_LT;
-			}
-			else if (token == WQL_GE)
-			{
-				temp.op = OP_GE;
-			}
-			else if (token == WQL_LE)
-			{
-				temp.op = OP_LE;
-			}
-			else if ((token == WQL_NE1) || (token == WQL_NE2))
-			{
-				temp.op = OP_NE;
-			}
-			else
-			{
-				COMMON_LOG_ERROR_F("expected operator token, got: %s", token.c_str());
-				throw ExceptionInvalidWqlQuery(ExceptionInvalidWqlQuery::REASON_BADOPERATOR, token);
-			}
-			state = STATE_VALUE;
-			break;
-		case STATE_VALUE:
-			if (openQuotes)
-			{
-				if (token == quoteType) // closing a string
-				{
-					// see if it's a datetime type
-					try
-					{
-						temp.value = Attribute(tempValue, DATETIME_SUBTYPE_DATETIME, false);
-					}
-					catch (Exception &) // wasn't a datetime string
-					{
-						temp.value = Attribute(tempValue, false);
-					}
+			COMMON_LOG_ERROR("unmatched closing parenthesis");
+			throw ExceptionInvalidWqlQuery(ExceptionInvalidWqlQuery::REASON_UNMATCHEDPARENS);
+		}
+		std::string token = lexer.getText(pos);
+		COMMON_LOG_ERROR_F("expected AND or OR, got: %s", token.c_str());
+		throw ExceptionInvalidWqlQuery(ExceptionInvalidWqlQuery::REASON_BADOPERATOR, token);
+	}
+}
 
-					// clear string tracking values
-					tempValue = "";
-					openQuotes = false;
-					quoteType = "";
+/*
+ * conditional := term { OR term }
+ */
+void WqlConditional::parseConditional(const WqlLexer &lexer, size_t &pos, const size_t end)
+	throw (Exception)
+{
+	parseTerm(lexer, pos, end);
 
-					state = STATE_DONE;
-				}
-				else
-				{
-					// string in progress
-					if (!tempValue.empty())
-					{
-						tempValue += " ";
-					}
-					tempValue += token;
-				}
-			}
-			else if ((token == "\"") || (token == "'")) // opening quote marks
-			{
-				openQuotes = true;
-				quoteType = token;
-			}
-			else
-			{
-				// figure out the type
-				// try a numeric value
-				UINT64 intValue = 0;
-				char *pEnd = NULL;
-				errno = 0;
-				intValue = strtoull(token.c_str(), &pEnd, 0);
-				if ((errno == 0) && pEnd && (*pEnd == '\0')) // it was a valid 64-bit number
-				{
-					temp.value = Attribute(intValue, false);
-				}
-				// try boolean
-				else if (s_strncmpi(token.c_str(), WQL_TRUE.c_str(), WQL_TRUE.size() + 1) == 0)
-				{
-					temp.value = Attribute(true, false);
-				}
-				else if (s_strncmpi(token.c_str(), WQL_FALSE.c_str(), WQL_FALSE.size() + 1) == 0)
-				{
-					temp.value = Attribute(false, false);
-				}
-				// can't recognize it
-				else
-				{
-					COMMON_LOG_ERROR_F("couldn't decipher the type of token: %s", token.c_str());
-					throw ExceptionInvalidWqlQuery(ExceptionInvalidWqlQuery::REASON_BADVALUE, token);
-				}
+	// each OR jumps to the end as soon as a term is true
+	std::vector<size_t> jumps;
+	while (pos < end && lexer.isKeyword(pos, WQL_OR))
+	{
+		pos++;
+		m_isConjunction = false;
+		jumps.push_back(emit(WQLOP_JUMPIFTRUE));
+		parseTerm(lexer, pos, end);
+	}
+	for (size_t i = 0; i < jumps.size(); i++)
+	{
+		m_program[jumps[i]].operand = (UINT32)m_program.size();
+	}
+}
 
-				state = STATE_DONE;
-			}
+/*
+ * term := factor { AND factor }
+ */
+void WqlConditional::parseTerm(const WqlLexer &lexer, size_t &pos, const size_t end)
+	throw (Exception)
+{
+	parseFactor(lexer, pos, end);
 
-			// we finished harvesting the value
-			if (state == STATE_DONE)
-			{
-				m_conditions.push_back(temp);
-			}
-			break;
-		case STATE_DONE: // reached the end of a valid statement
-			// might have a closing parenthesis in this state
-			if (token == ")")
-			{
-				depth--;
-			}
-			else if (s_strncmpi(token.c_str(), WQL_AND.c_str(), WQL_AND.size() + 1) == 0)
-				// could connect to another clause with AND
-			{
-				state = STATE_NAME;
-			}
-			else
-			{
-				COMMON_LOG_ERROR_F("expected AND, got: %s", token.c_str());
-				throw ExceptionInvalidWqlQuery(ExceptionInvalidWqlQuery::REASON_BADOPERATOR, token);
-			}
-			break;
-		default:
-			COMMON_LOG_ERROR_F("Invalid parsing state: %d", state);
-			throw Exception("Internal error while parsing conditional");
-		}
+	// each AND jumps to the end as soon as a factor is false
+	std::vector<size_t> jumps;
+	while (pos < end && lexer.isKeyword(pos, WQL_AND))
+	{
+		pos++;
+		jumps.push_back(emit(WQLOP_JUMPIFFALSE));
+		parseFactor(lexer, pos, end);
 	}
-
-	// Validate that the input string was valid/complete
-	if (openQuotes)
+	for (size_t i = 0; i < jumps.size(); i++)
 	{
-		COMMON_LOG_ERROR_F("unmatched quotes: %s", quoteType.c_str());
-		throw ExceptionInvalidWqlQuery(ExceptionInvalidWqlQuery::REASON_UNMATCHEDQUOTES);
+		m_program[jumps[i]].operand = (UINT32)m_program.size();
 	}
+}
 
-	if (depth != 0)
+/*
+ * factor := NOT factor | ( conditional ) | comparison
+ */
+void WqlConditional::parseFactor(const WqlLexer &lexer, size_t &pos, const size_t end)
+	throw (Exception)
+{
+	requireToken(pos, end);
+	if (lexer.isKeyword(pos, WQL_NOT))
 	{
-		COMMON_LOG_ERROR_F("unmatched parentheses: %d", depth);
-		throw ExceptionInvalidWqlQuery(ExceptionInvalidWqlQuery::REASON_UNMATCHEDPARENS);
+		pos++;
+		m_isConjunction = false;
+		parseFactor(lexer, pos, end);
+		emit(WQLOP_NOT);
 	}
-
-	if (state != STATE_DONE)
+	else if (lexer.isType(pos, WQLTOKEN_OPENPAREN))
 	{
-		COMMON_LOG_ERROR_F("ended in the wrong state: %d", state);
-		throw ExceptionInvalidWqlQuery(ExceptionInvalidWqlQuery::REASON_BADLYFORMED);
+		pos++;
+		parseConditional(lexer, pos, end);
+		if (pos >= end || !lexer.isType(pos, WQLTOKEN_CLOSEPAREN))
+		{
+			COMMON_LOG_ERROR("unmatched opening parenthesis");
+			throw ExceptionInvalidWqlQuery(ExceptionInvalidWqlQuery::REASON_UNMATCHEDPARENS);
+		}
+		pos++;
+	}
+	else
+	{
+		parseComparison(lexer, pos, end);
 	}
 }
 
 /*
- * Break apart whitespace-delimited token into all meaningful conditional clause tokens
+ * comparison := attribute operator value | attribute [NOT] LIKE string | attribute ISA class
  */
-std::vector<std::string> WqlConditional::dissectConditionalToken(const std::string& token, bool &openQuotes, char &quoteType)
+void WqlConditional::parseComparison(const WqlLexer &lexer, size_t &pos, const size_t end)
+	throw (Exception)
 {
-	Trace logging(__FILE__, __FUNCTION__, __LINE__);
-	std::vector<std::string> newTokens;
+	struct WqlComparisonClause clause;
 
-	if (!token.empty())
+	requireToken(pos, end);
+	clause.attributeName = lexer.getText(pos);
+	if (!lexer.isType(pos++, WQLTOKEN_WORD) || !WqlQuery::isValidCimName(clause.attributeName))
 	{
-		// walk through string and build up substrings
-		std::string substring;
-		size_t step = 1;
-		bool prevSpecial = false;
-		for (size_t i = 0; i < token.size(); i += step)
-		{
-			bool foundSubstrStart = false;
-			char current = token[i];
-			char next = ((i + 1) == token.size()) ?
-					'\0' :
-					token[i + 1];
+		COMMON_LOG_ERROR_F("expected valid attribute name, got: %s",
+				clause.attributeName.c_str());
+		throw ExceptionInvalidWqlQuery(ExceptionInvalidWqlQuery::REASON_BADATTR,
+				clause.attributeName);
+	}
 
-			// ignore most characters inside quotes
-			if (openQuotes)
-			{
-				if (prevSpecial) // beginning of the string inside quotes
-				{
-					foundSubstrStart = true;
-					prevSpecial = false;
-				}
+	bool negate = false;
+	requireToken(pos, end);
+	size_t opPos = pos++;
+	if (lexer.isOperator(opPos, WQL_EQ))
+	{
+		clause.op = OP_EQ;
+	}
+	else if (lexer.isOperator(opPos, WQL_GT))
+	{
+		clause.op = OP_GT;
+	}
+	else if (lexer.isOperator(opPos, WQL_LT))
+	{
+		clause.op = OP_LT;
+	}
+	else if (lexer.isOperator(opPos, WQL_GE))
+	{
+		clause.op = OP_GE;
+	}
+	else if (lexer.isOperator(opPos, WQL_LE))
+	{
+		clause.op = OP_LE;
+	}
+	else if (lexer.isOperator(opPos, WQL_NE1) || lexer.isOperator(opPos, WQL_NE2))
+	{
+		clause.op = OP_NE;
+	}
+	else if (lexer.isKeyword(opPos, WQL_LIKE))
+	{
+		clause.op = OP_LIKE;
+	}
+	else if (lexer.isKeyword(opPos, WQL_NOT) && pos < end && lexer.isKeyword(pos, WQL_LIKE))
+	{
+		pos++;
+		clause.op = OP_LIKE;
+		negate = true;
+	}
+	else if (lexer.isKeyword(opPos, WQL_ISA))
+	{
+		clause.op = OP_ISA;
+	}
+	else
+	{
+		std::string op = lexer.getText(opPos);
+		COMMON_LOG_ERROR_F("expected operator token, got: %s", op.c_str());
+		throw ExceptionInvalidWqlQuery(ExceptionInvalidWqlQuery::REASON_BADOPERATOR, op);
+	}
 
-				step = 1;
+	requireToken(pos, end);
+	size_t valuePos = pos;
+	if (clause.op == OP_ISA && lexer.isType(pos, WQLTOKEN_WORD) &&
+			WqlQuery::isValidCimClassName(lexer.getText(pos)))
+	{
+		// the class may be given without quotes
+		clause.value = Attribute(lexer.getText(pos), false);
+		pos++;
+	}
+	else
+	{
+		clause.value = parseValue(lexer, pos, end,
+				clause.op == OP_LIKE || clause.op == OP_ISA);
+	}
 
-				if (current == '\\') // escape next char
-				{
-					i++; // exclude the escape and save the next char without inspection
-				}
-				else if (current == quoteType) // closing quote mark
-				{
-					openQuotes = false;
-					foundSubstrStart = true;
-					prevSpecial = true;
-				}
-			}
-			else // not inside quotes - process special characters
-			{
-				switch (current)
-				{
-				case '"':
-				case '\'':
-					openQuotes = true;
-					quoteType = current;
-					// quotes are a single character token
-				case ')':
-				case '(':
-				case '=':
-					// single-character tokens
-					foundSubstrStart = true;
-					prevSpecial = true;
-					step = 1;
-					break;
-				case '<': // could be < or <= or <>
-					if (next == '>') // Not equal (<>)
-					{
-						foundSubstrStart = true;
-						prevSpecial = true;
-						step = 2;
-						break;
-					}
-					// otherwise drop through to same checks as GT/GE
-				case '>': // could be > or >=
-					foundSubstrStart = true;
-					prevSpecial = true;
-					if (next == '=') // >= or <=
-					{
-						step = 2;
-					}
-					else // > or <
-					{
-						step = 1;
-					}
-					break;
-				case '!': // might be !=
-					if (next == '=')
-					{
-						foundSubstrStart = true;
-						prevSpecial = true;
-						step = 2;
-					}
-					break;
-				default: // not a special character
-					step = 1;
-					if (prevSpecial) // but previous char was special
-					{
-						foundSubstrStart = true;
-						prevSpecial = false;
-					}
-					break;
-				}
-			}
+	if ((clause.op == OP_LIKE || clause.op == OP_ISA) && clause.value.getType() != STR_T)
+	{
+		std::string op = lexer.getText(opPos);
+		COMMON_LOG_ERROR_F("expected a string for %s", op.c_str());
+		throw ExceptionInvalidWqlQuery(ExceptionInvalidWqlQuery::REASON_BADVALUE,
+				lexer.getText(valuePos));
+	}
 
-			// started a new substring, store away the old one
-			if ((i > 0) && foundSubstrStart)
-			{
-				newTokens.push_back(substring);
-				substring.clear();
-			}
+	emit(WQLOP_TEST, m_conditions.size());
+	m_conditions.push_back(clause);
+	if (negate)
+	{
+		m_isConjunction = false;
+		emit(WQLOP_NOT);
+	}
+}
 
-			substring += token.substr(i, step);
-		}
+/*
+ * Parse a quoted string, a number or a boolean. The lexer has already told them apart.
+ */
+Attribute WqlConditional::parseValue(const WqlLexer &lexer, size_t &pos, const size_t end,
+		const bool plainString) throw (Exception)
+{
+	Attribute value;
+	requireToken(pos, end);
+	const struct WqlToken &token = lexer[pos];
+	if (token.type == WQLTOKEN_DATETIME && !plainString)
+	{
+		value = Attribute(token.value, DATETIME_SUBTYPE_DATETIME, false);
+	}
+	else if (token.type == WQLTOKEN_STRING || token.type == WQLTOKEN_DATETIME)
+	{
+		value = Attribute(lexer.getString(pos), false);
+	}
+	else if (token.type == WQLTOKEN_NUMBER)
+	{
+		value = Attribute(token.value, false);
+	}
+	else if (token.type == WQLTOKEN_SIGNED)
+	{
+		value = Attribute(token.signedValue, false);
+	}
+	else if (token.type == WQLTOKEN_REAL)
+	{
+		value = Attribute((REAL32)token.realValue, false);
+	}
+	// try boolean
+	else if (lexer.isKeyword(pos, WQL_TRUE))
+	{
+		value = Attribute(true, false);
+	}
+	else if (lexer.isKeyword(pos, WQL_FALSE))
+	{
+		value = Attribute(false, false);
+	}
+	// can't recognize it
+	else
+	{
+		std::string text = lexer.getText(pos);
+		COMMON_LOG_ERROR_F("couldn't decipher the type of token: %s", text.c_str());
+		throw ExceptionInvalidWqlQuery(ExceptionInvalidWqlQuery::REASON_BADVALUE, text);
+	}
+	pos++;
+	return value;
+}
 
-		// final substring
-		newTokens.push_back(substring);
+void WqlConditional::requireToken(const size_t pos, const size_t end) throw (Exception)
+{
+	if (pos >= end)
+	{
+		COMMON_LOG_ERROR("conditional ended early");
+		throw ExceptionInvalidWqlQuery(ExceptionInvalidWqlQuery::REASON_BADLYFORMED);
 	}
+}
 
-	return newTokens;
+size_t WqlConditional::emit(const enum WqlOpcode opcode, const size_t operand)
+{
+	struct WqlInstruction instruction;
+	instruction.opcode = opcode;
+	instruction.operand = (UINT32)operand;
+	m_program.push_back(instruction);
+	return m_program.size() - 1;
 }
 
 } /* namespace framework */
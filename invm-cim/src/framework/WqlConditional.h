@@ -37,6 +37,7 @@
 
 #include "Attribute.h"
 #include "Exception.h"
+#include "WqlLexer.h"
 
 namespace wbem
 {
@@ -47,6 +48,9 @@ namespace framework
  */
 const std::string WQL_AND = "AND";
 const std::string WQL_OR = "OR";
+const std::string WQL_NOT = "NOT";
+const std::string WQL_LIKE = "LIKE";
+const std::string WQL_ISA = "ISA";
 const std::string WQL_EQ = "=";
 const std::string WQL_GT = ">";
 const std::string WQL_LT = "<";
@@ -71,7 +75,31 @@ enum ComparisonOperator
 	OP_LT, //!< less than
 	OP_GE, //!< greater than or equal
 	OP_LE, //!< less than or equal
-	OP_NE //!< not equal
+	OP_NE, //!< not equal
+	OP_LIKE, //!< matches a LIKE pattern
+	OP_ISA //!< references an instance of a class
+};
+
+/*!
+ * Instructions of a compiled conditional. A program works on a single boolean register,
+ * which is true when the program ends if the conditional is satisfied. AND and OR are
+ * compiled to jumps that skip the rest of the operation once its result is known.
+ */
+enum WqlOpcode
+{
+	WQLOP_TEST, //!< set the register to the result of the comparison clause at operand
+	WQLOP_NOT, //!< negate the register
+	WQLOP_JUMPIFFALSE, //!< continue at the instruction at operand if the register is false
+	WQLOP_JUMPIFTRUE //!< continue at the instruction at operand if the register is true
+};
+
+/*!
+ * One instruction of a compiled conditional
+ */
+struct WqlInstruction
+{
+	enum WqlOpcode opcode;
+	UINT32 operand; //!< index of a comparison clause or an instruction
 };
 
 /*!
@@ -85,18 +113,26 @@ struct WqlComparisonClause
 };
 
 /*!
- * Represents a conditional expression in a WQL query.
- * @remark for now, we do not deal with the OR operators.
+ * Represents a conditional expression in a WQL query, compiled to a program over its
+ * comparison clauses.
+ * @remark The grammar, from lowest to highest precedence:
+ * 		conditional := term { OR term }
+ * 		term := factor { AND factor }
+ * 		factor := NOT factor | ( conditional ) | comparison
+ * 		comparison := attribute operator value | attribute [NOT] LIKE string |
+ * 			attribute ISA class
  */
 class INVM_CIM_API WqlConditional
 {
 	public:
 		/*!
 		 * Constructor.
-		 * @param tokens - list of tokens
+		 * @param lexer - tokens of the query holding the conditional
+		 * @param first - index of the first token of the conditional
+		 * @param end - index after the last token of the conditional
 		 * @throw NvmException - if the expression is invalid
 		 */
-		WqlConditional(const std::vector<std::string> &tokens)
+		WqlConditional(const WqlLexer &lexer, const size_t first, const size_t end)
 			throw (Exception);
 
 		/*!
@@ -128,16 +164,16 @@ class INVM_CIM_API WqlConditional
 		{ return m_conditions; }
 
 		/*!
-		 * Break apart whitespace-delimited token into tokens meaningful for conditional.
-		 * A whitespace-delimited token may contain multiple conditional tokens not
-		 * separated by whitespace.
-		 * @param token - whitespace-delimited token
-		 * @param openQuotes - boolean reference to track open quotes
-		 * @param quoteType - type of quote mark to match if quotes are open
-		 * @return vector of separated conditional tokens
+		 * Returns the compiled program. It is empty if there are no clauses.
 		 */
-		static std::vector<std::string> dissectConditionalToken(
-				const std::string& token, bool &openQuotes, char &quoteType);
+		const std::vector<struct WqlInstruction> &getProgram() const
+		{ return m_program; }
+
+		/*!
+		 * Returns true if the comparison clauses are only connected by AND, so every one
+		 * of them must hold for the conditional to hold.
+		 */
+		bool isConjunction() const { return m_isConjunction; }
 
 		/*!
 		 * Fetch a string representation of the conditional.
@@ -145,17 +181,50 @@ class INVM_CIM_API WqlConditional
 		std::string getString() const { return m_str; }
 
 	protected:
-		//!< These are assumed to be connected by AND operators
+		//!< in the order they appear in the conditional
 		std::vector<struct WqlComparisonClause> m_conditions;
+		std::vector<struct WqlInstruction> m_program; //!< connects the comparison clauses
+		bool m_isConjunction; //!< the program is only clauses connected by AND
 		std::string m_str; //!< full conditional string
 
 		/*
 		 * Initialize the internal comparison clause
-		 * @param tokens - list of tokens
+		 * @param lexer - tokens of the query
+		 * @param first, end - range of the tokens of the conditional
 		 * @throw NvmException - if the tokens are invalid
 		 */
-		void initFromTokens(const std::vector<std::string> &tokens)
+		void initFromTokens(const WqlLexer &lexer, const size_t first, const size_t end)
 			throw (Exception);
+
+		/*
+		 * Compile the productions of the grammar, starting at the token at pos and leaving
+		 * pos after the last token used. Tokens from end on aren't part of the conditional.
+		 */
+		void parseConditional(const WqlLexer &lexer, size_t &pos, const size_t end)
+			throw (Exception);
+		void parseTerm(const WqlLexer &lexer, size_t &pos, const size_t end)
+			throw (Exception);
+		void parseFactor(const WqlLexer &lexer, size_t &pos, const size_t end)
+			throw (Exception);
+		void parseComparison(const WqlLexer &lexer, size_t &pos, const size_t end)
+			throw (Exception);
+
+		/*
+		 * Parse a value: a quoted string, a number or a boolean. Unless plainString is
+		 * set, a string that holds a datetime becomes a datetime.
+		 */
+		static Attribute parseValue(const WqlLexer &lexer, size_t &pos, const size_t end,
+				const bool plainString) throw (Exception);
+
+		/*
+		 * Throws if the conditional ended before pos
+		 */
+		static void requireToken(const size_t pos, const size_t end) throw (Exception);
+
+		/*
+		 * Append an instruction and return its index
+		 */
+		size_t emit(const enum WqlOpcode opcode, const size_t operand = 0);
 };
 
 } /* namespace framework */
@@ -0,0 +1,474 @@
+/*
+ * Copyright (c) 2015 2016, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of Intel Corporation nor the names of its contributors
+ *     may be used to endorse or promote products derived from this software
+ *     without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * This file contains a class to execute a WQL query over a set of instances.
+ */
+
+#include <algorithm>
+#include <logger/logging.h>
+#include "InstanceFactory.h"
+#include "RequestContext.h"
+#include "WqlEvaluator.h"
+
+namespace wbem
+{
+namespace framework
+{
+
+WqlEvaluator::WqlEvaluator(const WqlQuery &query) :
+		m_className(query.getClassName()),
+		m_selectedAttributes(query.getSelectedAttributes()),
+		m_predicate(query.getConditional()),
+		m_aggregates(query.getAggregates()),
+		m_orderBy(query.getOrderBy()),
+		m_limit(query.getLimit()),
+		m_offset(query.getOffset())
+{
+}
+
+attribute_names_t WqlEvaluator::getFetchAttributes() const
+{
+	attribute_names_t attributes;
+	if (!m_selectedAttributes.empty() || !m_aggregates.empty())
+	{
+		attribute_names_t needed = m_predicate.getAttributeNames();
+		for (size_t i = 0; i < m_orderBy.size(); i++)
+		{
+			needed.push_back(m_orderBy[i].attributeName);
+		}
+		for (size_t i = 0; i < m_aggregates.size(); i++)
+		{
+			if (!m_aggregates[i].attributeName.empty())
+			{
+				needed.push_back(m_aggregates[i].attributeName);
+			}
+		}
+
+		attributes = m_selectedAttributes;
+		for (size_t i = 0; i < needed.size(); i++)
+		{
+			if (!InstanceFactory::containsAttribute(needed[i], attributes))
+			{
+				attributes.push_back(needed[i]);
+			}
+		}
+	}
+	return attributes;
+}
+
+bool WqlEvaluator::isCountOnly() const
+{
+	bool countOnly = m_predicate.isEmpty() && !m_aggregates.empty();
+	for (size_t i = 0; i < m_aggregates.size() && countOnly; i++)
+	{
+		countOnly = m_aggregates[i].function == WQLAGGREGATE_COUNT &&
+				m_aggregates[i].attributeName.empty();
+	}
+	return countOnly;
+}
+
+Instance WqlEvaluator::project(const Instance &instance) const
+{
+	if (m_selectedAttributes.empty())
+	{
+		return instance;
+	}
+
+	// the object path brings the keys along
+	ObjectPath path = instance.getObjectPath();
+	Instance projection(path);
+	for (size_t i = 0; i < m_selectedAttributes.size(); i++)
+	{
+		Attribute attribute;
+		std::string name = m_selectedAttributes[i];
+		if (instance.getAttributeI(name, attribute) == SUCCESS)
+		{
+			projection.setAttribute(name, attribute);
+		}
+	}
+	return projection;
+}
+
+void WqlEvaluator::evaluate(const instances_t &instances, instances_t &results) const
+{
+	LogEnterExit logging(__FILE__, __FUNCTION__, __LINE__);
+
+	// the rows up to the end of the limit, or every row
+	UINT64 needed = m_offset + m_limit;
+	if (m_limit == WQL_NO_LIMIT || needed < m_limit)
+	{
+		needed = WQL_NO_LIMIT;
+	}
+
+	// without sorting or aggregates, matching can stop once the limit is reached
+	bool streaming = m_orderBy.empty() && m_aggregates.empty();
+	std::vector<size_t> rows; // indexes of the matching instances
+	selection_bitmap_t selection;
+	for (size_t first = 0; first < instances.size() && !RequestContext::stopRequested() &&
+			!(streaming && rows.size() >= needed); first += WQL_BATCH_ROWS)
+	{
+		size_t count = std::min<size_t>(WQL_BATCH_ROWS, instances.size() - first);
+		m_predicate.select(instances, first, count, selection);
+		for (size_t row = 0; row < count; row++)
+		{
+			if (WqlBatchPredicate::isSelected(selection, row))
+			{
+				rows.push_back(first + row);
+			}
+		}
+	}
+	COMMON_LOG_DEBUG_F("%u of %u instances matched", (unsigned int)rows.size(),
+			(unsigned int)instances.size());
+
+	if (!m_aggregates.empty())
+	{
+		// a single row, unless the OFFSET skips it or the LIMIT is 0
+		if (m_offset == 0 && m_limit > 0)
+		{
+			results.push_back(aggregate(instances, rows));
+		}
+	}
+	else
+	{
+		size_t count = needed < rows.size() ? (size_t)needed : rows.size();
+		if (!m_orderBy.empty())
+		{
+			order(instances, rows, count);
+		}
+		for (UINT64 i = m_offset; i < count; i++)
+		{
+			results.push_back(project(instances[rows[i]]));
+		}
+	}
+}
+
+void WqlEvaluator::order(const instances_t &instances, std::vector<size_t> &rows,
+		const size_t count) const
+{
+	// look up the sort attributes of each row once
+	const size_t keys = m_orderBy.size();
+	std::vector<const Attribute *> values(rows.size() * keys);
+	for (size_t row = 0; row < rows.size(); row++)
+	{
+		for (size_t key = 0; key < keys; key++)
+		{
+			values[row * keys + key] =
+					instances[rows[row]].findAttribute(m_orderBy[key].attributeName);
+		}
+	}
+
+	// orders positions in rows; ties keep the original order
+	const std::vector<struct WqlOrderBy> &orderBy = m_orderBy;
+	auto before = [&values, &orderBy, keys](const size_t lhs, const size_t rhs) -> bool
+	{
+		for (size_t key = 0; key < keys; key++)
+		{
+			const Attribute *pLhs = values[lhs * keys + key];
+			const Attribute *pRhs = values[rhs * keys + key];
+			int result = compareAttributes(pLhs, pRhs);
+			if (result != 0)
+			{
+				// missing values stay last either way
+				return (orderBy[key].descending && pLhs && pRhs) ? result > 0 : result < 0;
+			}
+		}
+		return lhs < rhs;
+	};
+
+	std::vector<size_t> positions;
+	if (count < rows.size())
+	{
+		// a heap of the first count rows, with the last of them at the front
+		positions.reserve(count);
+		for (size_t position = 0; position < rows.size() && count > 0; position++)
+		{
+			if (positions.size() < count)
+			{
+				positions.push_back(position);
+				std::push_heap(positions.begin(), positions.end(), before);
+			}
+			else if (before(position, positions.front()))
+			{
+				std::pop_heap(positions.begin(), positions.end(), before);
+				positions.back() = position;
+				std::push_heap(positions.begin(), positions.end(), before);
+			}
+		}
+		std::sort_heap(positions.begin(), positions.end(), before);
+	}
+	else
+	{
+		for (size_t position = 0; position < rows.size(); position++)
+		{
+			positions.push_back(position);
+		}
+		std::sort(positions.begin(), positions.end(), before);
+	}
+
+	std::vector<size_t> sorted;
+	sorted.reserve(positions.size());
+	for (size_t i = 0; i < positions.size(); i++)
+	{
+		sorted.push_back(rows[positions[i]]);
+	}
+	rows.swap(sorted);
+}
+
+Instance WqlEvaluator::aggregate(const instances_t &instances,
+		const std::vector<size_t> &rows) const
+{
+	// the row doesn't stand for any one instance, so its path has no keys
+	std::string host;
+	std::string cimNamespace;
+	if (!rows.empty())
+	{
+		host = instances[rows[0]].getHost();
+		cimNamespace = instances[rows[0]].getNamespace();
+	}
+	ObjectPath path(host, cimNamespace, m_className, attributes_t());
+	Instance result(path);
+
+	for (size_t i = 0; i < m_aggregates.size(); i++)
+	{
+		const struct WqlAggregate &aggregate = m_aggregates[i];
+		switch (aggregate.function)
+		{
+			case WQLAGGREGATE_COUNT:
+			{
+				UINT64 count = aggregate.attributeName.empty() ? rows.size() : 0;
+				for (size_t row = 0; row < rows.size() && !aggregate.attributeName.empty(); row++)
+				{
+					if (instances[rows[row]].findAttribute(aggregate.attributeName))
+					{
+						count++;
+					}
+				}
+				result.setAttribute(aggregate.resultName, Attribute(count, false));
+				break;
+			}
+			case WQLAGGREGATE_MIN:
+			case WQLAGGREGATE_MAX:
+			{
+				const Attribute *pBest = NULL;
+				for (size_t row = 0; row < rows.size(); row++)
+				{
+					const Attribute *pValue =
+							instances[rows[row]].findAttribute(aggregate.attributeName);
+					int order = pValue && pBest ? compareAttributes(pValue, pBest) : 0;
+					if (pValue && (!pBest ||
+							(aggregate.function == WQLAGGREGATE_MIN ? order < 0 : order > 0)))
+					{
+						pBest = pValue;
+					}
+				}
+				// no values, no result, as in SQL
+				if (pBest)
+				{
+					Attribute value(*pBest);
+					value.setIsKey(false);
+					result.setAttribute(aggregate.resultName, value);
+				}
+				break;
+			}
+			case WQLAGGREGATE_SUM:
+			{
+				// the type of the sum is the widest type summed
+				UINT64 uintSum = 0;
+				SINT64 sintSum = 0;
+				double realSum = 0;
+				bool found = false;
+				bool isSigned = false;
+				bool isReal = false;
+				for (size_t row = 0; row < rows.size(); row++)
+				{
+					const Attribute *pValue =
+							instances[rows[row]].findAttribute(aggregate.attributeName);
+					switch (pValue ? pValue->getType() : STR_T)
+					{
+						case UINT8_T:
+						case UINT16_T:
+						case UINT32_T:
+						case UINT64_T:
+							uintSum += pValue->uint64Value();
+							sintSum += (SINT64)pValue->uint64Value();
+							realSum += (double)pValue->uint64Value();
+							found = true;
+							break;
+						case SINT8_T:
+						case SINT16_T:
+						case SINT32_T:
+						case SINT64_T:
+							sintSum += pValue->sint64Value();
+							realSum += (double)pValue->sint64Value();
+							found = isSigned = true;
+							break;
+						case REAL32_T:
+							realSum += (double)pValue->real32Value();
+							found = isReal = true;
+							break;
+						default:
+							// not a number
+							break;
+					}
+				}
+				if (isReal)
+				{
+					result.setAttribute(aggregate.resultName, Attribute((REAL32)realSum, false));
+				}
+				else if (isSigned)
+				{
+					result.setAttribute(aggregate.resultName, Attribute(sintSum, false));
+				}
+				else if (found)
+				{
+					result.setAttribute(aggregate.resultName, Attribute(uintSum, false));
+				}
+				break;
+			}
+		}
+	}
+	return result;
+}
+
+/*
+ * The kinds of value attributes are ordered by, in the order the kinds sort in
+ */
+enum orderKind
+{
+	ORDERKIND_UNSIGNED,
+	ORDERKIND_SIGNED,
+	ORDERKIND_REAL,
+	ORDERKIND_STRING,
+	ORDERKIND_OTHER
+};
+
+static enum orderKind getOrderKind(const Attribute &attribute)
+{
+	enum orderKind kind = ORDERKIND_OTHER;
+	switch (attribute.getType())
+	{
+		case BOOLEAN_T:
+		case UINT8_T:
+		case UINT16_T:
+		case UINT32_T:
+		case UINT64_T:
+		case ENUM_T:
+		case ENUM16_T:
+		case DATETIME_T:
+		case DATETIME_INTERVAL_T:
+			kind = ORDERKIND_UNSIGNED;
+			break;
+		case SINT8_T:
+		case SINT16_T:
+		case SINT32_T:
+		case SINT64_T:
+			kind = ORDERKIND_SIGNED;
+			break;
+		case REAL32_T:
+			kind = ORDERKIND_REAL;
+			break;
+		case STR_T:
+			kind = ORDERKIND_STRING;
+			break;
+		default:
+			break;
+	}
+	return kind;
+}
+
+static double getRealValue(const Attribute &attribute, const enum orderKind kind)
+{
+	return kind == ORDERKIND_REAL ? (double)attribute.real32Value() :
+			(kind == ORDERKIND_SIGNED ? (double)attribute.sint64Value() :
+			(double)attribute.uint64Value());
+}
+
+/*
+ * Three-way comparison of two values of the same type
+ */
+template <typename T>
+static int compareValues(const T &lhs, const T &rhs)
+{
+	return lhs < rhs ? -1 : (rhs < lhs ? 1 : 0);
+}
+
+int WqlEvaluator::compareAttributes(const Attribute *pLhs, const Attribute *pRhs)
+{
+	if (!pLhs || !pRhs)
+	{
+		return (pLhs ? 0 : 1) - (pRhs ? 0 : 1);
+	}
+
+	enum orderKind lhsKind = getOrderKind(*pLhs);
+	enum orderKind rhsKind = getOrderKind(*pRhs);
+	bool lhsNumber = lhsKind <= ORDERKIND_REAL;
+	bool rhsNumber = rhsKind <= ORDERKIND_REAL;
+	int result = 0;
+	if (lhsNumber && rhsNumber)
+	{
+		if (lhsKind == ORDERKIND_REAL || rhsKind == ORDERKIND_REAL)
+		{
+			result = compareValues(getRealValue(*pLhs, lhsKind), getRealValue(*pRhs, rhsKind));
+		}
+		else if (lhsKind == ORDERKIND_UNSIGNED && rhsKind == ORDERKIND_UNSIGNED)
+		{
+			result = compareValues(pLhs->uint64Value(), pRhs->uint64Value());
+		}
+		else if (lhsKind == ORDERKIND_SIGNED && rhsKind == ORDERKIND_SIGNED)
+		{
+			result = compareValues(pLhs->sint64Value(), pRhs->sint64Value());
+		}
+		else if (lhsKind == ORDERKIND_SIGNED)
+		{
+			// a negative number is below any unsigned one
+			SINT64 value = pLhs->sint64Value();
+			result = value < 0 ? -1 : compareValues((UINT64)value, pRhs->uint64Value());
+		}
+		else
+		{
+			SINT64 value = pRhs->sint64Value();
+			result = value < 0 ? 1 : compareValues(pLhs->uint64Value(), (UINT64)value);
+		}
+	}
+	else if (lhsNumber != rhsNumber || lhsKind != rhsKind)
+	{
+		result = compareValues((int)lhsKind, (int)rhsKind);
+	}
+	else if (lhsKind == ORDERKIND_STRING)
+	{
+		result = pLhs->stringRef().compare(pRhs->stringRef());
+	}
+	else
+	{
+		result = pLhs->asStr().compare(pRhs->asStr());
+	}
+	return result;
+}
+
+} /* namespace framework */
+} /* namespace wbem */
@@ -0,0 +1,135 @@
+/*
+ * Copyright (c) 2015 2016, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of Intel Corporation nor the names of its contributors
+ *     may be used to endorse or promote products derived from this software
+ *     without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * This file contains a class to execute a WQL query over a set of instances.
+ */
+
+#ifndef WQLEVALUATOR_H_
+#define WQLEVALUATOR_H_
+
+#include <string>
+#include <vector>
+
+#include "Instance.h"
+#include "WqlBatchPredicate.h"
+#include "WqlQuery.h"
+
+namespace wbem
+{
+namespace framework
+{
+
+/*!
+ * A WQL query compiled for execution: the instances of the class that satisfy the
+ * conditional, with only the selected attributes (and the keys) kept, sorted and limited.
+ * An aggregate query gives a single row holding an attribute per aggregate.
+ * @remarks Sorting with a LIMIT keeps a bounded heap of the first OFFSET + LIMIT rows
+ * instead of sorting every match. Instances without a sort attribute come last. Ties keep
+ * the order the instances were given in.
+ */
+class INVM_CIM_API WqlEvaluator
+{
+	public:
+		/*!
+		 * Compile a query.
+		 * @param query - the parsed query
+		 */
+		WqlEvaluator(const WqlQuery &query);
+
+		/*!
+		 * Get the class the query is for.
+		 */
+		const std::string &getClassName() const { return m_className; }
+
+		/*!
+		 * Get the compiled conditional.
+		 */
+		const WqlPredicate &getPredicate() const { return m_predicate; }
+
+		/*!
+		 * Get the attributes an instance needs for the query: the selected attributes and
+		 * the ones the conditional compares. Empty means all attributes.
+		 */
+		attribute_names_t getFetchAttributes() const;
+
+		/*!
+		 * Returns true if the instance satisfies the conditional.
+		 */
+		bool matches(const Instance &instance) const { return m_predicate.matches(instance); }
+
+		/*!
+		 * Returns true if the query only counts every instance, so the instance names are
+		 * enough to answer it.
+		 */
+		bool isCountOnly() const;
+
+		/*!
+		 * Get a copy of the instance with only its keys and the selected attributes.
+		 */
+		Instance project(const Instance &instance) const;
+
+		/*!
+		 * Add the results of the query over the instances to results: the projection of
+		 * each instance that satisfies the conditional, in order and limited, or the row of
+		 * aggregates. The instances are evaluated in batches of WQL_BATCH_ROWS. Stops early
+		 * if the current request is told to stop.
+		 */
+		void evaluate(const instances_t &instances, instances_t &results) const;
+
+	protected:
+		std::string m_className;
+		attribute_names_t m_selectedAttributes; //!< empty means all attributes
+		WqlBatchPredicate m_predicate;
+		std::vector<struct WqlAggregate> m_aggregates;
+		std::vector<struct WqlOrderBy> m_orderBy;
+		UINT64 m_limit;
+		UINT64 m_offset;
+
+		/*
+		 * Sort the rows (indexes into instances) by the ORDER BY attributes, keeping only
+		 * the first count
+		 */
+		void order(const instances_t &instances, std::vector<size_t> &rows,
+				const size_t count) const;
+
+		/*
+		 * Build the row of aggregates over the rows (indexes into instances)
+		 */
+		Instance aggregate(const instances_t &instances, const std::vector<size_t> &rows) const;
+
+		/*
+		 * Order two attribute values: <0, 0 or >0. Numbers compare by value, whatever
+		 * their types, strings compare case-sensitively and a missing value comes last.
+		 */
+		static int compareAttributes(const Attribute *pLhs, const Attribute *pRhs);
+};
+
+} /* namespace framework */
+} /* namespace wbem */
+
+#endif /* WQLEVALUATOR_H_ */
@@ -0,0 +1,288 @@
+/*
+ * Copyright (c) 2015 2016, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of Intel Corporation nor the names of its contributors
+ *     may be used to endorse or promote products derived from this software
+ *     without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * This file contains a class to split WQL strings into typed tokens.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <cerrno>
+#include <string/s_str.h>
+#include <logger/logging.h>
+#include <time/time_utilities.h>
+#include "ExceptionInvalidWqlQuery.h"
+#include "WqlLexer.h"
+
+namespace wbem
+{
+namespace framework
+{
+
+/*
+ * Characters that end a word
+ */
+static bool isDelimiter(const char c)
+{
+	return isspace((unsigned char)c) || (strchr("\"'(),*=<>", c) != NULL);
+}
+
+WqlLexer::WqlLexer(const std::string &text) throw (Exception) :
+		m_text(text)
+{
+	Trace logging(__FILE__, __FUNCTION__, __LINE__);
+
+	size_t pos = 0;
+	while (pos < m_text.size())
+	{
+		char current = m_text[pos];
+		char next = (pos + 1 < m_text.size()) ? m_text[pos + 1] : '\0';
+		switch (current)
+		{
+		case '"':
+		case '\'':
+			pos = scanString(pos);
+			break;
+		case '(':
+			addToken(WQLTOKEN_OPENPAREN, pos++, 1);
+			break;
+		case ')':
+			addToken(WQLTOKEN_CLOSEPAREN, pos++, 1);
+			break;
+		case ',':
+			addToken(WQLTOKEN_COMMA, pos++, 1);
+			break;
+		case '*':
+			addToken(WQLTOKEN_STAR, pos++, 1);
+			break;
+		case '=':
+			addToken(WQLTOKEN_OPERATOR, pos++, 1);
+			break;
+		case '<': // could be < or <= or <>
+		case '>': // could be > or >=
+			if (next == '=' || (current == '<' && next == '>'))
+			{
+				addToken(WQLTOKEN_OPERATOR, pos, 2);
+				pos += 2;
+			}
+			else
+			{
+				addToken(WQLTOKEN_OPERATOR, pos++, 1);
+			}
+			break;
+		case '!': // might be !=
+			if (next == '=')
+			{
+				addToken(WQLTOKEN_OPERATOR, pos, 2);
+				pos += 2;
+			}
+			else
+			{
+				pos = scanWord(pos);
+			}
+			break;
+		default:
+			if (isspace((unsigned char)current))
+			{
+				pos++;
+			}
+			else
+			{
+				pos = scanWord(pos);
+			}
+			break;
+		}
+	}
+}
+
+void WqlLexer::addToken(const enum WqlTokenType type, const size_t start, const size_t length)
+{
+	struct WqlToken token;
+	token.type = type;
+	token.start = start;
+	token.length = length;
+	token.value = 0;
+	token.signedValue = 0;
+	token.realValue = 0;
+	token.escaped = false;
+	m_tokens.push_back(token);
+}
+
+size_t WqlLexer::scanString(const size_t start) throw (Exception)
+{
+	const char quote = m_text[start];
+	bool escaped = false;
+	size_t pos = start + 1;
+	while (pos < m_text.size() && m_text[pos] != quote)
+	{
+		if (m_text[pos] == '\\') // the next character is part of the string
+		{
+			escaped = true;
+			pos++;
+		}
+		pos++;
+	}
+	if (pos >= m_text.size())
+	{
+		COMMON_LOG_ERROR_F("unmatched quotes: %c", quote);
+		throw ExceptionInvalidWqlQuery(ExceptionInvalidWqlQuery::REASON_UNMATCHEDQUOTES);
+	}
+	pos++; // closing quote mark
+
+	addToken(WQLTOKEN_STRING, start, pos - start);
+	struct WqlToken &token = m_tokens.back();
+	token.escaped = escaped;
+
+	// only a string of exactly the right length can be a datetime
+	size_t contentLength = token.length - 2;
+	if (!escaped && contentLength == COMMON_DATETIME_LEN - 1)
+	{
+		COMMON_DATETIME_STR datetime;
+		memcpy(datetime, m_text.c_str() + start + 1, contentLength);
+		datetime[contentLength] = '\0';
+		unsigned long long seconds = 0;
+		if (convert_datetime_string_to_seconds(datetime, &seconds) == DATETIME_TYPE_DATETIME)
+		{
+			token.type = WQLTOKEN_DATETIME;
+			token.value = (UINT64)seconds;
+		}
+	}
+	return pos;
+}
+
+size_t WqlLexer::scanWord(const size_t start)
+{
+	size_t pos = start + 1;
+	while (pos < m_text.size() && !isDelimiter(m_text[pos]) &&
+			!(m_text[pos] == '!' && pos + 1 < m_text.size() && m_text[pos + 1] == '='))
+	{
+		pos++;
+	}
+
+	addToken(WQLTOKEN_WORD, start, pos - start);
+
+	// a word that is entirely a number is a number
+	if (strchr("0123456789+-.", m_text[start]) != NULL)
+	{
+		scanNumber(m_tokens.back());
+	}
+	return pos;
+}
+
+void WqlLexer::scanNumber(struct WqlToken &token)
+{
+	const char *pStart = m_text.c_str() + token.start;
+	const char *pTokenEnd = pStart + token.length;
+	char *pEnd = NULL;
+	if (*pStart != '-' && *pStart != '.')
+	{
+		// 64-bit, in decimal, octal or hexadecimal
+		errno = 0;
+		UINT64 value = strtoull(pStart, &pEnd, 0);
+		if (errno == 0 && pEnd == pTokenEnd)
+		{
+			token.type = WQLTOKEN_NUMBER;
+			token.value = value;
+		}
+	}
+	if (token.type == WQLTOKEN_WORD && *pStart == '-')
+	{
+		errno = 0;
+		SINT64 value = strtoll(pStart, &pEnd, 0);
+		if (errno == 0 && pEnd == pTokenEnd)
+		{
+			// -0 is just 0
+			token.type = value < 0 ? WQLTOKEN_SIGNED : WQLTOKEN_NUMBER;
+			token.signedValue = value;
+		}
+	}
+	// only decimal reals, strtod would also take hexadecimal, infinities and NaNs
+	if (token.type == WQLTOKEN_WORD && strspn(pStart, "0123456789.eE+-") >= token.length)
+	{
+		errno = 0;
+		double value = strtod(pStart, &pEnd);
+		if (errno == 0 && pEnd == pTokenEnd)
+		{
+			token.type = WQLTOKEN_REAL;
+			token.realValue = value;
+		}
+	}
+}
+
+bool WqlLexer::isKeyword(const size_t pos, const std::string &keyword) const
+{
+	return isType(pos, WQLTOKEN_WORD) && m_tokens[pos].length == keyword.size() &&
+			s_strncmpi(m_text.c_str() + m_tokens[pos].start, keyword.c_str(),
+					keyword.size()) == 0;
+}
+
+bool WqlLexer::isOperator(const size_t pos, const std::string &op) const
+{
+	return isType(pos, WQLTOKEN_OPERATOR) &&
+			m_text.compare(m_tokens[pos].start, m_tokens[pos].length, op) == 0;
+}
+
+std::string WqlLexer::getText(const size_t pos) const
+{
+	return pos < m_tokens.size() ?
+			m_text.substr(m_tokens[pos].start, m_tokens[pos].length) : std::string();
+}
+
+std::string WqlLexer::getText(const size_t first, const size_t end) const
+{
+	std::string text;
+	if (first < end && end <= m_tokens.size())
+	{
+		size_t start = m_tokens[first].start;
+		text = m_text.substr(start, m_tokens[end - 1].start + m_tokens[end - 1].length - start);
+	}
+	return text;
+}
+
+std::string WqlLexer::getString(const size_t pos) const
+{
+	// the contents between the quote marks
+	const struct WqlToken &token = m_tokens[pos];
+	std::string str = m_text.substr(token.start + 1, token.length - 2);
+	if (token.escaped)
+	{
+		size_t to = 0;
+		for (size_t from = 0; from < str.size(); from++)
+		{
+			if (str[from] == '\\')
+			{
+				from++;
+			}
+			str[to++] = str[from];
+		}
+		str.resize(to);
+	}
+	return str;
+}
+
+} /* namespace framework */
+} /* namespace wbem */
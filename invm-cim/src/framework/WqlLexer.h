@@ -0,0 +1,173 @@
+/*
+ * Copyright (c) 2015 2016, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of Intel Corporation nor the names of its contributors
+ *     may be used to endorse or promote products derived from this software
+ *     without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * This file contains a class to split WQL strings into typed tokens.
+ */
+
+#ifndef WQLLEXER_H_
+#define WQLLEXER_H_
+
+#include <string>
+#include <vector>
+
+#include "Exception.h"
+#include "Types.h"
+
+namespace wbem
+{
+namespace framework
+{
+/*!
+ * Kinds of WQL tokens
+ */
+enum WqlTokenType
+{
+	WQLTOKEN_WORD, //!< a keyword or a name
+	WQLTOKEN_NUMBER, //!< an unsigned integer
+	WQLTOKEN_SIGNED, //!< a negative integer
+	WQLTOKEN_REAL, //!< a number with a fraction or an exponent
+	WQLTOKEN_STRING, //!< a quoted string
+	WQLTOKEN_DATETIME, //!< a quoted string holding a CIM datetime
+	WQLTOKEN_OPERATOR, //!< a comparison operator: = < > <= >= != <>
+	WQLTOKEN_OPENPAREN, //!< (
+	WQLTOKEN_CLOSEPAREN, //!< )
+	WQLTOKEN_COMMA, //!< ,
+	WQLTOKEN_STAR //!< *
+};
+
+/*!
+ * A token, as a span of the text it was found in
+ */
+struct WqlToken
+{
+	enum WqlTokenType type;
+	size_t start; //!< offset of the first character in the text
+	size_t length; //!< number of characters, including any quote marks
+	UINT64 value; //!< value of a NUMBER, or seconds since the epoch of a DATETIME
+	SINT64 signedValue; //!< value of a SIGNED
+	double realValue; //!< value of a REAL
+	bool escaped; //!< a quoted string contains backslash escapes
+};
+
+/*!
+ * Splits a WQL string into tokens in a single pass. Quoted strings are single tokens
+ * whose contents are kept exactly, and numbers and datetimes are recognized as they are
+ * found.
+ * @remark The lexer refers to the text rather than copying it, so the text must outlive
+ * the lexer.
+ */
+class INVM_CIM_API WqlLexer
+{
+	public:
+		/*!
+		 * Split the text into tokens.
+		 * @param text - WQL string
+		 * @throw NvmException - if a quoted string isn't closed
+		 */
+		WqlLexer(const std::string &text) throw (Exception);
+
+		/*!
+		 * Get the number of tokens.
+		 */
+		size_t size() const { return m_tokens.size(); }
+
+		/*!
+		 * Get the token at pos, which must be less than size().
+		 */
+		const struct WqlToken &operator[](const size_t pos) const { return m_tokens[pos]; }
+
+		/*!
+		 * Returns true if there is a token of the type at pos.
+		 */
+		bool isType(const size_t pos, const enum WqlTokenType type) const
+		{ return pos < m_tokens.size() && m_tokens[pos].type == type; }
+
+		/*!
+		 * Returns true if the token at pos is the keyword, ignoring case.
+		 */
+		bool isKeyword(const size_t pos, const std::string &keyword) const;
+
+		/*!
+		 * Returns true if the token at pos is the operator.
+		 */
+		bool isOperator(const size_t pos, const std::string &op) const;
+
+		/*!
+		 * Get the text of the token at pos as it appears in the query, or an empty string
+		 * if there are no more tokens.
+		 */
+		std::string getText(const size_t pos) const;
+
+		/*!
+		 * Get the text from the token at first up to the token at end, as it appears in
+		 * the query.
+		 */
+		std::string getText(const size_t first, const size_t end) const;
+
+		/*!
+		 * Get the contents of the quoted string at pos, without its quote marks and
+		 * escapes.
+		 */
+		std::string getString(const size_t pos) const;
+
+	protected:
+		const std::string &m_text; //!< the text the token spans refer to
+		std::vector<struct WqlToken> m_tokens;
+
+		/*
+		 * Add a token to the list
+		 */
+		void addToken(const enum WqlTokenType type, const size_t start, const size_t length);
+
+		/*
+		 * Scan the quoted string starting at start
+		 * @return the offset after the closing quote mark
+		 */
+		size_t scanString(const size_t start) throw (Exception);
+
+		/*
+		 * Scan the word or number starting at start
+		 * @return the offset after the word
+		 */
+		size_t scanWord(const size_t start);
+
+		/*
+		 * Make a word token that is entirely a number a NUMBER, SIGNED or REAL token
+		 */
+		void scanNumber(struct WqlToken &token);
+
+	private:
+		// the tokens refer to the text, so they can't be copied with it
+		WqlLexer(const WqlLexer &);
+		WqlLexer &operator=(const WqlLexer &);
+};
+
+} /* namespace framework */
+} /* namespace wbem */
+
+#endif /* WQLLEXER_H_ */
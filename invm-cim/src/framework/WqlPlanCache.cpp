@@ -0,0 +1,146 @@
+/*
+ * Copyright (c) 2015 2016, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of Intel Corporation nor the names of its contributors
+ *     may be used to endorse or promote products derived from this software
+ *     without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * This file contains a cache of compiled WQL queries.
+ */
+
+#include <logger/logging.h>
+#include "WqlLexer.h"
+#include "WqlPlanCache.h"
+
+namespace wbem
+{
+namespace framework
+{
+
+WqlPlan::WqlPlan(const std::string &query) throw (Exception) :
+	m_query(query),
+	m_evaluator(m_query)
+{
+}
+
+WqlPlanCache::WqlPlanCache(const size_t maxPlans) :
+	m_maxPlans(maxPlans)
+{
+}
+
+WqlPlanCache &WqlPlanCache::getSingleton()
+{
+	static WqlPlanCache cache;
+	return cache;
+}
+
+std::shared_ptr<const WqlPlan> WqlPlanCache::getPlan(const std::string &query) throw (Exception)
+{
+	Trace logging(__FILE__, __FUNCTION__, __LINE__);
+
+	std::string key = getKey(query);
+	{
+		std::lock_guard<std::mutex> lock(m_lock);
+		std::unordered_map<std::string, plan_list_t::iterator>::iterator iEntry =
+				m_index.find(key);
+		if (iEntry != m_index.end())
+		{
+			m_plans.splice(m_plans.begin(), m_plans, iEntry->second);
+			return iEntry->second->second;
+		}
+	}
+
+	// compile without the lock, an invalid query throws before anything is cached
+	std::shared_ptr<const WqlPlan> pPlan(new WqlPlan(query));
+
+	std::lock_guard<std::mutex> lock(m_lock);
+	std::unordered_map<std::string, plan_list_t::iterator>::iterator iEntry = m_index.find(key);
+	if (iEntry != m_index.end())
+	{
+		// another thread compiled it first
+		m_plans.splice(m_plans.begin(), m_plans, iEntry->second);
+		pPlan = iEntry->second->second;
+	}
+	else if (m_maxPlans > 0)
+	{
+		m_plans.push_front(plan_entry_t(key, pPlan));
+		m_index[key] = m_plans.begin();
+		while (m_plans.size() > m_maxPlans)
+		{
+			COMMON_LOG_DEBUG_F("Dropping WQL plan: %s", m_plans.back().first.c_str());
+			m_index.erase(m_plans.back().first);
+			m_plans.pop_back();
+		}
+	}
+	return pPlan;
+}
+
+void WqlPlanCache::clear()
+{
+	std::lock_guard<std::mutex> lock(m_lock);
+	m_index.clear();
+	m_plans.clear();
+}
+
+size_t WqlPlanCache::size()
+{
+	std::lock_guard<std::mutex> lock(m_lock);
+	return m_plans.size();
+}
+
+std::string WqlPlanCache::getKey(const std::string &query)
+{
+	std::string className;
+	std::string text;
+	text.reserve(query.size());
+	try
+	{
+		// join the tokens with single spaces, quoted strings are single tokens so their
+		// contents are copied as they are
+		WqlLexer lexer(query);
+		for (size_t i = 0; i < lexer.size(); i++)
+		{
+			if (i > 0)
+			{
+				text += ' ';
+			}
+			text.append(query, lexer[i].start, lexer[i].length);
+
+			if (className.empty() && lexer.isKeyword(i, "FROM") &&
+					lexer.isType(i + 1, WQLTOKEN_WORD))
+			{
+				className = lexer.getText(i + 1);
+			}
+		}
+	}
+	catch (Exception &)
+	{
+		// it won't compile so it's never cached, filters still need a key for it
+		text = query;
+	}
+	return className + ' ' + text;
+}
+
+} /* namespace framework */
+} /* namespace wbem */
@@ -0,0 +1,143 @@
+/*
+ * Copyright (c) 2015 2016, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of Intel Corporation nor the names of its contributors
+ *     may be used to endorse or promote products derived from this software
+ *     without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * This file contains a cache of compiled WQL queries, so a query that is sent again
+ * doesn't need to be parsed and compiled again.
+ */
+
+#ifndef WQLPLANCACHE_H_
+#define WQLPLANCACHE_H_
+
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "Exception.h"
+#include "WqlEvaluator.h"
+#include "WqlQuery.h"
+
+#define	WQL_PLAN_CACHE_MAX_PLANS 64 //!< Plans kept before the least recently used is dropped
+
+namespace wbem
+{
+namespace framework
+{
+
+/*!
+ * A WQL query parsed and compiled for execution. A plan doesn't change once it's built,
+ * so it can be shared between threads.
+ */
+class INVM_CIM_API WqlPlan
+{
+	public:
+		/*!
+		 * Parse and compile a query.
+		 * @param query - the WQL query string
+		 * @throw ExceptionInvalidWqlQuery - if the query is invalid
+		 */
+		WqlPlan(const std::string &query) throw (Exception);
+
+		/*!
+		 * Get the parsed query.
+		 */
+		const WqlQuery &getQuery() const { return m_query; }
+
+		/*!
+		 * Get the compiled query.
+		 */
+		const WqlEvaluator &getEvaluator() const { return m_evaluator; }
+
+	protected:
+		WqlQuery m_query;
+		WqlEvaluator m_evaluator; //!< compiled from m_query
+};
+
+/*!
+ * The most recently used WQL plans, keyed by the class each query is for and its
+ * normalized text.
+ * @remarks Clients tend to send the same few queries again and again, e.g. every polling
+ * interval or when a subscription is made again, so ExecQuery and indication filters get
+ * their plans from here. Invalid queries are not cached.
+ */
+class INVM_CIM_API WqlPlanCache
+{
+	public:
+		/*!
+		 * Constructor.
+		 * @param maxPlans - the number of plans to keep
+		 */
+		WqlPlanCache(const size_t maxPlans = WQL_PLAN_CACHE_MAX_PLANS);
+
+		/*!
+		 * Get the cache shared by the provider.
+		 */
+		static WqlPlanCache &getSingleton();
+
+		/*!
+		 * Get the plan for a query, compiling it if it isn't cached.
+		 * @param query - the WQL query string
+		 * @throw ExceptionInvalidWqlQuery - if the query is invalid
+		 * @return
+		 * 		The plan, which stays valid while the caller holds it.
+		 */
+		std::shared_ptr<const WqlPlan> getPlan(const std::string &query) throw (Exception);
+
+		/*!
+		 * Drop every plan.
+		 */
+		void clear();
+
+		/*!
+		 * Returns the number of plans held.
+		 */
+		size_t size();
+
+		/*!
+		 * Get the key that identifies the plan of a query: the class after FROM, then the
+		 * query text. Whitespace between tokens parses the same however much of it there
+		 * is, so the tokens are joined with single spaces. Quoted strings are kept exactly.
+		 * @remarks Plans are compiled from the query as it was sent, not from its key.
+		 */
+		static std::string getKey(const std::string &query);
+
+	protected:
+		typedef std::pair<std::string, std::shared_ptr<const WqlPlan> > plan_entry_t;
+		typedef std::list<plan_entry_t> plan_list_t;
+
+		std::mutex m_lock;
+		size_t m_maxPlans;
+		plan_list_t m_plans; //!< most recently used first
+		std::unordered_map<std::string, plan_list_t::iterator> m_index;
+};
+
+} /* namespace framework */
+} /* namespace wbem */
+
+#endif /* WQLPLANCACHE_H_ */
@@ -0,0 +1,500 @@
+/*
+ * Copyright (c) 2015 2016, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of Intel Corporation nor the names of its contributors
+ *     may be used to endorse or promote products derived from this software
+ *     without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * This file contains a class to evaluate the conditional of a WQL query against instances.
+ */
+
+#include <string.h>
+#include <logger/logging.h>
+#include <time/time_utilities.h>
+#include "CimomAdapter.h"
+#include "CimXml.h"
+#include "InstanceFactory.h"
+#include "ObjectPathBuilder.h"
+#include "WqlPredicate.h"
+
+namespace wbem
+{
+namespace framework
+{
+
+/*
+ * Three-way comparison of two values of the same type
+ */
+template <typename T>
+static int compareValues(const T &lhs, const T &rhs)
+{
+	return lhs < rhs ? -1 : (rhs < lhs ? 1 : 0);
+}
+
+WqlPredicate::WqlPredicate(const WqlConditional *pConditional) :
+	m_isConjunction(true)
+{
+	if (pConditional)
+	{
+		m_program = pConditional->getProgram();
+		m_isConjunction = pConditional->isConjunction();
+
+		const std::vector<struct WqlComparisonClause> &clauses = pConditional->getConditions();
+		for (size_t i = 0; i < clauses.size(); i++)
+		{
+			struct Comparison comparison;
+			comparison.attributeName = clauses[i].attributeName;
+			comparison.op = clauses[i].op;
+			comparison.valueType = clauses[i].value.getType();
+			comparison.uintValue = 0;
+			comparison.sintValue = 0;
+			comparison.realValue = 0;
+			comparison.isInterval = false;
+			comparison.intervalValue = 0;
+			comparison.isPath = false;
+
+			switch (comparison.valueType)
+			{
+				case UINT64_T:
+				case BOOLEAN_T:
+				case DATETIME_T:
+					comparison.uintValue = clauses[i].value.uint64Value();
+					comparison.sintValue = clauses[i].value.sint64Value();
+					comparison.realValue = (double)comparison.sintValue;
+					if (comparison.valueType == DATETIME_T)
+					{
+						comparison.strValue = clauses[i].value.stringValue();
+					}
+					break;
+				case SINT64_T:
+					comparison.sintValue = clauses[i].value.sint64Value();
+					comparison.realValue = (double)comparison.sintValue;
+					break;
+				case REAL32_T:
+					comparison.realValue = (double)clauses[i].value.real32Value();
+					break;
+				case STR_T:
+					comparison.strValue = clauses[i].value.stringValue();
+					if (comparison.op == OP_LIKE || comparison.op == OP_ISA)
+					{
+						// a pattern or a class name, not a value
+						break;
+					}
+					{
+						unsigned long long seconds = 0;
+						comparison.isInterval = convert_datetime_string_to_seconds(
+								comparison.strValue.c_str(), &seconds) == DATETIME_TYPE_INTERVAL;
+						comparison.intervalValue = seconds;
+					}
+					comparison.isPath =
+						ObjectPathBuilder(comparison.strValue).Build(&comparison.pathValue);
+					break;
+				default:
+					COMMON_LOG_ERROR_F("Unexpected type %d in WQL comparison",
+							comparison.valueType);
+					throw Exception("Unexpected value type in WQL conditional");
+			}
+
+			m_comparisons.push_back(comparison);
+			if (!InstanceFactory::containsAttribute(comparison.attributeName, m_attributeNames))
+			{
+				m_attributeNames.push_back(comparison.attributeName);
+			}
+		}
+	}
+}
+
+bool WqlPredicate::matches(const Instance &instance) const
+{
+	// avoid log tracing in this function, it is called for every instance
+	bool result = true;
+	size_t next = 0;
+	while (next < m_program.size())
+	{
+		const struct WqlInstruction &instruction = m_program[next++];
+		switch (instruction.opcode)
+		{
+			case WQLOP_TEST:
+			{
+				const struct Comparison &comparison = m_comparisons[instruction.operand];
+				result = test(instance.findAttribute(comparison.attributeName), comparison);
+				break;
+			}
+			case WQLOP_NOT:
+				result = !result;
+				break;
+			case WQLOP_JUMPIFFALSE:
+				if (!result)
+				{
+					next = instruction.operand;
+				}
+				break;
+			case WQLOP_JUMPIFTRUE:
+				if (result)
+				{
+					next = instruction.operand;
+				}
+				break;
+		}
+	}
+	return result;
+}
+
+bool WqlPredicate::hasEquality() const
+{
+	bool result = false;
+	for (size_t i = 0; i < m_comparisons.size() && !result; i++)
+	{
+		result = m_comparisons[i].op == OP_EQ;
+	}
+	return result;
+}
+
+bool WqlPredicate::hasEqualityOn(const AttributeNameSet &attributeNames) const
+{
+	bool result = false;
+	for (size_t i = 0; i < m_comparisons.size() && !result; i++)
+	{
+		result = m_comparisons[i].op == OP_EQ &&
+				attributeNames.contains(m_comparisons[i].attributeName);
+	}
+	return result;
+}
+
+bool WqlPredicate::matchesKeys(const ObjectPath &path) const
+{
+	bool result = true;
+	for (size_t i = 0; i < m_comparisons.size() && result && m_isConjunction; i++)
+	{
+		const Attribute *pKey = findKey(path, m_comparisons[i].attributeName);
+		if (pKey)
+		{
+			result = test(pKey, m_comparisons[i]);
+		}
+	}
+	return result;
+}
+
+const Attribute *WqlPredicate::findKey(const ObjectPath &path, const std::string &name)
+{
+	const attributes_t &keys = path.getKeys();
+	attributes_const_itr_t iKey = keys.find(name);
+	if (iKey == keys.end())
+	{
+		// CIM names are case-insensitive
+		AttributeNameEqual equal;
+		iKey = keys.begin();
+		while (iKey != keys.end() && !equal(iKey->first, name))
+		{
+			iKey++;
+		}
+	}
+	return iKey != keys.end() ? &iKey->second : NULL;
+}
+
+bool WqlPredicate::test(const Attribute *pAttribute, const struct Comparison &comparison)
+{
+	bool result = false;
+	if (pAttribute)
+	{
+		switch (comparison.op)
+		{
+			case OP_LIKE:
+				result = (pAttribute->getType() == STR_T || pAttribute->getType() == ENUM_T ||
+						pAttribute->getType() == ENUM16_T) &&
+						likeMatch(pAttribute->stringRef().c_str(), comparison.strValue.c_str());
+				break;
+			case OP_ISA:
+				result = isA(*pAttribute, comparison.strValue);
+				break;
+			default:
+			{
+				int order = 0;
+				result = compare(*pAttribute, comparison, order) &&
+						applyOperator(comparison.op, order);
+				break;
+			}
+		}
+	}
+	return result;
+}
+
+bool WqlPredicate::isA(const Attribute &attribute, const std::string &className)
+{
+	std::string instanceClass;
+	if (attribute.getType() == REFERENCE_T)
+	{
+		instanceClass = attribute.referenceRef().getClass();
+	}
+	else if (attribute.isEmbedded())
+	{
+		// embedded instances are held as CIM-XML
+		try
+		{
+			CimXml xml(attribute.stringRef());
+			instanceClass = xml.getClass();
+		}
+		catch (std::exception &)
+		{
+			COMMON_LOG_DEBUG("Embedded instance isn't valid CIM-XML");
+		}
+	}
+
+	bool result = false;
+	if (!instanceClass.empty())
+	{
+		classIsA(instanceClass, className, result);
+	}
+	return result;
+}
+
+bool WqlPredicate::compare(const Attribute &attribute, const struct Comparison &comparison,
+		int &result)
+{
+	bool isNumber = comparison.valueType == UINT64_T || comparison.valueType == BOOLEAN_T;
+	bool isNegative = comparison.valueType == SINT64_T;
+	bool isReal = comparison.valueType == REAL32_T;
+	bool isString = comparison.valueType == STR_T || comparison.valueType == DATETIME_T;
+	bool comparable = false;
+	switch (attribute.getType())
+	{
+		case BOOLEAN_T:
+		case UINT8_T:
+		case UINT16_T:
+		case UINT32_T:
+		case UINT64_T:
+			comparable = compareUnsigned(attribute.uint64Value(), comparison, result);
+			break;
+		case SINT8_T:
+		case SINT16_T:
+		case SINT32_T:
+		case SINT64_T:
+			if (isNumber || isNegative)
+			{
+				result = compareValues(attribute.sint64Value(), comparison.sintValue);
+				comparable = true;
+			}
+			else if (isReal)
+			{
+				result = compareValues((double)attribute.sint64Value(), comparison.realValue);
+				comparable = true;
+			}
+			break;
+		case REAL32_T:
+			if (isNumber || isNegative || isReal)
+			{
+				result = compareValues((double)attribute.real32Value(), comparison.realValue);
+				comparable = true;
+			}
+			break;
+		case ENUM_T:
+		case ENUM16_T:
+			if (comparison.valueType == STR_T)
+			{
+				result = attribute.stringRef().compare(comparison.strValue);
+				comparable = true;
+			}
+			else
+			{
+				comparable = compareUnsigned(attribute.uint64Value(), comparison, result);
+			}
+			break;
+		case STR_T:
+			if (isString)
+			{
+				result = attribute.stringRef().compare(comparison.strValue);
+				comparable = true;
+			}
+			break;
+		case DATETIME_T:
+			if (comparison.valueType == DATETIME_T)
+			{
+				result = compareValues(attribute.uint64Value(), comparison.uintValue);
+				comparable = true;
+			}
+			break;
+		case DATETIME_INTERVAL_T:
+			if (comparison.isInterval)
+			{
+				result = compareValues(attribute.uint64Value(), comparison.intervalValue);
+				comparable = true;
+			}
+			break;
+		case REFERENCE_T:
+			if (comparison.isPath)
+			{
+				const ObjectPath &path = attribute.referenceRef();
+				result = ObjectPathEqual()(path, comparison.pathValue) ? 0 :
+						path.asString(true).compare(comparison.pathValue.asString(true));
+				comparable = true;
+			}
+			break;
+		default:
+			// arrays can't be compared with a single value
+			break;
+	}
+	return comparable;
+}
+
+bool WqlPredicate::compareUnsigned(const UINT64 value, const struct Comparison &comparison,
+		int &result)
+{
+	bool comparable = true;
+	switch (comparison.valueType)
+	{
+		case UINT64_T:
+		case BOOLEAN_T:
+			result = compareValues(value, comparison.uintValue);
+			break;
+		case SINT64_T:
+			// the value is negative
+			result = 1;
+			break;
+		case REAL32_T:
+			result = compareValues((double)value, comparison.realValue);
+			break;
+		default:
+			comparable = false;
+			break;
+	}
+	return comparable;
+}
+
+bool WqlPredicate::applyOperator(const ComparisonOperator op, const int result)
+{
+	bool applies = false;
+	switch (op)
+	{
+		case OP_EQ:
+			applies = result == 0;
+			break;
+		case OP_GT:
+			applies = result > 0;
+			break;
+		case OP_LT:
+			applies = result < 0;
+			break;
+		case OP_GE:
+			applies = result >= 0;
+			break;
+		case OP_LE:
+			applies = result <= 0;
+			break;
+		case OP_NE:
+			applies = result != 0;
+			break;
+		default:
+			// LIKE and ISA aren't orderings
+			break;
+	}
+	return applies;
+}
+
+bool WqlPredicate::likeMatch(const char *str, const char *pattern)
+{
+	// on a mismatch, let the last % take one more character and try again
+	const char *pRetryStr = NULL;
+	const char *pRetryPattern = NULL;
+	while (*str != '\0')
+	{
+		size_t length = 0;
+		if (*pattern == '%')
+		{
+			pattern++;
+			pRetryPattern = pattern;
+			pRetryStr = str;
+		}
+		else if (likeMatchCharacter(*str, pattern, length))
+		{
+			pattern += length;
+			str++;
+		}
+		else if (pRetryPattern)
+		{
+			pattern = pRetryPattern;
+			str = ++pRetryStr;
+		}
+		else
+		{
+			return false;
+		}
+	}
+
+	while (*pattern == '%')
+	{
+		pattern++;
+	}
+	return *pattern == '\0';
+}
+
+bool WqlPredicate::likeMatchCharacter(const char c, const char *pattern, size_t &length)
+{
+	bool matched = false;
+	length = 1;
+	if (*pattern == '_')
+	{
+		matched = true;
+	}
+	else if (*pattern == '[')
+	{
+		// a set such as [abc], [a-z] or [^0-9]; a ] first in the set is a member
+		const char *pSet = pattern + 1;
+		bool negated = *pSet == '^';
+		if (negated)
+		{
+			pSet++;
+		}
+		const char *pEnd = strchr(pSet[0] == ']' ? pSet + 1 : pSet, ']');
+		if (pEnd == NULL)
+		{
+			matched = *pattern == c; // not a set after all
+		}
+		else
+		{
+			bool member = false;
+			for (const char *pCh = pSet; pCh < pEnd && !member; pCh++)
+			{
+				if (pCh[1] == '-' && pCh + 2 < pEnd)
+				{
+					member = c >= pCh[0] && c <= pCh[2];
+					pCh += 2;
+				}
+				else
+				{
+					member = c == *pCh;
+				}
+			}
+			matched = member != negated;
+			length = pEnd - pattern + 1;
+		}
+	}
+	else
+	{
+		matched = *pattern != '\0' && *pattern == c;
+	}
+	return matched;
+}
+
+} /* namespace framework */
+} /* namespace wbem */
@@ -0,0 +1,183 @@
+/*
+ * Copyright (c) 2015 2016, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of Intel Corporation nor the names of its contributors
+ *     may be used to endorse or promote products derived from this software
+ *     without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * This file contains a class to evaluate the conditional of a WQL query against instances.
+ */
+
+#ifndef WQLPREDICATE_H_
+#define WQLPREDICATE_H_
+
+#include <string>
+#include <vector>
+
+#include "AttributeNameSet.h"
+#include "Instance.h"
+#include "WqlConditional.h"
+
+namespace wbem
+{
+namespace framework
+{
+
+/*!
+ * A WQL conditional compiled for evaluation. The value of each comparison is converted
+ * once to the forms the attribute types compare against, and the conditional's program
+ * is run over them, so matching an instance doesn't parse, convert or allocate.
+ * @remarks A comparison is false if the instance doesn't have the attribute, or if the
+ * attribute's type can't be compared with the value (e.g. a string with a number, or any
+ * array). Numbers compare by value, whether each side is unsigned, signed or real.
+ * Strings are compared case-sensitively, and so are LIKE patterns, which support
+ * %, _ and [] character sets. Enumerations compare with numbers by their value and with
+ * strings by their name. ISA is true for a reference to, or an embedded instance of, the
+ * class or one of its subclasses. It is false if the CIMOM can't tell whether the instance's
+ * class is derived from the class.
+ */
+class INVM_CIM_API WqlPredicate
+{
+	public:
+		/*!
+		 * Compile a conditional.
+		 * @param pConditional
+		 * 		The conditional, or NULL for a predicate that matches every instance.
+		 */
+		WqlPredicate(const WqlConditional *pConditional);
+
+		/*!
+		 * Returns true if the instance satisfies the conditional.
+		 */
+		bool matches(const Instance &instance) const;
+
+		/*!
+		 * Returns the names of the attributes the comparisons need.
+		 */
+		const attribute_names_t &getAttributeNames() const { return m_attributeNames; }
+
+		/*!
+		 * Returns true if every instance matches.
+		 */
+		bool isEmpty() const { return m_comparisons.empty(); }
+
+		/*!
+		 * Returns true if the comparisons are only connected by AND.
+		 */
+		bool isConjunction() const { return m_isConjunction; }
+
+		/*!
+		 * Returns true if any comparison is an equality.
+		 */
+		bool hasEquality() const;
+
+		/*!
+		 * Returns true if any comparison is an equality on one of the attributes.
+		 */
+		bool hasEqualityOn(const AttributeNameSet &attributeNames) const;
+
+		/*!
+		 * Returns true if the instance at a path may satisfy the predicate, judging only
+		 * by the comparisons on the path's keys.
+		 * @remarks Comparisons on other attributes are assumed to match, so a false result
+		 * means the instance can't match and doesn't need to be retrieved. Unless the
+		 * predicate is a conjunction, every path may match.
+		 */
+		bool matchesKeys(const ObjectPath &path) const;
+
+	protected:
+		/*
+		 * A comparison with its value converted for each kind of attribute
+		 */
+		struct Comparison
+		{
+			std::string attributeName;
+			ComparisonOperator op;
+			enum DataType valueType;
+			UINT64 uintValue; // unsigned numbers, booleans (0 or 1) and datetimes
+			SINT64 sintValue; // integers
+			double realValue; // any number
+			std::string strValue; // strings, and datetimes for string attributes
+			bool isInterval; // the string is also a datetime interval
+			UINT64 intervalValue;
+			bool isPath; // the string is also an object path
+			ObjectPath pathValue;
+		};
+
+		std::vector<struct Comparison> m_comparisons; //!< indexed by the program
+		std::vector<struct WqlInstruction> m_program;
+		bool m_isConjunction;
+		attribute_names_t m_attributeNames;
+
+		/*
+		 * Find a key of a path by name, falling back to a case-insensitive search.
+		 * Returns NULL if the path doesn't have the key.
+		 */
+		static const Attribute *findKey(const ObjectPath &path, const std::string &name);
+
+		/*
+		 * Returns true if an attribute satisfies a comparison
+		 */
+		static bool test(const Attribute *pAttribute, const struct Comparison &comparison);
+
+		/*
+		 * Returns true if an attribute refers to, or embeds, an instance of a class
+		 */
+		static bool isA(const Attribute &attribute, const std::string &className);
+
+		/*
+		 * Compare an attribute with the value of a comparison. Returns false if they can't
+		 * be compared, otherwise sets result to <0, 0 or >0.
+		 */
+		static bool compare(const Attribute &attribute, const struct Comparison &comparison,
+				int &result);
+
+		/*
+		 * Compare an unsigned value with a numeric comparison value. Returns false if the
+		 * comparison value isn't a number.
+		 */
+		static bool compareUnsigned(const UINT64 value, const struct Comparison &comparison,
+				int &result);
+
+		/*
+		 * Apply a comparison operator to the result of a comparison
+		 */
+		static bool applyOperator(const ComparisonOperator op, const int result);
+
+		/*
+		 * Returns true if the whole string matches a LIKE pattern
+		 */
+		static bool likeMatch(const char *str, const char *pattern);
+
+		/*
+		 * Match one character against the start of a LIKE pattern other than %. On a
+		 * match, returns true and sets length to the length of the pattern used.
+		 */
+		static bool likeMatchCharacter(const char c, const char *pattern, size_t &length);
+};
+
+} /* namespace framework */
+} /* namespace wbem */
+
+#endif /* WQLPREDICATE_H_ */
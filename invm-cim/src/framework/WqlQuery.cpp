@@ -30,10 +30,8 @@
  * meaningful for the Intel WBEM library.
  */
 
-#include <memory>
+#include <algorithm>
 #include <string/s_str.h>
-#include <string/x_str.h>
-#include <string.h>
 #include <logger/logging.h>
 #include "ExceptionInvalidWqlQuery.h"
 #include "ExceptionNoMemory.h"
@@ -48,7 +46,9 @@ WqlQuery::WqlQuery(const std::string &query) throw (Exception) :
 		m_query(query),
 		m_className(""),
 		m_attributes(),
-		m_pConditional(NULL)
+		m_pConditional(NULL),
+		m_limit(WQL_NO_LIMIT),
+		m_offset(0)
 {
 	initFromQuery(query);
 }
@@ -59,6 +59,10 @@ WqlQuery::WqlQuery(const WqlQuery& query)
 	m_query = query.m_query;
 	m_className = query.m_className;
 	m_attributes = query.m_attributes;
+	m_aggregates = query.m_aggregates;
+	m_orderBy = query.m_orderBy;
+	m_limit = query.m_limit;
+	m_offset = query.m_offset;
 	if (query.m_pConditional)
 	{
 		m_pConditional = new WqlConditional(*(query.m_pConditional));
@@ -85,6 +89,10 @@ WqlQuery& WqlQuery::operator=(const WqlQuery& query)
 		m_query = query.m_query;
 		m_className = query.m_className;
 		m_attributes = query.m_attributes;
+		m_aggregates = query.m_aggregates;
+		m_orderBy = query.m_orderBy;
+		m_limit = query.m_limit;
+		m_offset = query.m_offset;
 
 		// Memory housekeeping
 		if (m_pConditional)
@@ -106,189 +114,105 @@ void WqlQuery::initFromQuery(const std::string &query) throw (Exception)
 {
 	Trace logging(__FILE__, __FUNCTION__, __LINE__);
 
-	// values
-	std::string className;
-	std::vector<std::string> selectTokens;
-	std::vector<std::string> conditionalTokens;
-
-	// parse the query string
-	parse(query, className, selectTokens, conditionalTokens);
+	// reject empty strings
+	if (query.empty())
+	{
+		COMMON_LOG_ERROR("empty WQL string");
+		throw ExceptionInvalidWqlQuery(ExceptionInvalidWqlQuery::REASON_BADLYFORMED);
+	}
 
-	// process the parsed values
-	processClassName(className);
-	processSelectAttributes(selectTokens);
-	processConditional(conditionalTokens);
+	// tokenize once, then parse and process the tokens
+	WqlLexer lexer(query);
+	parse(lexer);
 }
 
 /*
- * This method does some basic grammatical checking on the query while
- * populating the outputs, but more in-depth parsing of outputs occurs
- * elsewhere.
+ * Expect the form:
+ * 		SELECT <attr> FROM <classname> [WHERE <conditional>] [ORDER BY <attr>] [LIMIT <n>]
  */
-void WqlQuery::parse(const std::string &query,
-		std::string &className,
-		std::vector<std::string> &selectTokens,
-		std::vector<std::string> &conditionalTokens) const
-	throw (Exception)
+void WqlQuery::parse(const WqlLexer &lexer) throw (Exception)
 {
 	Trace logging(__FILE__, __FUNCTION__, __LINE__);
 
-	// reject empty strings
-	if (query.empty())
+	size_t pos = 0;
+	expectKeyword(lexer, pos, WQL_SELECT);
+	processSelectList(lexer, pos);
+	expectKeyword(lexer, pos, WQL_FROM);
+
+	// make sure it's not a keyword
+	std::string className = lexer.getText(pos);
+	if (!lexer.isType(pos, WQLTOKEN_WORD) || isWqlKeyword(className))
 	{
-		COMMON_LOG_ERROR("empty WQL string");
+		COMMON_LOG_ERROR_F("Expected a class name, got '%s'", className.c_str());
 		throw ExceptionInvalidWqlQuery(ExceptionInvalidWqlQuery::REASON_BADLYFORMED);
 	}
+	processClassName(className);
+	pos++;
 
-	// create a copy we can mangle
-	size_t querySize = query.size() + 1;
-    std::unique_ptr<char[]> tempStr(new char[querySize]);
-	s_strcpy(tempStr.get(), query.c_str(), querySize);
-	s_strtrim(tempStr.get(), querySize); // trim off whitespace
-
-	// remember the sizes of keyword strings
-	// we'll use them for string comparisons
-	static size_t selectSize = WQL_SELECT.size() + 1;
-	static size_t fromSize = WQL_FROM.size() + 1;
-	static size_t whereSize = WQL_WHERE.size() + 1;
-
-	// walk through the string
-	// expect the form:
-	// 		SELECT <attr> FROM <classname> [WHERE <conditional>]
-	enum ParseState
-	{
-		PARSE_SELECT,
-		PARSE_SELECT_VALUE,
-		PARSE_FROM,
-		PARSE_FROM_VALUE,
-		PARSE_WHERE,
-		PARSE_CONDITIONAL,
-		PARSE_DONE
-	};
-	enum ParseState state = PARSE_SELECT;
-
-	// Tokenize and parse out arguments
-	bool openQuotes = false; // track open quotes
-	char quoteType = '\0'; // track open quotes
-	const char *delim = " \t\n"; // delimiters - whitespace
-	char *pNext = tempStr.get(); // where to start search for next token
-	char *pCh = x_strtok(&pNext, delim);
-	while (pCh != NULL)
-	{
-		std::string token = pCh;
-		switch (state)
+	// the clauses are optional
+	if (lexer.isKeyword(pos, WQL_WHERE))
+	{
+		pos++;
+		size_t first = pos;
+		while (pos < lexer.size() && !isClauseStart(lexer, pos))
 		{
-		case PARSE_SELECT:
-			if (s_strncmpi(pCh, WQL_SELECT.c_str(),
-					selectSize) == 0)
-			{
-				state = PARSE_SELECT_VALUE;
-			}
-			else
-			{
-				COMMON_LOG_ERROR_F("Expected '%s', first token was '%s'",
-						WQL_SELECT.c_str(),
-						pCh);
-				throw ExceptionInvalidWqlQuery(ExceptionInvalidWqlQuery::REASON_BADLYFORMED);
-			}
-			break;
-		case PARSE_SELECT_VALUE:
-			// make sure it's not a keyword
-			if (!isWqlKeyword(token))
-			{
-				selectTokens.push_back(token);
-				// If there's a comma at the end, we expect more values
-				if (*(token.end() - 1) != ',')
-				{
-					state = PARSE_FROM;
-				}
-			}
-			else
-			{
-				COMMON_LOG_ERROR_F("Expected an attribute, got keyword '%s'",
-						pCh);
-				throw ExceptionInvalidWqlQuery(ExceptionInvalidWqlQuery::REASON_BADLYFORMED);
-			}
-			break;
-		case PARSE_FROM:
-			if (s_strncmpi(pCh, WQL_FROM.c_str(), fromSize) == 0)
-			{
-				state = PARSE_FROM_VALUE;
-			}
-			else
-			{
-				COMMON_LOG_ERROR_F("Expected keyword '%s', token was '%s'",
-						WQL_FROM.c_str(),
-						pCh);
-				throw ExceptionInvalidWqlQuery(ExceptionInvalidWqlQuery::REASON_BADLYFORMED);
-			}
-			break;
-		case PARSE_FROM_VALUE:
-			// make sure it's not a keyword
-			if (!isWqlKeyword(token))
-			{
-				className = token;
-				state = PARSE_WHERE;
-			}
-			else
+			if (lexer.isType(pos, WQLTOKEN_WORD) && isWqlKeyword(lexer.getText(pos)))
 			{
 				COMMON_LOG_ERROR_F("Expected a value, got keyword '%s'",
-						pCh);
+						lexer.getText(pos).c_str());
 				throw ExceptionInvalidWqlQuery(ExceptionInvalidWqlQuery::REASON_BADLYFORMED);
 			}
-			break;
-		case PARSE_WHERE:
-			if (s_strncmpi(pCh, WQL_WHERE.c_str(), whereSize) == 0)
-			{
-				state = PARSE_CONDITIONAL;
-			}
-			else
-			{
-				COMMON_LOG_ERROR_F("Expected keyword '%s', token was '%s'",
-						WQL_WHERE.c_str(),
-						pCh);
-				throw ExceptionInvalidWqlQuery(ExceptionInvalidWqlQuery::REASON_BADLYFORMED);
-			}
-			break;
-		case PARSE_CONDITIONAL:
-		case PARSE_DONE:
-			// We need at least one value
-			if (!isWqlKeyword(token) || openQuotes)
-			{
-				std::vector<std::string> substrings =
-						WqlConditional::dissectConditionalToken(token, openQuotes, quoteType);
-				conditionalTokens.insert(conditionalTokens.end(), substrings.begin(), substrings.end());
-				state = PARSE_DONE;
-			}
-			else
-			{
-				COMMON_LOG_ERROR_F("Expected a value, got keyword '%s'",
-						pCh);
-				throw ExceptionInvalidWqlQuery(ExceptionInvalidWqlQuery::REASON_BADLYFORMED);
-			}
-			break;
-		default:
-			COMMON_LOG_ERROR_F("invalid WQL parse state: %u", state);
-			throw Exception("Internal error parsing WQL string");
+			pos++;
 		}
 
-		// get the next token that isn't an empty string
-		do
+		// We need at least one value
+		if (first == pos)
 		{
-			pCh = x_strtok(&pNext, delim);
+			COMMON_LOG_ERROR("WHERE without a conditional");
+			throw ExceptionInvalidWqlQuery(ExceptionInvalidWqlQuery::REASON_BADLYFORMED);
 		}
-		while (pCh && std::string(pCh).empty());
+		processConditional(lexer, first, pos);
+	}
+
+	if (lexer.isKeyword(pos, WQL_ORDER) && isClauseStart(lexer, pos))
+	{
+		pos += 2; // ORDER BY
+		processOrderBy(lexer, pos);
+	}
+
+	if (lexer.isKeyword(pos, WQL_LIMIT) && isClauseStart(lexer, pos))
+	{
+		pos++;
+		processLimit(lexer, pos);
 	}
 
-	// Two possible end states
-	// ending on PARSE_WHERE implies no conditional, which is valid
-	if ((state != PARSE_WHERE) && (state != PARSE_DONE))
+	if (pos < lexer.size())
 	{
-		COMMON_LOG_ERROR("ran out of tokens before we finished");
+		COMMON_LOG_ERROR_F("Expected keyword '%s', '%s %s' or '%s', token was '%s'",
+				WQL_WHERE.c_str(), WQL_ORDER.c_str(), WQL_BY.c_str(), WQL_LIMIT.c_str(),
+				lexer.getText(pos).c_str());
 		throw ExceptionInvalidWqlQuery(ExceptionInvalidWqlQuery::REASON_BADLYFORMED);
 	}
 }
 
+void WqlQuery::expectKeyword(const WqlLexer &lexer, size_t &pos, const std::string &keyword)
+	throw (Exception)
+{
+	if (!lexer.isKeyword(pos, keyword))
+	{
+		COMMON_LOG_ERROR_F("Expected keyword '%s', token was '%s'",
+				keyword.c_str(), lexer.getText(pos).c_str());
+		throw ExceptionInvalidWqlQuery(ExceptionInvalidWqlQuery::REASON_BADLYFORMED);
+	}
+	pos++;
+}
+
+bool WqlQuery::isClauseStart(const WqlLexer &lexer, const size_t pos)
+{
+	return (lexer.isKeyword(pos, WQL_ORDER) && lexer.isKeyword(pos + 1, WQL_BY)) ||
+			(lexer.isKeyword(pos, WQL_LIMIT) && lexer.isType(pos + 1, WQLTOKEN_NUMBER));
+}
+
 void WqlQuery::processClassName(const std::string& name) throw (Exception)
 {
 	Trace logging(__FILE__, __FUNCTION__, __LINE__);
@@ -310,93 +234,213 @@ void WqlQuery::processClassName(const std::string& name) throw (Exception)
 	}
 }
 
-void WqlQuery::processSelectAttributes(const std::vector<std::string>& attrTokens)
+void WqlQuery::processSelectList(const WqlLexer &lexer, size_t &pos)
 		throw (Exception)
 {
 	Trace logging(__FILE__, __FUNCTION__, __LINE__);
 
-	if (attrTokens.empty())
+	// wildcard means all attributes - so leave the internal list empty
+	if (lexer.isType(pos, WQLTOKEN_STAR) && !lexer.isType(pos + 1, WQLTOKEN_COMMA))
 	{
-		COMMON_LOG_ERROR("no attributes requested in query");
-		throw ExceptionInvalidWqlQuery(ExceptionInvalidWqlQuery::REASON_BADATTR);
+		pos++;
 	}
+	else
+	{
+		// otherwise a list of attribute names or aggregates: <item>, <item>, ...
+		processSelectItems(lexer, pos);
+	}
+}
 
-	// wildcard means all attributes - so leave the internal list empty
-	if (!((attrTokens.size() == 1u) && (attrTokens[0] == WQL_SELECT_ALL)))
+void WqlQuery::processSelectItems(const WqlLexer &lexer, size_t &pos)
+		throw (Exception)
+{
+	bool more = true;
+	while (more)
 	{
-		// if we don't have the wildcard, process a list of attribute names
-		for (size_t i = 0; i < attrTokens.size(); i++)
+		std::string item = lexer.getText(pos);
+		if (lexer.isType(pos, WQLTOKEN_WORD) && lexer.isType(pos + 1, WQLTOKEN_OPENPAREN))
 		{
-			// split on commas if necessary
-			size_t length = attrTokens[i].size() + 1;
-            std::unique_ptr<char[]> tempStr(new char[length]);
-			s_strcpy(tempStr.get(), attrTokens[i].c_str(), length);
-			s_strtrim(tempStr.get(), length);
-
-			// if the token ends with a comma, zero it out
-			// to simplify processing
-			if (tempStr[strlen(tempStr.get()) - 1] == ',')
-			{
-				tempStr[strlen(tempStr.get()) - 1] = '\0';
-			}
+			processAggregate(lexer, pos);
+		}
+		else if (pos >= lexer.size() ||
+				(lexer.isType(pos, WQLTOKEN_WORD) && isWqlKeyword(item)))
+		{
+			COMMON_LOG_ERROR_F("Expected an attribute, got '%s'", item.c_str());
+			throw ExceptionInvalidWqlQuery(ExceptionInvalidWqlQuery::REASON_BADLYFORMED);
+		}
+		// Looks valid
+		else if (lexer.isType(pos, WQLTOKEN_WORD) && isValidCimName(item))
+		{
+			m_attributes.push_back(item);
+			pos++;
+		}
+		else
+		{
+			COMMON_LOG_ERROR_F("attribute name '%s' is invalid", item.c_str());
+			throw ExceptionInvalidWqlQuery(ExceptionInvalidWqlQuery::REASON_BADATTR, item);
+		}
 
-			// tokenize on commas
-			char *pNext = tempStr.get();
-			const char *delim = ",";
-			char *pToken = x_strtok(&pNext, delim);
-			while (pToken)
-			{
-				std::string attr = pToken;
+		// If there's a comma, we expect more values
+		more = lexer.isType(pos, WQLTOKEN_COMMA);
+		if (more)
+		{
+			pos++;
+		}
+	}
 
-				// Looks valid
-				if (isValidCimName(attr))
-				{
-					m_attributes.push_back(attr);
-				}
-				else
-				{
-					COMMON_LOG_ERROR_F("attribute name '%s' is invalid", attr.c_str());
-					throw ExceptionInvalidWqlQuery(ExceptionInvalidWqlQuery::REASON_BADATTR,
-							attr);
-				}
+	// without GROUP BY, attributes and aggregates can't be selected together
+	if (!m_aggregates.empty() && !m_attributes.empty())
+	{
+		COMMON_LOG_ERROR("query selects both attributes and aggregates");
+		throw ExceptionInvalidWqlQuery(ExceptionInvalidWqlQuery::REASON_BADATTR,
+				m_attributes[0]);
+	}
+}
 
-				// get the next token
-				pToken = x_strtok(&pNext, delim);
-			}
-		}
+void WqlQuery::processAggregate(const WqlLexer &lexer, size_t &pos)
+		throw (Exception)
+{
+	// FUNCTION ( argument )
+	std::string item = lexer.getText(pos, std::min(pos + 4, lexer.size()));
+	size_t argumentPos = pos + 2;
+	if (!lexer.isType(argumentPos + 1, WQLTOKEN_CLOSEPAREN))
+	{
+		COMMON_LOG_ERROR_F("aggregate '%s' isn't closed", item.c_str());
+		throw ExceptionInvalidWqlQuery(ExceptionInvalidWqlQuery::REASON_BADATTR, item);
+	}
+
+	struct WqlAggregate aggregate;
+	if (lexer.isType(argumentPos, WQLTOKEN_WORD))
+	{
+		aggregate.attributeName = lexer.getText(argumentPos);
+	}
+	if (lexer.isKeyword(pos, WQL_COUNT))
+	{
+		aggregate.function = WQLAGGREGATE_COUNT;
+		aggregate.resultName = WQL_COUNT;
+	}
+	else if (lexer.isKeyword(pos, WQL_MIN))
+	{
+		aggregate.function = WQLAGGREGATE_MIN;
+		aggregate.resultName = WQL_MIN;
+	}
+	else if (lexer.isKeyword(pos, WQL_MAX))
+	{
+		aggregate.function = WQLAGGREGATE_MAX;
+		aggregate.resultName = WQL_MAX;
+	}
+	else if (lexer.isKeyword(pos, WQL_SUM))
+	{
+		aggregate.function = WQLAGGREGATE_SUM;
+		aggregate.resultName = WQL_SUM;
+	}
+	else
+	{
+		COMMON_LOG_ERROR_F("unknown aggregate function '%s'", lexer.getText(pos).c_str());
+		throw ExceptionInvalidWqlQuery(ExceptionInvalidWqlQuery::REASON_BADATTR, item);
+	}
+
+	bool countAll = aggregate.function == WQLAGGREGATE_COUNT &&
+			lexer.isType(argumentPos, WQLTOKEN_STAR);
+	if (!countAll && !isValidCimName(aggregate.attributeName))
+	{
+		COMMON_LOG_ERROR_F("aggregate '%s' needs an attribute name", item.c_str());
+		throw ExceptionInvalidWqlQuery(ExceptionInvalidWqlQuery::REASON_BADATTR, item);
+	}
+	if (!countAll)
+	{
+		aggregate.resultName += "_" + aggregate.attributeName;
 	}
+
+	m_aggregates.push_back(aggregate);
+	pos = argumentPos + 2;
 }
 
-void WqlQuery::processConditional(const std::vector<std::string>& conditionalTokens)
+void WqlQuery::processOrderBy(const WqlLexer &lexer, size_t &pos)
 		throw (Exception)
 {
 	Trace logging(__FILE__, __FUNCTION__, __LINE__);
 
-	// it's okay to have no conditional
-	if (!conditionalTokens.empty())
+	// <attr> [ASC|DESC], ...
+	bool more = true;
+	while (more)
 	{
-		try
+		struct WqlOrderBy orderBy;
+		orderBy.attributeName = lexer.getText(pos);
+		orderBy.descending = false;
+		if (!lexer.isType(pos, WQLTOKEN_WORD) || !isValidCimName(orderBy.attributeName))
 		{
-			m_pConditional = new WqlConditional(conditionalTokens);
-			if (!m_pConditional)
-			{
-				throw ExceptionNoMemory(__FILE__, __FUNCTION__,
-						"couldn't allocate NvmWqlConditional");
-			}
+			COMMON_LOG_ERROR_F("invalid ORDER BY item '%s'", orderBy.attributeName.c_str());
+			throw ExceptionInvalidWqlQuery(ExceptionInvalidWqlQuery::REASON_BADATTR,
+					orderBy.attributeName);
+		}
+		pos++;
+
+		if (lexer.isKeyword(pos, WQL_DESC))
+		{
+			orderBy.descending = true;
+			pos++;
 		}
-		catch (Exception &)
+		else if (lexer.isKeyword(pos, WQL_ASC))
 		{
-			if (m_pConditional)
-			{
-				delete m_pConditional;
-				m_pConditional = NULL;
-			}
+			pos++;
+		}
+		m_orderBy.push_back(orderBy);
 
-			throw;
+		more = lexer.isType(pos, WQLTOKEN_COMMA);
+		if (more)
+		{
+			pos++;
 		}
 	}
 }
 
+void WqlQuery::processLimit(const WqlLexer &lexer, size_t &pos)
+		throw (Exception)
+{
+	Trace logging(__FILE__, __FUNCTION__, __LINE__);
+
+	// <count> [OFFSET <count>]
+	m_limit = lexer[pos++].value;
+	if (lexer.isKeyword(pos, WQL_OFFSET))
+	{
+		pos++;
+		if (!lexer.isType(pos, WQLTOKEN_NUMBER))
+		{
+			COMMON_LOG_ERROR("invalid OFFSET in LIMIT clause");
+			throw ExceptionInvalidWqlQuery(ExceptionInvalidWqlQuery::REASON_BADVALUE,
+					lexer.getText(pos));
+		}
+		m_offset = lexer[pos++].value;
+	}
+}
+
+void WqlQuery::processConditional(const WqlLexer &lexer, const size_t first, const size_t end)
+		throw (Exception)
+{
+	Trace logging(__FILE__, __FUNCTION__, __LINE__);
+
+	try
+	{
+		m_pConditional = new WqlConditional(lexer, first, end);
+		if (!m_pConditional)
+		{
+			throw ExceptionNoMemory(__FILE__, __FUNCTION__,
+					"couldn't allocate NvmWqlConditional");
+		}
+	}
+	catch (Exception &)
+	{
+		if (m_pConditional)
+		{
+			delete m_pConditional;
+			m_pConditional = NULL;
+		}
+
+		throw;
+	}
+}
+
 bool WqlQuery::isWqlKeyword(const std::string& value)
 {
 	Trace logging(__FILE__, __FUNCTION__, __LINE__);
@@ -38,6 +38,7 @@
 
 #include "Exception.h"
 #include "WqlConditional.h"
+#include "WqlLexer.h"
 
 namespace wbem
 {
@@ -50,7 +51,61 @@ const std::string WQL_SELECT = "SELECT";
 const std::string WQL_SELECT_ALL = "*";
 const std::string WQL_FROM = "FROM";
 const std::string WQL_WHERE = "WHERE";
+const std::string WQL_ORDER = "ORDER";
+const std::string WQL_BY = "BY";
+const std::string WQL_ASC = "ASC";
+const std::string WQL_DESC = "DESC";
+const std::string WQL_LIMIT = "LIMIT";
+const std::string WQL_OFFSET = "OFFSET";
+const std::string WQL_COUNT = "COUNT";
+const std::string WQL_MIN = "MIN";
+const std::string WQL_MAX = "MAX";
+const std::string WQL_SUM = "SUM";
 
+/*!
+ * The limit of a query without a LIMIT clause
+ */
+const UINT64 WQL_NO_LIMIT = (UINT64)-1;
+
+/*!
+ * Aggregate functions in a select list
+ */
+enum WqlAggregateFunction
+{
+	WQLAGGREGATE_COUNT, //!< the number of instances, or of instances with the attribute
+	WQLAGGREGATE_MIN, //!< the lowest value of the attribute
+	WQLAGGREGATE_MAX, //!< the highest value of the attribute
+	WQLAGGREGATE_SUM //!< the sum of the numeric values of the attribute
+};
+
+/*!
+ * An aggregate in a select list, e.g. COUNT(*) or MAX(MediaTemperature)
+ */
+struct WqlAggregate
+{
+	enum WqlAggregateFunction function;
+	std::string attributeName; //!< empty for COUNT(*)
+	std::string resultName; //!< the attribute of the result, e.g. COUNT or MAX_MediaTemperature
+};
+
+/*!
+ * An attribute in an ORDER BY clause
+ */
+struct WqlOrderBy
+{
+	std::string attributeName;
+	bool descending;
+};
+
+/*!
+ * A parsed WQL query, in the form:
+ * 		SELECT <attributes or aggregates> FROM <classname> [WHERE <conditional>]
+ * 			[ORDER BY <attribute> [ASC|DESC], ...] [LIMIT <count> [OFFSET <count>]]
+ * @remarks A select list holds either attributes or aggregates (COUNT(*), COUNT(attribute),
+ * MIN, MAX and SUM), not both. An aggregate query returns a single row. ORDER and LIMIT
+ * only start their clauses when followed by BY and a number, so they can still be used as
+ * attribute names in a conditional.
+ */
 class INVM_CIM_API WqlQuery
 {
 	public:
@@ -98,6 +153,26 @@ class INVM_CIM_API WqlQuery
 		 */
 		const WqlConditional* getConditional() const { return m_pConditional; }
 
+		/*!
+		 * Get the aggregates in the select list. Empty unless this is an aggregate query.
+		 */
+		const std::vector<struct WqlAggregate> &getAggregates() const { return m_aggregates; }
+
+		/*!
+		 * Get the attributes to sort the results by, most significant first.
+		 */
+		const std::vector<struct WqlOrderBy> &getOrderBy() const { return m_orderBy; }
+
+		/*!
+		 * Get the largest number of results to return, or WQL_NO_LIMIT.
+		 */
+		UINT64 getLimit() const { return m_limit; }
+
+		/*!
+		 * Get the number of results to skip before the first one returned.
+		 */
+		UINT64 getOffset() const { return m_offset; }
+
 		/*!
 		 * Returns true if the string is a keyword in a WQL query.
 		 */
@@ -121,6 +196,10 @@ class INVM_CIM_API WqlQuery
 		std::string m_className; //!< name of CIM class to query
 		attribute_names_t m_attributes; //!< attributes to select
 		WqlConditional *m_pConditional; //!< conditions under which to select the instance
+		std::vector<struct WqlAggregate> m_aggregates; //!< aggregates to compute
+		std::vector<struct WqlOrderBy> m_orderBy; //!< sort order of the results
+		UINT64 m_limit; //!< largest number of results
+		UINT64 m_offset; //!< results to skip
 
 		/*
 		 * Initialize the internal class members from the query string.
@@ -130,18 +209,24 @@ class INVM_CIM_API WqlQuery
 		void initFromQuery(const std::string &query) throw (Exception);
 
 		/*
-		 * Parse the query string and return relevant values as strings.
-		 * @param query - query string
-		 * @param className - returns the CIM class name as a string
-		 * @param selectTokens - returns the select value(s) tokenized on spaces
-		 * @param conditionalTokens - returns the conditional tokenized on spaces
+		 * Parse the tokens of the query. This method does some basic grammatical checking
+		 * while splitting the query into its pieces, which are processed by the methods
+		 * below.
+		 * @param lexer - tokens of the query string
 		 * @throw NvmException - if the query string is invalid
 		 */
-		void parse(const std::string &query,
-				std::string &className,
-				std::vector<std::string> &selectTokens,
-				std::vector<std::string> &conditionalTokens) const
-			throw (Exception);
+		void parse(const WqlLexer &lexer) throw (Exception);
+
+		/*
+		 * Throw unless the token at pos is the keyword, then move past it
+		 */
+		static void expectKeyword(const WqlLexer &lexer, size_t &pos,
+				const std::string &keyword) throw (Exception);
+
+		/*
+		 * Returns true if an ORDER BY or LIMIT clause starts at the token at pos
+		 */
+		static bool isClauseStart(const WqlLexer &lexer, const size_t pos);
 
 		/*
 		 * Processes a string and saves it as the class name member variable.
@@ -154,21 +239,47 @@ class INVM_CIM_API WqlQuery
 			throw (Exception);
 
 		/*
-		 * Processes a vector of whitespace-separated tokens into a list of attribute names,
-		 * saved as a member variable.
-		 * @param attrTokens
-		 * @throw NvmException - if the strings are invalid
+		 * Processes the comma-separated select list starting at pos into a list of
+		 * attribute names or aggregates, saved as member variables.
+		 * @throw NvmException - if the list is invalid
+		 */
+		void processSelectList(const WqlLexer &lexer, size_t &pos)
+			throw (Exception);
+
+		/*
+		 * Processes a select list that isn't the wildcard.
+		 * @throw NvmException - if an item is invalid or attributes and aggregates are mixed
+		 */
+		void processSelectItems(const WqlLexer &lexer, size_t &pos)
+			throw (Exception);
+
+		/*
+		 * Processes an aggregate such as COUNT(*) or MAX(attr) starting at pos.
+		 * @throw NvmException - if the aggregate is invalid
+		 */
+		void processAggregate(const WqlLexer &lexer, size_t &pos)
+			throw (Exception);
+
+		/*
+		 * Processes the tokens of an ORDER BY clause after BY into the sort order.
+		 * @throw NvmException - if an attribute or direction is invalid
+		 */
+		void processOrderBy(const WqlLexer &lexer, size_t &pos)
+			throw (Exception);
+
+		/*
+		 * Processes the tokens of a LIMIT clause after LIMIT into the limit and offset.
+		 * @throw NvmException - if a count is invalid
 		 */
-		void processSelectAttributes(const std::vector<std::string> &attrTokens)
+		void processLimit(const WqlLexer &lexer, size_t &pos)
 			throw (Exception);
 
 		/*
-		 * Processes a list of whitespace-separated tokens into a conditional,
-		 * allocated and saved as a member variable.
-		 * @param conditionalTokens
+		 * Processes a range of tokens into a conditional, allocated and saved as a member
+		 * variable.
 		 * @throw NvmException - if the conditional is formatted incorrectly
 		 */
-		void processConditional(const std::vector<std::string>& conditionalTokens)
+		void processConditional(const WqlLexer &lexer, const size_t first, const size_t end)
 			throw (Exception);
 };
 
@@ -0,0 +1,891 @@
+/*
+ * Copyright (c) 2015 2016, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of Intel Corporation nor the names of its contributors
+ *     may be used to endorse or promote products derived from this software
+ *     without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * This file contains the implementation of the fake CMPI broker.
+ */
+
+#include "FakeBroker.h"
+
+#include <strings.h>
+#include <utility>
+
+namespace wbem
+{
+namespace harness
+{
+
+typedef std::vector<std::pair<std::string, CMPIData> > fake_values_t;
+
+/*
+ * The fake CMPI objects. Each holds its CMPI struct, whose handle points back to it.
+ */
+struct FakeBrokerObject : public FakeObject
+{
+	FakeBroker *pBroker;
+};
+
+/*
+ * CMGetCharPtr reads a string's characters straight from its handle, so the handle can't
+ * point back to the fake. The CMPI struct comes first instead, followed by the broker.
+ */
+struct FakeStringHandle
+{
+	CMPIString cmpi;
+	FakeBroker *pBroker;
+};
+
+struct FakeString : public FakeObject
+{
+	FakeStringHandle handle;
+	std::string value;
+};
+
+struct FakeArray : public FakeBrokerObject
+{
+	CMPIArray cmpi;
+	CMPIType type;
+	std::vector<CMPIData> elements;
+};
+
+struct FakeDateTime : public FakeBrokerObject
+{
+	CMPIDateTime cmpi;
+	std::string value;
+};
+
+struct FakeObjectPath : public FakeBrokerObject
+{
+	CMPIObjectPath cmpi;
+	std::string nameSpace;
+	std::string hostName;
+	std::string className;
+	fake_values_t keys;
+};
+
+struct FakeInstance : public FakeBrokerObject
+{
+	CMPIInstance cmpi;
+	FakeObjectPath *pPath;
+	fake_values_t properties;
+};
+
+struct FakeContext : public FakeBrokerObject
+{
+	CMPIContext cmpi;
+};
+
+struct FakeResult : public FakeBrokerObject
+{
+	CMPIResult cmpi;
+	std::mutex lock; // the pipeline may return from more than one thread
+	FakeResultCounts counts;
+};
+
+struct FakeSelectExp : public FakeBrokerObject
+{
+	CMPISelectExp cmpi;
+	std::string query;
+};
+
+static CMPIBrokerFT g_brokerFt;
+static CMPIBrokerEncFT g_brokerEncFt;
+static CMPIContextFT g_contextFt;
+static CMPIResultFT g_resultFt;
+static CMPIStringFT g_stringFt;
+static CMPIArrayFT g_arrayFt;
+static CMPIDateTimeFT g_dateTimeFt;
+static CMPIObjectPathFT g_objectPathFt;
+static CMPIInstanceFT g_instanceFt;
+static CMPISelectExpFT g_selectExpFt;
+static std::once_flag g_functionTablesOnce;
+
+/*
+ * Get the fake behind a CMPI object
+ */
+template <class FAKE, class CMPITYPE>
+static FAKE *toFake(const CMPITYPE *pCmpiObject)
+{
+	return static_cast<FAKE *>(pCmpiObject->hdl);
+}
+
+/*
+ * Create a fake CMPI object owned by the broker
+ */
+template <class FAKE, class FT>
+static FAKE *newFake(FakeBroker *pBroker, FT *pFt)
+{
+	FAKE *pFake = pBroker->track(new FAKE());
+	pFake->pBroker = pBroker;
+	pFake->cmpi.hdl = pFake;
+	pFake->cmpi.ft = pFt;
+	return pFake;
+}
+
+static CMPIStatus makeStatus(const CMPIrc rc)
+{
+	CMPIStatus status = {rc, NULL};
+	return status;
+}
+
+static void setStatus(CMPIStatus *pStatus, const CMPIrc rc)
+{
+	if (pStatus != NULL)
+	{
+		*pStatus = makeStatus(rc);
+	}
+}
+
+static CMPIString *newString(FakeBroker *pBroker, const std::string &value)
+{
+	FakeString *pString = pBroker->track(new FakeString());
+	pString->value = value;
+	pString->handle.cmpi.hdl = (void *)pString->value.c_str();
+	pString->handle.cmpi.ft = &g_stringFt;
+	pString->handle.pBroker = pBroker;
+	return &pString->handle.cmpi;
+}
+
+/*
+ * Copy a value passed in by the provider. Chars are passed as the string itself, rather than
+ * a value holding it, and are kept as a string.
+ */
+static CMPIData makeData(FakeBroker *pBroker, const CMPIValue *pValue, const CMPIType type)
+{
+	CMPIData data;
+	data.type = type;
+	data.state = CMPI_goodValue;
+	data.value.uint64 = 0;
+	if (pValue == NULL)
+	{
+		data.state = CMPI_nullValue;
+	}
+	else if (type == CMPI_chars)
+	{
+		data.type = CMPI_string;
+		data.value.string = newString(pBroker, (const char *)pValue);
+	}
+	else
+	{
+		data.value = *pValue;
+	}
+	return data;
+}
+
+static CMPIData notFound()
+{
+	CMPIData data;
+	data.type = CMPI_null;
+	data.state = CMPI_notFound;
+	data.value.uint64 = 0;
+	return data;
+}
+
+static CMPIData findValue(const fake_values_t &values, const char *name, CMPIStatus *pStatus)
+{
+	for (fake_values_t::const_iterator iValue = values.begin(); iValue != values.end(); iValue++)
+	{
+		if (name != NULL && strcasecmp(iValue->first.c_str(), name) == 0)
+		{
+			setStatus(pStatus, CMPI_RC_OK);
+			return iValue->second;
+		}
+	}
+	setStatus(pStatus, CMPI_RC_ERR_NO_SUCH_PROPERTY);
+	return notFound();
+}
+
+static CMPIData valueAt(FakeBroker *pBroker, const fake_values_t &values, const CMPICount index,
+		CMPIString **ppName, CMPIStatus *pStatus)
+{
+	if (index >= values.size())
+	{
+		setStatus(pStatus, CMPI_RC_ERR_NO_SUCH_PROPERTY);
+		return notFound();
+	}
+	if (ppName != NULL)
+	{
+		*ppName = newString(pBroker, values[index].first);
+	}
+	setStatus(pStatus, CMPI_RC_OK);
+	return values[index].second;
+}
+
+static void setValue(fake_values_t &values, const char *name, const CMPIData &data)
+{
+	for (fake_values_t::iterator iValue = values.begin(); iValue != values.end(); iValue++)
+	{
+		if (strcasecmp(iValue->first.c_str(), name) == 0)
+		{
+			iValue->second = data;
+			return;
+		}
+	}
+	values.push_back(std::make_pair(std::string(name), data));
+}
+
+static CMPIStatus release(void *)
+{
+	// the broker owns its objects until releaseObjects
+	return makeStatus(CMPI_RC_OK);
+}
+
+/*
+ * Strings
+ */
+static CMPIStatus stringRelease(CMPIString *)
+{
+	return release(NULL);
+}
+
+static CMPIString *stringClone(const CMPIString *pString, CMPIStatus *pStatus)
+{
+	const FakeStringHandle *pHandle = reinterpret_cast<const FakeStringHandle *>(pString);
+	setStatus(pStatus, CMPI_RC_OK);
+	return newString(pHandle->pBroker, (const char *)pString->hdl);
+}
+
+static const char *stringGetCharPtr(const CMPIString *pString, CMPIStatus *pStatus)
+{
+	setStatus(pStatus, CMPI_RC_OK);
+	return (const char *)pString->hdl;
+}
+
+/*
+ * Arrays
+ */
+static CMPIStatus arrayRelease(CMPIArray *)
+{
+	return release(NULL);
+}
+
+static CMPIArray *arrayClone(const CMPIArray *pArray, CMPIStatus *pStatus)
+{
+	FakeArray *pFake = toFake<FakeArray>(pArray);
+	FakeArray *pClone = newFake<FakeArray>(pFake->pBroker, &g_arrayFt);
+	pClone->type = pFake->type;
+	pClone->elements = pFake->elements;
+	setStatus(pStatus, CMPI_RC_OK);
+	return &pClone->cmpi;
+}
+
+static CMPICount arrayGetSize(const CMPIArray *pArray, CMPIStatus *pStatus)
+{
+	setStatus(pStatus, CMPI_RC_OK);
+	return toFake<FakeArray>(pArray)->elements.size();
+}
+
+static CMPIType arrayGetSimpleType(const CMPIArray *pArray, CMPIStatus *pStatus)
+{
+	setStatus(pStatus, CMPI_RC_OK);
+	return toFake<FakeArray>(pArray)->type;
+}
+
+static CMPIData arrayGetElementAt(const CMPIArray *pArray, CMPICount index, CMPIStatus *pStatus)
+{
+	FakeArray *pFake = toFake<FakeArray>(pArray);
+	if (index >= pFake->elements.size())
+	{
+		setStatus(pStatus, CMPI_RC_ERR_NO_SUCH_PROPERTY);
+		return notFound();
+	}
+	setStatus(pStatus, CMPI_RC_OK);
+	return pFake->elements[index];
+}
+
+static CMPIStatus arraySetElementAt(CMPIArray *pArray, CMPICount index, const CMPIValue *pValue,
+		CMPIType type)
+{
+	FakeArray *pFake = toFake<FakeArray>(pArray);
+	if (index >= pFake->elements.size())
+	{
+		return makeStatus(CMPI_RC_ERR_NO_SUCH_PROPERTY);
+	}
+	pFake->elements[index] = makeData(pFake->pBroker, pValue, type);
+	return makeStatus(CMPI_RC_OK);
+}
+
+/*
+ * Datetimes
+ */
+static CMPIStatus dateTimeRelease(CMPIDateTime *)
+{
+	return release(NULL);
+}
+
+static CMPIDateTime *dateTimeClone(const CMPIDateTime *pDateTime, CMPIStatus *pStatus)
+{
+	FakeDateTime *pFake = toFake<FakeDateTime>(pDateTime);
+	FakeDateTime *pClone = newFake<FakeDateTime>(pFake->pBroker, &g_dateTimeFt);
+	pClone->value = pFake->value;
+	setStatus(pStatus, CMPI_RC_OK);
+	return &pClone->cmpi;
+}
+
+static CMPIUint64 dateTimeGetBinaryFormat(const CMPIDateTime *, CMPIStatus *pStatus)
+{
+	setStatus(pStatus, CMPI_RC_ERR_NOT_SUPPORTED);
+	return 0;
+}
+
+static CMPIString *dateTimeGetStringFormat(const CMPIDateTime *pDateTime, CMPIStatus *pStatus)
+{
+	FakeDateTime *pFake = toFake<FakeDateTime>(pDateTime);
+	setStatus(pStatus, CMPI_RC_OK);
+	return newString(pFake->pBroker, pFake->value);
+}
+
+static CMPIBoolean dateTimeIsInterval(const CMPIDateTime *pDateTime, CMPIStatus *pStatus)
+{
+	// intervals end in ":000" instead of a UTC offset
+	const std::string &value = toFake<FakeDateTime>(pDateTime)->value;
+	setStatus(pStatus, CMPI_RC_OK);
+	return value.size() == 25 && value[21] == ':';
+}
+
+/*
+ * Object paths
+ */
+static CMPIStatus objectPathRelease(CMPIObjectPath *)
+{
+	return release(NULL);
+}
+
+static FakeObjectPath *cloneObjectPath(const FakeObjectPath *pFake)
+{
+	FakeObjectPath *pClone = newFake<FakeObjectPath>(pFake->pBroker, &g_objectPathFt);
+	pClone->nameSpace = pFake->nameSpace;
+	pClone->hostName = pFake->hostName;
+	pClone->className = pFake->className;
+	pClone->keys = pFake->keys;
+	return pClone;
+}
+
+static CMPIObjectPath *objectPathClone(const CMPIObjectPath *pObjectPath, CMPIStatus *pStatus)
+{
+	setStatus(pStatus, CMPI_RC_OK);
+	return &cloneObjectPath(toFake<FakeObjectPath>(pObjectPath))->cmpi;
+}
+
+static CMPIStatus objectPathSetNameSpace(CMPIObjectPath *pObjectPath, const char *nameSpace)
+{
+	toFake<FakeObjectPath>(pObjectPath)->nameSpace = nameSpace ? nameSpace : "";
+	return makeStatus(CMPI_RC_OK);
+}
+
+static CMPIString *objectPathGetNameSpace(const CMPIObjectPath *pObjectPath, CMPIStatus *pStatus)
+{
+	FakeObjectPath *pFake = toFake<FakeObjectPath>(pObjectPath);
+	setStatus(pStatus, CMPI_RC_OK);
+	return newString(pFake->pBroker, pFake->nameSpace);
+}
+
+static CMPIStatus objectPathSetHostname(CMPIObjectPath *pObjectPath, const char *hostName)
+{
+	toFake<FakeObjectPath>(pObjectPath)->hostName = hostName ? hostName : "";
+	return makeStatus(CMPI_RC_OK);
+}
+
+static CMPIString *objectPathGetHostname(const CMPIObjectPath *pObjectPath, CMPIStatus *pStatus)
+{
+	FakeObjectPath *pFake = toFake<FakeObjectPath>(pObjectPath);
+	setStatus(pStatus, CMPI_RC_OK);
+	return newString(pFake->pBroker, pFake->hostName);
+}
+
+static CMPIStatus objectPathSetClassName(CMPIObjectPath *pObjectPath, const char *className)
+{
+	toFake<FakeObjectPath>(pObjectPath)->className = className ? className : "";
+	return makeStatus(CMPI_RC_OK);
+}
+
+static CMPIString *objectPathGetClassName(const CMPIObjectPath *pObjectPath, CMPIStatus *pStatus)
+{
+	FakeObjectPath *pFake = toFake<FakeObjectPath>(pObjectPath);
+	setStatus(pStatus, CMPI_RC_OK);
+	return newString(pFake->pBroker, pFake->className);
+}
+
+static CMPIStatus objectPathAddKey(CMPIObjectPath *pObjectPath, const char *name,
+		const CMPIValue *pValue, const CMPIType type)
+{
+	FakeObjectPath *pFake = toFake<FakeObjectPath>(pObjectPath);
+	if (name == NULL)
+	{
+		return makeStatus(CMPI_RC_ERR_INVALID_PARAMETER);
+	}
+	CMPIData data = makeData(pFake->pBroker, pValue, type);
+	data.state |= CMPI_keyValue;
+	setValue(pFake->keys, name, data);
+	return makeStatus(CMPI_RC_OK);
+}
+
+static CMPIData objectPathGetKey(const CMPIObjectPath *pObjectPath, const char *name,
+		CMPIStatus *pStatus)
+{
+	return findValue(toFake<FakeObjectPath>(pObjectPath)->keys, name, pStatus);
+}
+
+static CMPIData objectPathGetKeyAt(const CMPIObjectPath *pObjectPath, CMPICount index,
+		CMPIString **ppName, CMPIStatus *pStatus)
+{
+	FakeObjectPath *pFake = toFake<FakeObjectPath>(pObjectPath);
+	return valueAt(pFake->pBroker, pFake->keys, index, ppName, pStatus);
+}
+
+static CMPICount objectPathGetKeyCount(const CMPIObjectPath *pObjectPath, CMPIStatus *pStatus)
+{
+	setStatus(pStatus, CMPI_RC_OK);
+	return toFake<FakeObjectPath>(pObjectPath)->keys.size();
+}
+
+/*
+ * Instances
+ */
+static CMPIStatus instanceRelease(CMPIInstance *)
+{
+	return release(NULL);
+}
+
+static CMPIInstance *instanceClone(const CMPIInstance *pInstance, CMPIStatus *pStatus)
+{
+	FakeInstance *pFake = toFake<FakeInstance>(pInstance);
+	FakeInstance *pClone = newFake<FakeInstance>(pFake->pBroker, &g_instanceFt);
+	pClone->pPath = cloneObjectPath(pFake->pPath);
+	pClone->properties = pFake->properties;
+	setStatus(pStatus, CMPI_RC_OK);
+	return &pClone->cmpi;
+}
+
+static CMPIData instanceGetProperty(const CMPIInstance *pInstance, const char *name,
+		CMPIStatus *pStatus)
+{
+	return findValue(toFake<FakeInstance>(pInstance)->properties, name, pStatus);
+}
+
+static CMPIData instanceGetPropertyAt(const CMPIInstance *pInstance, CMPICount index,
+		CMPIString **ppName, CMPIStatus *pStatus)
+{
+	FakeInstance *pFake = toFake<FakeInstance>(pInstance);
+	return valueAt(pFake->pBroker, pFake->properties, index, ppName, pStatus);
+}
+
+static CMPICount instanceGetPropertyCount(const CMPIInstance *pInstance, CMPIStatus *pStatus)
+{
+	setStatus(pStatus, CMPI_RC_OK);
+	return toFake<FakeInstance>(pInstance)->properties.size();
+}
+
+static CMPIStatus instanceSetProperty(const CMPIInstance *pInstance, const char *name,
+		const CMPIValue *pValue, CMPIType type)
+{
+	FakeInstance *pFake = toFake<FakeInstance>(pInstance);
+	if (name == NULL)
+	{
+		return makeStatus(CMPI_RC_ERR_INVALID_PARAMETER);
+	}
+	setValue(pFake->properties, name, makeData(pFake->pBroker, pValue, type));
+	return makeStatus(CMPI_RC_OK);
+}
+
+static CMPIObjectPath *instanceGetObjectPath(const CMPIInstance *pInstance, CMPIStatus *pStatus)
+{
+	setStatus(pStatus, CMPI_RC_OK);
+	return &cloneObjectPath(toFake<FakeInstance>(pInstance)->pPath)->cmpi;
+}
+
+static CMPIStatus instanceSetPropertyFilter(CMPIInstance *, const char **, const char **)
+{
+	// every property is kept
+	return makeStatus(CMPI_RC_OK);
+}
+
+static CMPIStatus instanceSetObjectPath(CMPIInstance *pInstance, const CMPIObjectPath *pObjectPath)
+{
+	if (pObjectPath == NULL)
+	{
+		return makeStatus(CMPI_RC_ERR_INVALID_PARAMETER);
+	}
+	toFake<FakeInstance>(pInstance)->pPath = cloneObjectPath(toFake<FakeObjectPath>(pObjectPath));
+	return makeStatus(CMPI_RC_OK);
+}
+
+/*
+ * Contexts
+ */
+static CMPIStatus contextRelease(CMPIContext *)
+{
+	return release(NULL);
+}
+
+static CMPIContext *contextClone(const CMPIContext *pContext, CMPIStatus *pStatus)
+{
+	FakeContext *pFake = toFake<FakeContext>(pContext);
+	setStatus(pStatus, CMPI_RC_OK);
+	return &newFake<FakeContext>(pFake->pBroker, &g_contextFt)->cmpi;
+}
+
+static CMPIData contextGetEntry(const CMPIContext *, const char *, CMPIStatus *pStatus)
+{
+	// no invocation flags or roles are passed to the provider
+	setStatus(pStatus, CMPI_RC_ERR_NO_SUCH_PROPERTY);
+	return notFound();
+}
+
+static CMPIData contextGetEntryAt(const CMPIContext *, CMPICount, CMPIString **, CMPIStatus *pStatus)
+{
+	setStatus(pStatus, CMPI_RC_ERR_NO_SUCH_PROPERTY);
+	return notFound();
+}
+
+static CMPICount contextGetEntryCount(const CMPIContext *, CMPIStatus *pStatus)
+{
+	setStatus(pStatus, CMPI_RC_OK);
+	return 0;
+}
+
+static CMPIStatus contextAddEntry(const CMPIContext *, const char *, const CMPIValue *,
+		const CMPIType)
+{
+	return makeStatus(CMPI_RC_OK);
+}
+
+/*
+ * Results
+ */
+static CMPIStatus resultRelease(CMPIResult *)
+{
+	return release(NULL);
+}
+
+static CMPIStatus resultReturnData(const CMPIResult *pResult, const CMPIValue *, const CMPIType)
+{
+	FakeResult *pFake = toFake<FakeResult>(pResult);
+	std::lock_guard<std::mutex> lock(pFake->lock);
+	pFake->counts.data++;
+	return makeStatus(CMPI_RC_OK);
+}
+
+static CMPIStatus resultReturnInstance(const CMPIResult *pResult, const CMPIInstance *pInstance)
+{
+	FakeResult *pFake = toFake<FakeResult>(pResult);
+	if (pInstance == NULL)
+	{
+		return makeStatus(CMPI_RC_ERR_INVALID_PARAMETER);
+	}
+	std::lock_guard<std::mutex> lock(pFake->lock);
+	pFake->counts.instances++;
+	return makeStatus(CMPI_RC_OK);
+}
+
+static CMPIStatus resultReturnObjectPath(const CMPIResult *pResult,
+		const CMPIObjectPath *pObjectPath)
+{
+	FakeResult *pFake = toFake<FakeResult>(pResult);
+	if (pObjectPath == NULL)
+	{
+		return makeStatus(CMPI_RC_ERR_INVALID_PARAMETER);
+	}
+	std::lock_guard<std::mutex> lock(pFake->lock);
+	pFake->counts.objectPaths++;
+	return makeStatus(CMPI_RC_OK);
+}
+
+static CMPIStatus resultReturnDone(const CMPIResult *pResult)
+{
+	FakeResult *pFake = toFake<FakeResult>(pResult);
+	std::lock_guard<std::mutex> lock(pFake->lock);
+	pFake->counts.done = true;
+	return makeStatus(CMPI_RC_OK);
+}
+
+/*
+ * Select expressions
+ */
+static CMPIStatus selectExpRelease(CMPISelectExp *)
+{
+	return release(NULL);
+}
+
+static CMPIString *selectExpGetString(const CMPISelectExp *pSelectExp, CMPIStatus *pStatus)
+{
+	FakeSelectExp *pFake = toFake<FakeSelectExp>(pSelectExp);
+	setStatus(pStatus, CMPI_RC_OK);
+	return newString(pFake->pBroker, pFake->query);
+}
+
+/*
+ * Broker services
+ */
+static CMPIContext *brokerPrepareAttachThread(const CMPIBroker *pBroker, const CMPIContext *pContext)
+{
+	return contextClone(pContext, NULL);
+}
+
+static CMPIStatus brokerAttachThread(const CMPIBroker *pBroker, const CMPIContext *)
+{
+	FakeBroker::fromBroker(pBroker)->attached();
+	return makeStatus(CMPI_RC_OK);
+}
+
+static CMPIStatus brokerDetachThread(const CMPIBroker *, const CMPIContext *)
+{
+	return makeStatus(CMPI_RC_OK);
+}
+
+static CMPIStatus brokerDeliverIndication(const CMPIBroker *pBroker, const CMPIContext *,
+		const char *, const CMPIInstance *pIndication)
+{
+	if (pIndication == NULL)
+	{
+		return makeStatus(CMPI_RC_ERR_INVALID_PARAMETER);
+	}
+	FakeBroker::fromBroker(pBroker)->delivered();
+	return makeStatus(CMPI_RC_OK);
+}
+
+static CMPIInstance *brokerNewInstance(const CMPIBroker *pBroker, const CMPIObjectPath *pObjectPath,
+		CMPIStatus *pStatus)
+{
+	if (pObjectPath == NULL)
+	{
+		setStatus(pStatus, CMPI_RC_ERR_INVALID_PARAMETER);
+		return NULL;
+	}
+	FakeInstance *pInstance = newFake<FakeInstance>(FakeBroker::fromBroker(pBroker), &g_instanceFt);
+	pInstance->pPath = cloneObjectPath(toFake<FakeObjectPath>(pObjectPath));
+	setStatus(pStatus, CMPI_RC_OK);
+	return &pInstance->cmpi;
+}
+
+static CMPIObjectPath *brokerNewObjectPath(const CMPIBroker *pBroker, const char *nameSpace,
+		const char *className, CMPIStatus *pStatus)
+{
+	FakeObjectPath *pObjectPath = newFake<FakeObjectPath>(FakeBroker::fromBroker(pBroker),
+			&g_objectPathFt);
+	pObjectPath->nameSpace = nameSpace ? nameSpace : "";
+	pObjectPath->className = className ? className : "";
+	setStatus(pStatus, CMPI_RC_OK);
+	return &pObjectPath->cmpi;
+}
+
+static CMPIString *brokerNewString(const CMPIBroker *pBroker, const char *value, CMPIStatus *pStatus)
+{
+	setStatus(pStatus, CMPI_RC_OK);
+	return newString(FakeBroker::fromBroker(pBroker), value ? value : "");
+}
+
+static CMPIArray *brokerNewArray(const CMPIBroker *pBroker, CMPICount size, CMPIType type,
+		CMPIStatus *pStatus)
+{
+	FakeArray *pArray = newFake<FakeArray>(FakeBroker::fromBroker(pBroker), &g_arrayFt);
+	pArray->type = type;
+	pArray->elements.resize(size, makeData(pArray->pBroker, NULL, type));
+	setStatus(pStatus, CMPI_RC_OK);
+	return &pArray->cmpi;
+}
+
+static CMPIDateTime *brokerNewDateTimeFromChars(const CMPIBroker *pBroker, const char *value,
+		CMPIStatus *pStatus)
+{
+	if (value == NULL)
+	{
+		setStatus(pStatus, CMPI_RC_ERR_INVALID_PARAMETER);
+		return NULL;
+	}
+	FakeDateTime *pDateTime = newFake<FakeDateTime>(FakeBroker::fromBroker(pBroker), &g_dateTimeFt);
+	pDateTime->value = value;
+	setStatus(pStatus, CMPI_RC_OK);
+	return &pDateTime->cmpi;
+}
+
+static CMPIBoolean brokerClassPathIsA(const CMPIBroker *, const CMPIObjectPath *pObjectPath,
+		const char *type, CMPIStatus *pStatus)
+{
+	// the fake schema is flat, every class is only derived from CIM_ManagedElement
+	const std::string &className = toFake<FakeObjectPath>(pObjectPath)->className;
+	setStatus(pStatus, CMPI_RC_OK);
+	return type != NULL && (strcasecmp(className.c_str(), type) == 0 ||
+			strcasecmp(type, "CIM_ManagedElement") == 0);
+}
+
+/*
+ * Fill in the function tables. Calls the provider doesn't make are left NULL.
+ */
+static void initFunctionTables()
+{
+	g_brokerFt.brokerVersion = CMPICurrentVersion;
+	g_brokerFt.brokerName = "invm-cim-harness";
+	g_brokerFt.prepareAttachThread = brokerPrepareAttachThread;
+	g_brokerFt.attachThread = brokerAttachThread;
+	g_brokerFt.detachThread = brokerDetachThread;
+	g_brokerFt.deliverIndication = brokerDeliverIndication;
+
+	g_brokerEncFt.ftVersion = CMPICurrentVersion;
+	g_brokerEncFt.newInstance = brokerNewInstance;
+	g_brokerEncFt.newObjectPath = brokerNewObjectPath;
+	g_brokerEncFt.newString = brokerNewString;
+	g_brokerEncFt.newArray = brokerNewArray;
+	g_brokerEncFt.newDateTimeFromChars = brokerNewDateTimeFromChars;
+	g_brokerEncFt.classPathIsA = brokerClassPathIsA;
+
+	g_contextFt.ftVersion = CMPICurrentVersion;
+	g_contextFt.release = contextRelease;
+	g_contextFt.clone = contextClone;
+	g_contextFt.getEntry = contextGetEntry;
+	g_contextFt.getEntryAt = contextGetEntryAt;
+	g_contextFt.getEntryCount = contextGetEntryCount;
+	g_contextFt.addEntry = contextAddEntry;
+
+	g_resultFt.ftVersion = CMPICurrentVersion;
+	g_resultFt.release = resultRelease;
+	g_resultFt.returnData = resultReturnData;
+	g_resultFt.returnInstance = resultReturnInstance;
+	g_resultFt.returnObjectPath = resultReturnObjectPath;
+	g_resultFt.returnDone = resultReturnDone;
+
+	g_stringFt.ftVersion = CMPICurrentVersion;
+	g_stringFt.release = stringRelease;
+	g_stringFt.clone = stringClone;
+	g_stringFt.getCharPtr = stringGetCharPtr;
+
+	g_arrayFt.ftVersion = CMPICurrentVersion;
+	g_arrayFt.release = arrayRelease;
+	g_arrayFt.clone = arrayClone;
+	g_arrayFt.getSize = arrayGetSize;
+	g_arrayFt.getSimpleType = arrayGetSimpleType;
+	g_arrayFt.getElementAt = arrayGetElementAt;
+	g_arrayFt.setElementAt = arraySetElementAt;
+
+	g_dateTimeFt.ftVersion = CMPICurrentVersion;
+	g_dateTimeFt.release = dateTimeRelease;
+	g_dateTimeFt.clone = dateTimeClone;
+	g_dateTimeFt.getBinaryFormat = dateTimeGetBinaryFormat;
+	g_dateTimeFt.getStringFormat = dateTimeGetStringFormat;
+	g_dateTimeFt.isInterval = dateTimeIsInterval;
+
+	g_objectPathFt.ftVersion = CMPICurrentVersion;
+	g_objectPathFt.release = objectPathRelease;
+	g_objectPathFt.clone = objectPathClone;
+	g_objectPathFt.setNameSpace = objectPathSetNameSpace;
+	g_objectPathFt.getNameSpace = objectPathGetNameSpace;
+	g_objectPathFt.setHostname = objectPathSetHostname;
+	g_objectPathFt.getHostname = objectPathGetHostname;
+	g_objectPathFt.setClassName = objectPathSetClassName;
+	g_objectPathFt.getClassName = objectPathGetClassName;
+	g_objectPathFt.addKey = objectPathAddKey;
+	g_objectPathFt.getKey = objectPathGetKey;
+	g_objectPathFt.getKeyAt = objectPathGetKeyAt;
+	g_objectPathFt.getKeyCount = objectPathGetKeyCount;
+
+	g_instanceFt.ftVersion = CMPICurrentVersion;
+	g_instanceFt.release = instanceRelease;
+	g_instanceFt.clone = instanceClone;
+	g_instanceFt.getProperty = instanceGetProperty;
+	g_instanceFt.getPropertyAt = instanceGetPropertyAt;
+	g_instanceFt.getPropertyCount = instanceGetPropertyCount;
+	g_instanceFt.setProperty = instanceSetProperty;
+	g_instanceFt.getObjectPath = instanceGetObjectPath;
+	g_instanceFt.setPropertyFilter = instanceSetPropertyFilter;
+	g_instanceFt.setObjectPath = instanceSetObjectPath;
+
+	g_selectExpFt.ftVersion = CMPICurrentVersion;
+	g_selectExpFt.release = selectExpRelease;
+	g_selectExpFt.getString = selectExpGetString;
+}
+
+FakeBroker::FakeBroker() : m_attachments(0), m_indications(0)
+{
+	std::call_once(g_functionTablesOnce, initFunctionTables);
+
+	m_broker.hdl = this;
+	m_broker.bft = &g_brokerFt;
+	m_broker.eft = &g_brokerEncFt;
+	m_broker.xft = NULL;
+#ifdef CMPI_VER_200
+	m_broker.mft = NULL;
+#endif
+}
+
+FakeBroker::~FakeBroker()
+{
+	releaseObjects();
+}
+
+FakeBroker *FakeBroker::fromBroker(const CMPIBroker *pBroker)
+{
+	return static_cast<FakeBroker *>(pBroker->hdl);
+}
+
+CMPIContext *FakeBroker::newContext()
+{
+	return &newFake<FakeContext>(this, &g_contextFt)->cmpi;
+}
+
+CMPIResult *FakeBroker::newResult()
+{
+	FakeResult *pResult = newFake<FakeResult>(this, &g_resultFt);
+	pResult->counts.instances = 0;
+	pResult->counts.objectPaths = 0;
+	pResult->counts.data = 0;
+	pResult->counts.done = false;
+	return &pResult->cmpi;
+}
+
+CMPIObjectPath *FakeBroker::newObjectPath(const std::string &nameSpace,
+		const std::string &className)
+{
+	return brokerNewObjectPath(&m_broker, nameSpace.c_str(), className.c_str(), NULL);
+}
+
+CMPISelectExp *FakeBroker::newSelectExp(const std::string &query)
+{
+	FakeSelectExp *pSelectExp = newFake<FakeSelectExp>(this, &g_selectExpFt);
+	pSelectExp->query = query;
+	return &pSelectExp->cmpi;
+}
+
+FakeResultCounts FakeBroker::getResultCounts(const CMPIResult *pResult)
+{
+	FakeResult *pFake = toFake<FakeResult>(pResult);
+	std::lock_guard<std::mutex> lock(pFake->lock);
+	return pFake->counts;
+}
+
+void FakeBroker::releaseObjects()
+{
+	std::lock_guard<std::mutex> lock(m_lock);
+	for (std::vector<FakeObject *>::iterator iObject = m_objects.begin();
+			iObject != m_objects.end(); iObject++)
+	{
+		delete *iObject;
+	}
+	m_objects.clear();
+}
+
+} /* namespace harness */
+} /* namespace wbem */
@@ -0,0 +1,151 @@
+/*
+ * Copyright (c) 2015 2016, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of Intel Corporation nor the names of its contributors
+ *     may be used to endorse or promote products derived from this software
+ *     without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * This file contains an in-process stand-in for a CIMOM's CMPI broker, so the provider's
+ * CMPI entry points can be driven without sfcb or Pegasus.
+ */
+
+#ifndef	_WBEM_HARNESS_FAKE_BROKER_H_
+#define	_WBEM_HARNESS_FAKE_BROKER_H_
+
+#include <cmpi/cmpift.h>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace wbem
+{
+namespace harness
+{
+
+/*!
+ * Base of every object the fake broker hands out. The broker owns them all.
+ */
+struct FakeObject
+{
+	virtual ~FakeObject() {}
+};
+
+/*!
+ * What a request returned to its CMPI result
+ */
+struct FakeResultCounts
+{
+	size_t instances;
+	size_t objectPaths;
+	size_t data;
+	bool done;
+};
+
+/*!
+ * A CMPI broker that keeps everything in memory. It implements the broker, context, result,
+ * object path, instance, string, array, datetime and select expression calls the provider
+ * makes, and counts thread attachments and delivered indications.
+ * @remarks Every call is thread safe. Like a CIMOM, the broker owns the objects it creates;
+ * they are only freed by releaseObjects, once no request is using them.
+ */
+class FakeBroker
+{
+	public:
+		FakeBroker();
+		~FakeBroker();
+
+		/*!
+		 * The broker to pass to the provider
+		 */
+		const CMPIBroker *getBroker() const { return &m_broker; }
+
+		/*!
+		 * Create a request context
+		 */
+		CMPIContext *newContext();
+
+		/*!
+		 * Create a result that counts what is returned to it
+		 */
+		CMPIResult *newResult();
+
+		/*!
+		 * Create an object path for a class
+		 */
+		CMPIObjectPath *newObjectPath(const std::string &nameSpace, const std::string &className);
+
+		/*!
+		 * Create an indication filter's select expression
+		 */
+		CMPISelectExp *newSelectExp(const std::string &query);
+
+		/*!
+		 * What has been returned to a result created by newResult
+		 */
+		static FakeResultCounts getResultCounts(const CMPIResult *pResult);
+
+		/*!
+		 * Counters of the broker services the provider used
+		 */
+		CMPIUint64 getThreadAttachments() const { return m_attachments; }
+		CMPIUint64 getDeliveredIndications() const { return m_indications; }
+
+		/*!
+		 * Free every object created so far. Nothing may use them afterwards.
+		 */
+		void releaseObjects();
+
+		/*
+		 * Implementation of the CMPI calls, public for the function tables
+		 */
+		static FakeBroker *fromBroker(const CMPIBroker *pBroker);
+		template <class FAKE> FAKE *track(FAKE *pObject);
+		void attached() { m_attachments++; }
+		void delivered() { m_indications++; }
+
+	protected:
+		CMPIBroker m_broker;
+		std::mutex m_lock; // guards m_objects
+		std::vector<FakeObject *> m_objects;
+		std::atomic<CMPIUint64> m_attachments;
+		std::atomic<CMPIUint64> m_indications;
+
+	private:
+		FakeBroker(const FakeBroker &);
+		FakeBroker &operator=(const FakeBroker &);
+};
+
+template <class FAKE>
+FAKE *FakeBroker::track(FAKE *pObject)
+{
+	std::lock_guard<std::mutex> lock(m_lock);
+	m_objects.push_back(pObject);
+	return pObject;
+}
+
+} /* namespace harness */
+} /* namespace wbem */
+
+#endif /* _WBEM_HARNESS_FAKE_BROKER_H_ */
@@ -0,0 +1,59 @@
+/*
+ * Copyright (c) 2015 2016, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of Intel Corporation nor the names of its contributors
+ *     may be used to endorse or promote products derived from this software
+ *     without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * This file contains the tests the harness can run.
+ */
+
+#ifndef	_WBEM_HARNESS_HARNESS_H_
+#define	_WBEM_HARNESS_HARNESS_H_
+
+namespace wbem
+{
+namespace harness
+{
+
+/*!
+ * Drive the provider's CMPI entry points from several threads at once through a fake broker,
+ * checking every call returns OK and the expected results.
+ * @param argc, argv - the optional thread and iteration counts
+ * @return 0 if every check passed
+ */
+int runStress(int argc, char *argv[]);
+
+/*!
+ * Time WQL conditionals over synthetic rows, evaluated an instance at a time and over column
+ * batches, checking both select the same rows.
+ * @param argc, argv - the optional row and run counts
+ * @return 0 if the evaluations agreed on every condition
+ */
+int runWqlBenchmark(int argc, char *argv[]);
+
+} /* namespace harness */
+} /* namespace wbem */
+
+#endif /* _WBEM_HARNESS_HARNESS_H_ */
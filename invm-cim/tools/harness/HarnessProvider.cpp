@@ -0,0 +1,201 @@
+/*
+ * Copyright (c) 2015 2016, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of Intel Corporation nor the names of its contributors
+ *     may be used to endorse or promote products derived from this software
+ *     without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * This file contains the implementation of the harness provider.
+ */
+
+#include "HarnessProvider.h"
+
+#include <chrono>
+#include <cstdio>
+
+#include <ExceptionBadParameter.h>
+#include <Strings.h>
+#include <StringUtil.h>
+
+namespace wbem
+{
+namespace harness
+{
+
+#define	HARNESS_HOST "harness"
+
+std::string HarnessElementFactory::getInstanceId(const framework::UINT32 index)
+{
+	char instanceId[32];
+	snprintf(instanceId, sizeof (instanceId), "HARNESS-%u", index);
+	return instanceId;
+}
+
+void HarnessElementFactory::populateAttributeList(framework::attribute_names_t &attributes)
+{
+	attributes.push_back("InstanceID");
+	attributes.push_back("ElementName");
+	attributes.push_back("Temperature");
+	attributes.push_back("ErrorCount");
+}
+
+framework::instance_names_t *HarnessElementFactory::getInstanceNames()
+{
+	framework::instance_names_t *pNames = new framework::instance_names_t();
+	for (framework::UINT32 index = 0; index < HARNESS_ELEMENTS; index++)
+	{
+		framework::attributes_t keys;
+		keys["InstanceID"] = framework::Attribute(getInstanceId(index), true);
+		pNames->push_back(framework::ObjectPath(HARNESS_HOST, m_cimNamespace,
+				HARNESS_ELEMENT_CLASS, keys));
+	}
+	return pNames;
+}
+
+framework::Instance *HarnessElementFactory::getInstance(framework::ObjectPath &path,
+		framework::attribute_names_t &attributes)
+{
+	checkAttributes(attributes);
+
+	framework::UINT32 index = 0;
+	std::string instanceId = path.getKeyValue("InstanceID").stringValue();
+	if (sscanf(instanceId.c_str(), "HARNESS-%u", &index) != 1 || index >= HARNESS_ELEMENTS)
+	{
+		throw framework::ExceptionBadParameter("InstanceID");
+	}
+
+	framework::Instance *pInstance = new framework::Instance(path);
+	pInstance->setAttribute("ElementName",
+			framework::Attribute("Harness element " + instanceId, false), attributes);
+	pInstance->setAttribute("Temperature",
+			framework::Attribute(getTemperature(index), false), attributes);
+	pInstance->setAttribute("ErrorCount",
+			framework::Attribute(getErrorCount(index), false), attributes);
+	return pInstance;
+}
+
+HarnessIndicationService::HarnessIndicationService() : m_stop(false), m_starts(0)
+{
+	m_pContext = NULL;
+}
+
+HarnessIndicationService::~HarnessIndicationService()
+{
+	stopIndicating();
+}
+
+void HarnessIndicationService::startIndicating(framework::CimomAdapter *pContext)
+{
+	std::lock_guard<std::mutex> lock(m_lock);
+	if (m_pContext == NULL)
+	{
+		m_pContext = pContext;
+		m_stop = false;
+		m_starts++;
+		m_thread = std::thread(&HarnessIndicationService::sendIndications, this, pContext);
+	}
+}
+
+void HarnessIndicationService::stopIndicating()
+{
+	std::lock_guard<std::mutex> lock(m_lock);
+	if (m_pContext != NULL)
+	{
+		m_stop = true;
+		m_thread.join();
+		m_pContext = NULL;
+	}
+}
+
+bool HarnessIndicationService::isIndicating()
+{
+	std::lock_guard<std::mutex> lock(m_lock);
+	return m_pContext != NULL;
+}
+
+void HarnessIndicationService::sendIndications(framework::CimomAdapter *pContext)
+{
+	for (framework::UINT32 sequence = 0; !m_stop; sequence++)
+	{
+		framework::attributes_t keys;
+		keys["IndicationIdentifier"] = framework::Attribute(sequence, true);
+		framework::ObjectPath path(HARNESS_HOST, INTEL_ROOT_NAMESPACE, HARNESS_ALERT_CLASS, keys);
+		framework::Instance indication(path);
+		indication.setAttribute("AlertingManagedElement",
+				framework::Attribute(HarnessElementFactory::getInstanceId(
+						sequence % HARNESS_ELEMENTS), false));
+		pContext->sendIndication(indication);
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+}
+
+HarnessProviderFactory::HarnessProviderFactory() : m_initialized(false), m_setupErrors(0)
+{
+}
+
+void HarnessProviderFactory::InitializeProvider()
+{
+	if (m_initialized.exchange(true))
+	{
+		m_setupErrors++;
+	}
+}
+
+void HarnessProviderFactory::CleanUpProvider()
+{
+	if (!m_initialized.exchange(false))
+	{
+		m_setupErrors++;
+	}
+}
+
+std::vector<std::string> HarnessProviderFactory::getWarmUpClasses()
+{
+	return std::vector<std::string>(1, HARNESS_ELEMENT_CLASS);
+}
+
+framework::InstanceFactory *HarnessProviderFactory::getInstanceFactory(
+		const std::string &className)
+{
+	framework::InstanceFactory *pFactory = NULL;
+	if (framework::StringUtil::stringCompareIgnoreCase(className, HARNESS_ELEMENT_CLASS))
+	{
+		pFactory = new HarnessElementFactory();
+	}
+	return pFactory;
+}
+
+std::vector<framework::InstanceFactory *> HarnessProviderFactory::getAssociationFactories(
+		framework::Instance *pInstance,
+		const std::string &associationClassName,
+		const std::string &resultClassName,
+		const std::string &roleName,
+		const std::string &resultRoleName)
+{
+	return std::vector<framework::InstanceFactory *>();
+}
+
+} /* namespace harness */
+} /* namespace wbem */
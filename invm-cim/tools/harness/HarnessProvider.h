@@ -0,0 +1,165 @@
+/*
+ * Copyright (c) 2015 2016, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of Intel Corporation nor the names of its contributors
+ *     may be used to endorse or promote products derived from this software
+ *     without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * This file contains a provider serving synthetic instances, for the harness to drive
+ * through the CMPI entry points.
+ */
+
+#ifndef	_WBEM_HARNESS_HARNESS_PROVIDER_H_
+#define	_WBEM_HARNESS_HARNESS_PROVIDER_H_
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <InstanceFactory.h>
+#include <IndicationService.h>
+#include <ProviderFactory.h>
+
+#define	HARNESS_ELEMENT_CLASS "Intel_HarnessElement" //!< The class of the synthetic instances
+#define	HARNESS_ALERT_CLASS "Intel_HarnessAlert" //!< The class of the indications
+#define	HARNESS_ELEMENTS 64 //!< The number of synthetic instances
+
+namespace wbem
+{
+namespace harness
+{
+
+/*!
+ * Serves HARNESS_ELEMENTS instances of HARNESS_ELEMENT_CLASS, keyed by InstanceID, with
+ * values computed from the instance's index.
+ */
+class HarnessElementFactory : public framework::InstanceFactory
+{
+	public:
+		HarnessElementFactory() : framework::InstanceFactory() {}
+
+		framework::instance_names_t *getInstanceNames();
+
+		framework::Instance *getInstance(framework::ObjectPath &path,
+				framework::attribute_names_t &attributes);
+
+		/*!
+		 * Instances are found one at a time, so enumerations go through the pipeline
+		 */
+		bool streamsInstances() { return true; }
+
+		/*!
+		 * Every factory serves the same instances and attributes, so identical requests can
+		 * be shared and the attribute list populated once
+		 */
+		bool sharesRequests() { return true; }
+		bool cachesSupportedAttributes() { return true; }
+
+		/*!
+		 * The values of an instance
+		 */
+		static std::string getInstanceId(const framework::UINT32 index);
+		static framework::UINT32 getTemperature(const framework::UINT32 index)
+				{ return (index * 37) % 100; }
+		static framework::UINT64 getErrorCount(const framework::UINT32 index)
+				{ return (framework::UINT64)index * index; }
+
+	protected:
+		void populateAttributeList(framework::attribute_names_t &attributes);
+};
+
+/*!
+ * While indicating, sends an indication of HARNESS_ALERT_CLASS every millisecond from its
+ * own thread, like a provider watching for device events.
+ */
+class HarnessIndicationService : public framework::IndicationService
+{
+	public:
+		HarnessIndicationService();
+		~HarnessIndicationService();
+
+		void startIndicating(framework::CimomAdapter *pContext);
+		void stopIndicating();
+
+		/*!
+		 * True between startIndicating and stopIndicating
+		 */
+		bool isIndicating();
+
+		/*!
+		 * The number of times indicating was started
+		 */
+		framework::UINT32 getStarts() const { return m_starts; }
+
+	protected:
+		std::mutex m_lock; // guards m_pContext and m_thread
+		std::thread m_thread;
+		std::atomic<bool> m_stop;
+		std::atomic<framework::UINT32> m_starts;
+
+		void sendIndications(framework::CimomAdapter *pContext);
+};
+
+/*!
+ * The provider the harness loads. It warms up the element class when the CIMOM creates the
+ * instance provider, has no associations, and checks that InitializeProvider and
+ * CleanUpProvider are never called while another action is running.
+ */
+class HarnessProviderFactory : public framework::ProviderFactory
+{
+	public:
+		HarnessProviderFactory();
+
+		void InitializeProvider();
+		void CleanUpProvider();
+		std::vector<std::string> getWarmUpClasses();
+
+		framework::InstanceFactory *getInstanceFactory(const std::string &className);
+
+		std::vector<framework::InstanceFactory *> getAssociationFactories(
+				framework::Instance *pInstance,
+				const std::string &associationClassName,
+				const std::string &resultClassName,
+				const std::string &roleName,
+				const std::string &resultRoleName);
+
+		framework::IndicationService *getIndicationService() { return &m_indicationService; }
+
+		/*!
+		 * The number of times InitializeProvider or CleanUpProvider was called out of turn
+		 */
+		framework::UINT32 getSetupErrors() const { return m_setupErrors; }
+
+	protected:
+		HarnessIndicationService m_indicationService;
+		std::atomic<bool> m_initialized;
+		std::atomic<framework::UINT32> m_setupErrors;
+};
+
+} /* namespace harness */
+} /* namespace wbem */
+
+#endif /* _WBEM_HARNESS_HARNESS_PROVIDER_H_ */
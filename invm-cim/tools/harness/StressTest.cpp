@@ -0,0 +1,322 @@
+/*
+ * Copyright (c) 2015 2016, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of Intel Corporation nor the names of its contributors
+ *     may be used to endorse or promote products derived from this software
+ *     without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * This file contains a stress test that calls the provider's CMPI entry points from several
+ * threads at once, as sfcb or Pegasus do when the provider isn't loaded single-threaded.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#include <cmpi/cmpimacs.h>
+#include <IntelCmpiProvider.h>
+#include <InstanceFactory.h>
+#include <Strings.h>
+
+#include "FakeBroker.h"
+#include "Harness.h"
+#include "HarnessProvider.h"
+
+CMInstanceMIStubName(Harness)
+CMAssociationMIStubName(Harness)
+CMIndicationMIStubName(Harness)
+
+namespace wbem
+{
+namespace harness
+{
+
+#define	STRESS_DEFAULT_THREADS 8
+#define	STRESS_DEFAULT_ITERATIONS 100
+#define	STRESS_REPORTED_FAILURES 10
+#define	STRESS_ALERT_QUERY "SELECT * FROM " HARNESS_ALERT_CLASS
+
+/*
+ * The kinds of request each thread makes in turn
+ */
+enum stressRequest
+{
+	STRESS_ENUMERATE_NAMES,
+	STRESS_ENUMERATE_INSTANCES,
+	STRESS_GET_INSTANCE,
+	STRESS_EXEC_QUERY,
+	STRESS_ASSOCIATOR_NAMES,
+	STRESS_FILTER,
+	STRESS_REQUEST_KINDS
+};
+
+static const char *STRESS_REQUEST_NAMES[STRESS_REQUEST_KINDS] =
+{
+	"EnumerateInstanceNames",
+	"EnumerateInstances",
+	"GetInstance",
+	"ExecQuery",
+	"AssociatorNames",
+	"ActivateFilter/DeActivateFilter"
+};
+
+/*
+ * The MIs the CIMOM created, and the failures seen calling them
+ */
+struct Stress
+{
+	FakeBroker *pBroker;
+	CMPIInstanceMI *pInstanceMI;
+	CMPIAssociationMI *pAssociationMI;
+	CMPIIndicationMI *pIndicationMI;
+	std::atomic<unsigned int> calls;
+	std::atomic<unsigned int> failures;
+};
+
+static void check(Stress &stress, const bool passed, const char *request, const CMPIStatus &status,
+		const FakeResultCounts &counts, const size_t expected)
+{
+	// only report the first few, the rest are likely the same
+	if (!passed && stress.failures++ < STRESS_REPORTED_FAILURES)
+	{
+		fprintf(stderr, "%s failed: rc=%d (%s) done=%d instances=%zu paths=%zu expected=%zu\n",
+				request, (int)status.rc, status.msg ? CMGetCharsPtr(status.msg, NULL) : "",
+				(int)counts.done, counts.instances, counts.objectPaths, expected);
+	}
+}
+
+/*
+ * The number of elements an ExecQuery with a temperature threshold returns
+ */
+static size_t countWarmerThan(const framework::UINT32 threshold)
+{
+	size_t count = 0;
+	for (framework::UINT32 index = 0; index < HARNESS_ELEMENTS; index++)
+	{
+		if (HarnessElementFactory::getTemperature(index) >= threshold)
+		{
+			count++;
+		}
+	}
+	return count;
+}
+
+/*
+ * Make one request and check what the provider returned
+ */
+static void request(Stress &stress, const enum stressRequest kind, const unsigned int iteration)
+{
+	FakeBroker &broker = *stress.pBroker;
+	CMPIContext *pContext = broker.newContext();
+	CMPIResult *pResult = broker.newResult();
+	CMPIObjectPath *pPath = broker.newObjectPath(INTEL_ROOT_NAMESPACE, HARNESS_ELEMENT_CLASS);
+	CMPIStatus status = {CMPI_RC_OK, NULL};
+	size_t expected = 0;
+	bool returned = false; // true if results are returned as instances, not paths
+
+	switch (kind)
+	{
+	case STRESS_ENUMERATE_NAMES:
+		status = stress.pInstanceMI->ft->enumerateInstanceNames(stress.pInstanceMI, pContext,
+				pResult, pPath);
+		expected = HARNESS_ELEMENTS;
+		break;
+	case STRESS_ENUMERATE_INSTANCES:
+		status = stress.pInstanceMI->ft->enumerateInstances(stress.pInstanceMI, pContext,
+				pResult, pPath, NULL);
+		expected = HARNESS_ELEMENTS;
+		returned = true;
+		break;
+	case STRESS_GET_INSTANCE:
+	{
+		std::string instanceId = HarnessElementFactory::getInstanceId(iteration % HARNESS_ELEMENTS);
+		CMAddKey(pPath, "InstanceID", instanceId.c_str(), CMPI_chars);
+		status = stress.pInstanceMI->ft->getInstance(stress.pInstanceMI, pContext, pResult,
+				pPath, NULL);
+		expected = 1;
+		returned = true;
+		break;
+	}
+	case STRESS_EXEC_QUERY:
+	{
+		// a different threshold each time, so the plan cache sees new queries as well
+		framework::UINT32 threshold = iteration % 100;
+		char query[128];
+		snprintf(query, sizeof (query), "SELECT * FROM %s WHERE Temperature >= %u",
+				HARNESS_ELEMENT_CLASS, threshold);
+		status = stress.pInstanceMI->ft->execQuery(stress.pInstanceMI, pContext, pResult,
+				pPath, "WQL", query);
+		expected = countWarmerThan(threshold);
+		returned = true;
+		break;
+	}
+	case STRESS_ASSOCIATOR_NAMES:
+	{
+		// the provider has no associations, so nothing comes back
+		std::string instanceId = HarnessElementFactory::getInstanceId(iteration % HARNESS_ELEMENTS);
+		CMAddKey(pPath, "InstanceID", instanceId.c_str(), CMPI_chars);
+		status = stress.pAssociationMI->ft->associatorNames(stress.pAssociationMI, pContext,
+				pResult, pPath, NULL, NULL, NULL, NULL);
+		break;
+	}
+	case STRESS_FILTER:
+	{
+		CMPISelectExp *pFilter = broker.newSelectExp(STRESS_ALERT_QUERY);
+		CMPIObjectPath *pClassPath = broker.newObjectPath(INTEL_ROOT_NAMESPACE, HARNESS_ALERT_CLASS);
+		status = stress.pIndicationMI->ft->activateFilter(stress.pIndicationMI, pContext,
+				pFilter, HARNESS_ALERT_CLASS, pClassPath, false);
+		if (status.rc == CMPI_RC_OK)
+		{
+			status = stress.pIndicationMI->ft->deActivateFilter(stress.pIndicationMI, pContext,
+					pFilter, HARNESS_ALERT_CLASS, pClassPath, false);
+		}
+		// filters don't return results
+		CMReturnDone(pResult);
+		break;
+	}
+	default:
+		break;
+	}
+
+	FakeResultCounts counts = FakeBroker::getResultCounts(pResult);
+	size_t results = returned ? counts.instances : counts.objectPaths;
+	size_t others = returned ? counts.objectPaths : counts.instances;
+	stress.calls++;
+	check(stress, status.rc == CMPI_RC_OK && counts.done && results == expected && others == 0,
+			STRESS_REQUEST_NAMES[kind], status, counts, expected);
+}
+
+static void runThread(Stress *pStress, const unsigned int thread, const unsigned int iterations)
+{
+	for (unsigned int iteration = 0; iteration < iterations; iteration++)
+	{
+		enum stressRequest kind = (enum stressRequest)((thread + iteration) % STRESS_REQUEST_KINDS);
+		request(*pStress, kind, iteration);
+	}
+}
+
+/*
+ * With a filter active, the indications the provider sends reach the broker
+ */
+static void checkIndications(Stress &stress)
+{
+	FakeBroker &broker = *stress.pBroker;
+	CMPIContext *pContext = broker.newContext();
+	CMPISelectExp *pFilter = broker.newSelectExp(STRESS_ALERT_QUERY);
+	CMPIObjectPath *pClassPath = broker.newObjectPath(INTEL_ROOT_NAMESPACE, HARNESS_ALERT_CLASS);
+
+	CMPIUint64 delivered = broker.getDeliveredIndications();
+	CMPIStatus status = stress.pIndicationMI->ft->activateFilter(stress.pIndicationMI, pContext,
+			pFilter, HARNESS_ALERT_CLASS, pClassPath, true);
+	std::this_thread::sleep_for(std::chrono::milliseconds(50));
+	CMPIStatus lastStatus = stress.pIndicationMI->ft->deActivateFilter(stress.pIndicationMI,
+			pContext, pFilter, HARNESS_ALERT_CLASS, pClassPath, true);
+
+	stress.calls++;
+	if (status.rc != CMPI_RC_OK || lastStatus.rc != CMPI_RC_OK ||
+			broker.getDeliveredIndications() == delivered)
+	{
+		stress.failures++;
+		fprintf(stderr, "Indications weren't delivered: activate rc=%d deactivate rc=%d\n",
+				(int)status.rc, (int)lastStatus.rc);
+	}
+}
+
+int runStress(int argc, char *argv[])
+{
+	unsigned int threads = argc > 0 ? (unsigned int)atoi(argv[0]) : STRESS_DEFAULT_THREADS;
+	unsigned int iterations = argc > 1 ? (unsigned int)atoi(argv[1]) : STRESS_DEFAULT_ITERATIONS;
+	if (threads == 0 || iterations == 0)
+	{
+		fprintf(stderr, "The thread and iteration counts must be positive numbers\n");
+		return 2;
+	}
+
+	FakeBroker broker;
+	HarnessProviderFactory *pProvider = new HarnessProviderFactory();
+	framework::ProviderFactory::setSingleton(pProvider);
+
+	// load the provider the way the CIMOM does, which starts the warm-up
+	Stress stress;
+	stress.pBroker = &broker;
+	stress.calls = 0;
+	stress.failures = 0;
+	CMPIContext *pContext = broker.newContext();
+	CMPIStatus status = {CMPI_RC_OK, NULL};
+	stress.pInstanceMI = Harness_Provider_Create_InstanceMI(broker.getBroker(), pContext, &status);
+	stress.pAssociationMI = Harness_Provider_Create_AssociationMI(broker.getBroker(), pContext,
+			&status);
+	stress.pIndicationMI = Harness_Provider_Create_IndicationMI(broker.getBroker(), pContext,
+			&status);
+
+	printf("Running %u threads of %u requests\n", threads, iterations);
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	std::vector<std::thread> workers;
+	for (unsigned int thread = 0; thread < threads; thread++)
+	{
+		workers.push_back(std::thread(runThread, &stress, thread, iterations));
+	}
+	for (size_t i = 0; i < workers.size(); i++)
+	{
+		workers[i].join();
+	}
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+	// every filter activated was deactivated again
+	if (pProvider->getIndicationService()->getContext() != NULL)
+	{
+		stress.failures++;
+		fprintf(stderr, "The provider is still indicating with no active filters\n");
+	}
+	checkIndications(stress);
+
+	stress.pIndicationMI->ft->cleanup(stress.pIndicationMI, pContext, true);
+	stress.pAssociationMI->ft->cleanup(stress.pAssociationMI, pContext, true);
+	stress.pInstanceMI->ft->cleanup(stress.pInstanceMI, pContext, true);
+
+	if (pProvider->getSetupErrors() != 0)
+	{
+		stress.failures++;
+		fprintf(stderr, "InitializeProvider and CleanUpProvider overlapped %u times\n",
+				pProvider->getSetupErrors());
+	}
+
+	framework::SingleFlightCounters shared =
+			framework::InstanceFactory::getSharedInstanceNamesCounters();
+	printf("%u requests in %.3f s, %u failed\n", (unsigned int)stress.calls, elapsed.count(),
+			(unsigned int)stress.failures);
+	printf("Instance name lists: %llu read, %llu shared\n", shared.executed, shared.collapsed);
+	printf("Threads attached: %llu, indications delivered: %llu\n",
+			(unsigned long long)broker.getThreadAttachments(),
+			(unsigned long long)broker.getDeliveredIndications());
+
+	framework::ProviderFactory::deleteSingleton();
+	return stress.failures == 0 ? 0 : 1;
+}
+
+} /* namespace harness */
+} /* namespace wbem */
@@ -0,0 +1,198 @@
+/*
+ * Copyright (c) 2015 2016, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of Intel Corporation nor the names of its contributors
+ *     may be used to endorse or promote products derived from this software
+ *     without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * This file contains a benchmark comparing WQL predicates evaluated an instance at a time
+ * with the same predicates evaluated over column batches.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include <Strings.h>
+#include <WqlBatchPredicate.h>
+#include <WqlConditional.h>
+#include <WqlPredicate.h>
+
+#include "Harness.h"
+#include "HarnessProvider.h"
+
+namespace wbem
+{
+namespace harness
+{
+
+#define	BENCHMARK_DEFAULT_ROWS 100000
+#define	BENCHMARK_DEFAULT_RUNS 5
+
+/*
+ * WHERE clauses over the synthetic rows: numeric comparisons the batch predicate runs as
+ * column loops, combined with AND, OR and NOT, and a LIKE it tests an attribute at a time.
+ */
+static const char *BENCHMARK_CONDITIONS[] =
+{
+	"Temperature > 70",
+	"Capacity >= 549755813888 AND ErrorCount < 10",
+	"HealthState = 5 OR NOT (Temperature <= 40)",
+	"ElementName LIKE 'Element 1%'"
+};
+
+/*
+ * Build rows with values spread by a linear congruential generator, so every run of the
+ * benchmark sees the same rows
+ */
+static void buildRows(const size_t rows, framework::instances_t &instances)
+{
+	framework::UINT64 seed = 1;
+	instances.reserve(rows);
+	for (size_t row = 0; row < rows; row++)
+	{
+		seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+		framework::UINT32 random = (framework::UINT32)(seed >> 33);
+
+		framework::attributes_t keys;
+		keys["InstanceID"] = framework::Attribute(
+				HarnessElementFactory::getInstanceId((framework::UINT32)row), true);
+		framework::ObjectPath path("harness", INTEL_ROOT_NAMESPACE, HARNESS_ELEMENT_CLASS, keys);
+		framework::Instance instance(path);
+		instance.setAttribute("ElementName",
+				framework::Attribute("Element " + std::to_string(row), false));
+		instance.setAttribute("Capacity",
+				framework::Attribute((framework::UINT64)(random % 1024) << 30, false));
+		instance.setAttribute("Temperature",
+				framework::Attribute((framework::SINT32)(random % 120) - 10, false));
+		instance.setAttribute("ErrorCount",
+				framework::Attribute((framework::UINT64)((random >> 10) % 50), false));
+		instance.setAttribute("HealthState",
+				framework::Attribute((framework::UINT16)((random >> 16) % 4 == 0 ? 20 : 5), false));
+		instances.push_back(instance);
+	}
+}
+
+/*
+ * Time the fastest of several runs of a function, in milliseconds
+ */
+template <class FUNCTION>
+static double fastestRun(const unsigned int runs, FUNCTION function)
+{
+	double fastest = 0;
+	for (unsigned int run = 0; run < runs; run++)
+	{
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		function();
+		std::chrono::duration<double, std::milli> elapsed =
+				std::chrono::steady_clock::now() - start;
+		if (run == 0 || elapsed.count() < fastest)
+		{
+			fastest = elapsed.count();
+		}
+	}
+	return fastest;
+}
+
+/*
+ * Benchmark one condition, returning false if the two evaluations select different rows
+ */
+static bool benchmarkCondition(const std::string &condition,
+		const framework::instances_t &instances, const unsigned int runs)
+{
+	framework::WqlConditional conditional(condition);
+	framework::WqlPredicate predicate(&conditional);
+	framework::WqlBatchPredicate batchPredicate(&conditional);
+
+	std::vector<bool> scalarRows(instances.size());
+	double scalarTime = fastestRun(runs, [&]()
+	{
+		for (size_t row = 0; row < instances.size(); row++)
+		{
+			scalarRows[row] = predicate.matches(instances[row]);
+		}
+	});
+
+	std::vector<bool> batchRows(instances.size());
+	framework::selection_bitmap_t selection;
+	double batchTime = fastestRun(runs, [&]()
+	{
+		for (size_t first = 0; first < instances.size(); first += WQL_BATCH_ROWS)
+		{
+			size_t count = std::min<size_t>(WQL_BATCH_ROWS, instances.size() - first);
+			batchPredicate.select(instances, first, count, selection);
+			for (size_t row = 0; row < count; row++)
+			{
+				batchRows[first + row] = framework::WqlBatchPredicate::isSelected(selection, row);
+			}
+		}
+	});
+
+	size_t matches = std::count(scalarRows.begin(), scalarRows.end(), true);
+	printf("%-48s %8zu %10.2f %10.2f %7.1fx\n", condition.c_str(), matches, scalarTime,
+			batchTime, batchTime > 0 ? scalarTime / batchTime : 0);
+	return scalarRows == batchRows;
+}
+
+int runWqlBenchmark(int argc, char *argv[])
+{
+	size_t rows = argc > 0 ? (size_t)atol(argv[0]) : BENCHMARK_DEFAULT_ROWS;
+	unsigned int runs = argc > 1 ? (unsigned int)atoi(argv[1]) : BENCHMARK_DEFAULT_RUNS;
+	if (rows == 0 || runs == 0)
+	{
+		fprintf(stderr, "The row and run counts must be positive numbers\n");
+		return 2;
+	}
+
+	framework::instances_t instances;
+	buildRows(rows, instances);
+
+	printf("Fastest of %u runs over %zu rows, in milliseconds\n", runs, rows);
+	printf("%-48s %8s %10s %10s %8s\n", "Condition", "Matches", "Scalar", "Batch", "Speedup");
+	int rc = 0;
+	for (size_t i = 0; i < sizeof (BENCHMARK_CONDITIONS) / sizeof (BENCHMARK_CONDITIONS[0]); i++)
+	{
+		try
+		{
+			if (!benchmarkCondition(BENCHMARK_CONDITIONS[i], instances, runs))
+			{
+				fprintf(stderr, "%s: the batch and scalar evaluations selected different rows\n",
+						BENCHMARK_CONDITIONS[i]);
+				rc = 1;
+			}
+		}
+		catch (framework::Exception &e)
+		{
+			fprintf(stderr, "%s: %s\n", BENCHMARK_CONDITIONS[i], e.what());
+			rc = 1;
+		}
+	}
+	return rc;
+}
+
+} /* namespace harness */
+} /* namespace wbem */
@@ -0,0 +1,59 @@
+/*
+ * Copyright (c) 2015 2016, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of Intel Corporation nor the names of its contributors
+ *     may be used to endorse or promote products derived from this software
+ *     without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * This file contains the entry point of the harness, which runs one of its tests.
+ */
+
+#include <cstdio>
+#include <cstring>
+
+#include "Harness.h"
+
+static void usage(const char *program)
+{
+	fprintf(stderr, "Usage: %s stress [threads] [iterations]\n", program);
+	fprintf(stderr, "       %s wql-bench [rows] [runs]\n", program);
+}
+
+int main(int argc, char *argv[])
+{
+	int rc = 2;
+	if (argc >= 2 && strcmp(argv[1], "stress") == 0)
+	{
+		rc = wbem::harness::runStress(argc - 2, argv + 2);
+	}
+	else if (argc >= 2 && strcmp(argv[1], "wql-bench") == 0)
+	{
+		rc = wbem::harness::runWqlBenchmark(argc - 2, argv + 2);
+	}
+	else
+	{
+		usage(argv[0]);
+	}
+	return rc;
+}